@@ -0,0 +1,122 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <benchmark/benchmark.h>
+
+#include "GaussianMixture.h"
+#include "ClusterIsolation.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+/*
+  Times automatic clustering of one electrode (GaussianMixture::fit, as
+  run by a ClusteringJob), which bounds how long clustering every
+  electrode of a recording takes, and the isolation metrics of its units
+  (ClusterIsolation, as run by an IsolationJob).
+
+  Arguments: number of projections, number of clusters they were drawn from
+  (and, for isolation, the number of components)
+*/
+
+static void makeClusters(int numPoints, int numClusters, std::vector<float>& x, std::vector<float>& y)
+{
+    std::mt19937 generator(1);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    x.clear();
+    y.clear();
+
+    for (int i = 0; i < numPoints; i++)
+    {
+        const int c = i % numClusters;
+
+        // clusters on a circle, with different spreads
+        x.push_back(20.0f * std::cos(c * 1.3f) + normal(generator) * (1.0f + 0.3f * c));
+        y.push_back(20.0f * std::sin(c * 1.3f) + normal(generator) * (1.5f + 0.2f * c));
+    }
+}
+
+static void BM_GaussianMixtureFit(benchmark::State& state)
+{
+    std::vector<float> x, y;
+    makeClusters(int(state.range(0)), int(state.range(1)), x, y);
+
+    int numComponents = 0;
+
+    for (auto _ : state)
+    {
+        GaussianMixture mixture;
+        numComponents = mixture.fit(x.data(), y.data(), (int) x.size());
+        benchmark::DoNotOptimize(numComponents);
+    }
+
+    state.counters["components"] = numComponents;
+    state.counters["electrodes/s"] = benchmark::Counter(1.0, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// a full spike ring (600 spikes) up to the largest training set used
+BENCHMARK(BM_GaussianMixtureFit)
+    ->ArgsProduct({ { 200, 600, GaussianMixture::maxPoints }, { 1, 3, 6 } })
+    ->ArgNames({ "points", "clusters" })
+    ->Unit(benchmark::kMillisecond);
+
+/** Accumulating and evaluating all units of one electrode, each spike labelled with its cluster */
+static void BM_ClusterIsolation(benchmark::State& state)
+{
+    const int numPoints = int(state.range(0));
+    const int numClusters = int(state.range(1));
+    const int dim = int(state.range(2));
+
+    std::mt19937 generator(1);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    std::vector<float> features(size_t(numPoints) * dim);
+
+    for (int i = 0; i < numPoints; i++)
+        for (int k = 0; k < dim; k++)
+            features[size_t(i) * dim + k] = normal(generator) + (k == 0 ? 10.0f * (i % numClusters) : 0.0f);
+
+    std::vector<UnitIsolation> results;
+
+    for (auto _ : state)
+    {
+        ClusterIsolation isolation(dim);
+
+        for (int i = 0; i < numPoints; i++)
+            isolation.addSpike(features.data() + size_t(i) * dim, i % numClusters);
+
+        isolation.compute(numClusters, results);
+        benchmark::DoNotOptimize(results.data());
+    }
+
+    state.counters["electrodes/s"] = benchmark::Counter(1.0, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// a full spike ring with a few to many units, in 3 to 8 components
+BENCHMARK(BM_ClusterIsolation)
+    ->ArgsProduct({ { 600 }, { 1, 4, 16 }, { 3, 8 } })
+    ->ArgNames({ "points", "clusters", "components" })
+    ->Unit(benchmark::kMillisecond);
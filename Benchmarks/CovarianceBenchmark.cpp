@@ -0,0 +1,166 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <benchmark/benchmark.h>
+
+#include "SimdKernels.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/*
+  Compares the covariance step of a PCA job: the original triple loop
+  (one heap row per dimension) against packing + the blocked SYRK kernel.
+
+  Arguments: number of training spikes, waveform dimension (channels x samples)
+*/
+
+static std::vector<float> makeWaveforms(int numSpikes, int dim)
+{
+    std::vector<float> waveforms(size_t(numSpikes) * dim);
+
+    srand(1);
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        const float amplitude = -50.0f - float(rand() % 100);
+
+        for (int j = 0; j < dim; j++)
+            waveforms[size_t(i) * dim + j] = amplitude * std::sin(j * 0.2f) + float(rand() % 100) / 10.0f;
+    }
+
+    return waveforms;
+}
+
+/** The covariance loop as it was in PCAjob::computeCov */
+static void BM_CovarianceReference(benchmark::State& state)
+{
+    const int numSpikes = int(state.range(0));
+    const int dim = int(state.range(1));
+
+    const std::vector<float> waveforms = makeWaveforms(numSpikes, dim);
+
+    for (auto _ : state)
+    {
+        float** cov = new float*[dim];
+        float* mean = new float[dim];
+
+        for (int k = 0; k < dim; k++)
+        {
+            cov[k] = new float[dim];
+            for (int j = 0; j < dim; j++)
+                cov[k][j] = 0;
+        }
+
+        for (int j = 0; j < dim; j++)
+        {
+            mean[j] = 0;
+            for (int i = 0; i < numSpikes; i++)
+                mean[j] += waveforms[size_t(i) * dim + j] / dim;
+        }
+
+        for (int i = 0; i < dim; i++)
+        {
+            for (int j = i; j < dim; j++)
+            {
+                float sum = 0;
+                for (int k = 0; k < numSpikes; k++)
+                {
+                    const float* spike = waveforms.data() + size_t(k) * dim;
+                    sum += (spike[i] - mean[i]) * (spike[j] - mean[j]);
+                }
+                cov[i][j] = sum / (dim - 1);
+                cov[j][i] = sum / (dim - 1);
+            }
+        }
+
+        benchmark::DoNotOptimize(cov[dim - 1][dim - 1]);
+
+        for (int k = 0; k < dim; k++)
+            delete[] cov[k];
+        delete[] cov;
+        delete[] mean;
+    }
+
+    state.counters["spikes/s"] = benchmark::Counter(double(numSpikes), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+/** Centering into a padded matrix followed by SimdKernels::syrk */
+static void covarianceBlocked(benchmark::State& state, SimdKernels::InstructionSet instructionSet)
+{
+    const int numSpikes = int(state.range(0));
+    const int dim = int(state.range(1));
+    const int ld = SimdKernels::padDimension(dim);
+
+    if (instructionSet > SimdKernels::getSupportedInstructionSet())
+    {
+        state.SkipWithError("instruction set not supported on this CPU");
+        return;
+    }
+
+    SimdKernels::setInstructionSet(instructionSet);
+
+    const std::vector<float> waveforms = makeWaveforms(numSpikes, dim);
+    std::vector<float> centered(size_t(numSpikes) * ld, 0.0f);
+    std::vector<float> cov(size_t(ld) * ld);
+    std::vector<double> mean(dim);
+
+    for (auto _ : state)
+    {
+        std::fill(mean.begin(), mean.end(), 0.0);
+
+        for (int i = 0; i < numSpikes; i++)
+            for (int j = 0; j < dim; j++)
+                mean[j] += waveforms[size_t(i) * dim + j];
+
+        for (int j = 0; j < dim; j++)
+            mean[j] /= numSpikes;
+
+        for (int i = 0; i < numSpikes; i++)
+            for (int j = 0; j < dim; j++)
+                centered[size_t(i) * ld + j] = float(waveforms[size_t(i) * dim + j] - mean[j]);
+
+        SimdKernels::syrk(centered.data(), numSpikes, dim, ld, cov.data(), ld);
+
+        benchmark::DoNotOptimize(cov.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["spikes/s"] = benchmark::Counter(double(numSpikes), benchmark::Counter::kIsIterationInvariantRate);
+
+    SimdKernels::setInstructionSet(SimdKernels::getSupportedInstructionSet());
+}
+
+static void BM_CovarianceBlockedScalar(benchmark::State& state) { covarianceBlocked(state, SimdKernels::SCALAR); }
+static void BM_CovarianceBlockedAVX2(benchmark::State& state) { covarianceBlocked(state, SimdKernels::AVX2); }
+static void BM_CovarianceBlockedAVX512(benchmark::State& state) { covarianceBlocked(state, SimdKernels::AVX512); }
+
+// single electrode, stereotrode and tetrode waveforms (40 samples per channel),
+// from the default training sample up to large ones (see Sorter::setTrainingSetSize)
+#define COVARIANCE_ARGS ArgsProduct({ { 200, 1000, 10000 }, { 40, 80, 160 } })
+
+BENCHMARK(BM_CovarianceReference)->COVARIANCE_ARGS;
+BENCHMARK(BM_CovarianceBlockedScalar)->COVARIANCE_ARGS;
+BENCHMARK(BM_CovarianceBlockedAVX2)->COVARIANCE_ARGS;
+BENCHMARK(BM_CovarianceBlockedAVX512)->COVARIANCE_ARGS;
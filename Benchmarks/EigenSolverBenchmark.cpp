@@ -0,0 +1,101 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <benchmark/benchmark.h>
+
+#include "EigenSolver.h"
+#include "SimdKernels.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+/*
+  Top-3 eigenpairs of a PCA covariance matrix: the reference SVD against
+  subspace iteration.
+
+  Argument: waveform dimension (channels x samples)
+*/
+
+/** Covariance of 1000 synthetic spikes from three units, in the padded layout PCAjob uses */
+static std::vector<float> makeCovariance(int dim)
+{
+    const int numSpikes = 1000;
+    const int ld = SimdKernels::padDimension(dim);
+
+    std::mt19937 rng(1);
+    std::normal_distribution<float> gaussian;
+
+    std::vector<std::vector<float>> templates(3, std::vector<float>(dim));
+
+    for (auto& t : templates)
+        for (auto& v : t)
+            v = 10.0f * gaussian(rng);
+
+    std::vector<float> X(size_t(numSpikes) * ld, 0.0f);
+    std::vector<double> mean(dim, 0.0);
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        for (int j = 0; j < dim; j++)
+        {
+            X[size_t(i) * ld + j] = templates[i % 3][j] * (1.0f + 0.1f * gaussian(rng)) + gaussian(rng);
+            mean[j] += X[size_t(i) * ld + j] / numSpikes;
+        }
+    }
+
+    for (int i = 0; i < numSpikes; i++)
+        for (int j = 0; j < dim; j++)
+            X[size_t(i) * ld + j] -= float(mean[j]);
+
+    std::vector<float> C(size_t(ld) * ld);
+    SimdKernels::syrk(X.data(), numSpikes, dim, ld, C.data(), ld);
+
+    return C;
+}
+
+static void topEigenpairs(benchmark::State& state, EigenSolver::Type type)
+{
+    const int dim = int(state.range(0));
+    const int k = 3;
+
+    const std::vector<float> covariance = makeCovariance(dim);
+    std::vector<float> eigenvalues(k), eigenvectors(size_t(k) * dim);
+
+    std::unique_ptr<EigenSolver> solver = EigenSolver::create(type);
+
+    for (auto _ : state)
+    {
+        solver->computeTopK(covariance.data(), dim, SimdKernels::padDimension(dim), k,
+                            eigenvalues.data(), eigenvectors.data());
+
+        benchmark::DoNotOptimize(eigenvectors.data());
+    }
+}
+
+static void BM_EigenSvdReference(benchmark::State& state) { topEigenpairs(state, EigenSolver::SVD_REFERENCE); }
+static void BM_EigenSubspaceIteration(benchmark::State& state) { topEigenpairs(state, EigenSolver::SUBSPACE_ITERATION); }
+
+// single channel, tetrode, and a 384-sample multi-channel waveform
+BENCHMARK(BM_EigenSvdReference)->Arg(40)->Arg(160)->Arg(384)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EigenSubspaceIteration)->Arg(40)->Arg(160)->Arg(384)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,1017 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <benchmark/benchmark.h>
+
+#include "Sorter.h"
+#include "PCAJobScheduler.h"
+#include "WaveformStats.h"
+#include "UnitMetrics.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+/*
+  Measures each step of the per-spike path (SpikeSorter::handleSpike)
+  on the headless core, and the whole path end to end.
+
+  Arguments: channels, samples per channel, and for sortSpike the number
+  of box units and polygon units. Units are placed so that no spike falls
+  inside them. Every box is tested (the worst case), but the polygons lie
+  outside the PCAUnitGrid's bounds, so BM_SortSpike only measures the
+  grid's early return for them. BM_SortSpikeNearPolygons puts the spike
+  next to the edge of every polygon, so that each one is tested exactly.
+
+  Run with --benchmark_out=<file> --benchmark_out_format=json to keep
+  machine-readable results (e.g. for tools/compare.py from Google Benchmark).
+*/
+
+/*
+  Every heap allocation in this program goes through the replaced
+  operators below, so BM_SortPath can check that the steady-state path
+  allocates nothing (SorterSpikePool::getNumPoolAllocations() only sees
+  the pool's own slabs).
+*/
+
+static std::atomic<int64_t> numAllocations(0);
+
+static void* countedAllocation(std::size_t size, std::size_t alignment)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    void* p = nullptr;
+
+    if (alignment <= alignof(std::max_align_t))
+        p = std::malloc(size > 0 ? size : 1);
+    else
+        p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+
+    if (p == nullptr)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void* operator new(std::size_t size) { return countedAllocation(size, 0); }
+void* operator new[](std::size_t size) { return countedAllocation(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocation(size, std::size_t(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocation(size, std::size_t(alignment)); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+/** One electrode worth of core objects, with a PC basis already in place */
+class SortPathSetup
+{
+public:
+
+    SortPathSetup(int numChannels, int numSamples, int numBoxUnits = 0, int numPCAUnits = 0, int numLocalChannels = 0)
+        : scheduler(1),
+          ring(numChannels, numSamples),
+          pool(numChannels * numSamples),
+          sorter(&ring, &scheduler),
+          nextSpike(0)
+    {
+        channel.numChannels = numChannels;
+        channel.numSamples = numSamples;
+        channel.prePeakSamples = numSamples / 4;
+        channel.sampleRate = 30000.0f;
+
+        const int dim = channel.getDimension();
+
+        srand(1);
+
+        waveforms.resize(size_t(numWaveforms) * dim);
+
+        for (int i = 0; i < numWaveforms; i++)
+        {
+            const float amplitude = -50.0f - float(rand() % 100);
+
+            for (int j = 0; j < dim; j++)
+                waveforms[size_t(i) * dim + j] = amplitude * std::sin((j % numSamples) * 0.2f) + float(rand() % 100) / 10.0f;
+        }
+
+        thresholds.assign(numChannels, 1e9f);
+
+        SorterState state;
+        state.numChannels = numChannels;
+        state.waveformLength = numSamples;
+        state.basisVersion = 1;
+
+        if (numLocalChannels > 0)
+        {
+            // temporal components of one channel (see PCABasis)
+            const PCABasis layout(channel, numLocalChannels, 1, state.numComponents);
+
+            state.basisLocalChannels = layout.getNumLocalChannels();
+            state.peakSample = layout.getPeakSample();
+            state.components.resize(size_t(layout.getNumStoredComponents()) * numSamples);
+            state.mean.assign(numSamples, 0.0f);
+        }
+        else
+        {
+            state.components.resize(size_t(state.numComponents) * dim);
+            state.mean.assign(dim, 0.0f);
+        }
+
+        for (size_t k = 0; k < state.components.size(); k++)
+            state.components[k] = std::sin(float(k) * 0.37f) / std::sqrt(float(dim));
+
+        // boxes above the waveforms, on every channel in turn
+        for (int u = 0; u < numBoxUnits; u++)
+        {
+            BoxUnit unit(Box(100, 1000, 300, 10, u % numChannels), 1000 + u);
+            state.boxUnits.push_back(unit);
+        }
+
+        // octagons far from any projection, drawn in the basis above
+        for (int u = 0; u < numPCAUnits; u++)
+        {
+            PCAUnit unit(2000 + u);
+            unit.basisVersion = state.basisVersion;
+            unit.poly.offset = PointD(1e6f + 10.0f * u, 1e6f);
+
+            for (int p = 0; p < 8; p++)
+                unit.poly.pts.push_back(PointD(std::cos(p * 0.785f), std::sin(p * 0.785f)));
+
+            state.pcaUnits.push_back(unit);
+        }
+
+        sorter.setState(state);
+        sorter.setChannel(channel);
+    }
+
+    /** Returns the next test spike (cycling through the generated waveforms) */
+    SpikeDescriptor getNextDescriptor()
+    {
+        SpikeDescriptor spike;
+        spike.channel = &channel;
+        spike.waveform = waveforms.data() + size_t(nextSpike % numWaveforms) * channel.getDimension();
+        spike.timestamp = nextSpike * 100;
+
+        nextSpike++;
+
+        return spike;
+    }
+
+    static const int numWaveforms = 64;
+
+    SpikeChannelDescriptor channel;
+    std::vector<float> waveforms;
+    std::vector<float> thresholds;
+
+    PCAJobScheduler scheduler;
+    SpikeRing ring;
+    SorterSpikePool pool;
+    Sorter sorter;
+
+    int64_t nextSpike;
+};
+
+/** Round polygons with many vertices, spread over the default PC range (like units drawn by hand) */
+static std::vector<PCAUnit> makeDrawnUnits(int numUnits, int numVertices)
+{
+    std::vector<PCAUnit> units;
+
+    for (int u = 0; u < numUnits; u++)
+    {
+        PCAUnit unit(u + 1);
+        unit.basisVersion = 1;
+
+        const float centerX = -4.0f + 8.0f * float(rand() % 100) / 100.0f;
+        const float centerY = -4.0f + 8.0f * float(rand() % 100) / 100.0f;
+
+        for (int p = 0; p < numVertices; p++)
+        {
+            const float angle = 6.2832f * p / numVertices;
+            const float radius = 0.5f + float(rand() % 10) / 100.0f;
+            unit.poly.pts.push_back(PointD(centerX + radius * std::cos(angle), centerY + radius * std::sin(angle)));
+        }
+
+        units.push_back(unit);
+    }
+
+    return units;
+}
+
+/** Projections spread over the default PC range */
+static std::vector<PointD> makeProjections(int numProjections)
+{
+    std::vector<PointD> projections;
+
+    for (int i = 0; i < numProjections; i++)
+        projections.push_back(PointD(-5.0f + 10.0f * float(rand() % 1000) / 1000.0f, -5.0f + 10.0f * float(rand() % 1000) / 1000.0f));
+
+    return projections;
+}
+
+static void setSpikeRate(benchmark::State& state, int spikesPerIteration = 1)
+{
+    state.counters["spikes/s"] = benchmark::Counter(double(spikesPerIteration), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+/** Copying an incoming spike into a pooled container */
+static void BM_ContainerFromPool(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    for (auto _ : state)
+    {
+        SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+        benchmark::DoNotOptimize(spike.get());
+    }
+
+    setSpikeRate(state);
+}
+
+/** Copying an incoming spike into a freshly allocated container (the fallback path) */
+static void BM_ContainerAllocated(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    for (auto _ : state)
+    {
+        SorterSpikePtr spike = std::make_shared<SorterSpikeContainer>(setup.getNextDescriptor());
+        benchmark::DoNotOptimize(spike.get());
+    }
+
+    setSpikeRate(state);
+}
+
+static void BM_CheckThresholds(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    for (auto _ : state)
+    {
+        bool passed = spike->checkThresholds(setup.thresholds.data(), (int) setup.thresholds.size());
+        benchmark::DoNotOptimize(passed);
+    }
+
+    setSpikeRate(state);
+}
+
+static void BM_ProjectOnPrincipalComponents(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    for (auto _ : state)
+    {
+        setup.sorter.projectOnPrincipalComponents(spike);
+        benchmark::DoNotOptimize(spike->pcProj);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Projection on the channels around the peak only (channel-local basis) */
+static void BM_ProjectLocal(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), 40, 0, 0, int(state.range(1)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    for (auto _ : state)
+    {
+        setup.sorter.projectOnPrincipalComponents(spike);
+        benchmark::DoNotOptimize(spike->pcProj);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Projection of a burst of 16 spikes at once */
+static void BM_ProjectBatch(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    const int batchSize = 16;
+    std::vector<SorterSpikePtr> spikes;
+
+    for (int i = 0; i < batchSize; i++)
+        spikes.push_back(setup.pool.getNextSpike(setup.getNextDescriptor()));
+
+    for (auto _ : state)
+    {
+        setup.sorter.projectOnPrincipalComponents(spikes.data(), batchSize);
+        benchmark::DoNotOptimize(spikes[batchSize - 1]->pcProj);
+    }
+
+    setSpikeRate(state, batchSize);
+}
+
+static void BM_SortSpike(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)), int(state.range(2)), int(state.range(3)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+    setup.sorter.projectOnPrincipalComponents(spike);
+
+    for (auto _ : state)
+    {
+        bool sorted = setup.sorter.sortSpike(spike, true);
+        benchmark::DoNotOptimize(sorted);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Sorting with every polygon passing just beside the spike's projection (the worst case for PCAUnitGrid) */
+static void BM_SortSpikeNearPolygons(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+    setup.sorter.projectOnPrincipalComponents(spike);
+
+    // octagons with a vertex 1e-3 away from the projection, in different directions: the
+    // spike's cell is a boundary cell of every polygon, but lies inside none of them
+    std::vector<PCAUnit> units;
+
+    for (int u = 0; u < int(state.range(2)); u++)
+    {
+        const float angle = (u % 8) * 0.785f;
+        const float distance = 1.0f + 1e-3f * (1 + u / 8);
+
+        PCAUnit unit(2000 + u);
+        unit.basisVersion = spike->basisVersion;
+        unit.poly.offset = PointD(spike->pcProj[0] - distance * std::cos(angle), spike->pcProj[1] - distance * std::sin(angle));
+
+        for (int p = 0; p < 8; p++)
+            unit.poly.pts.push_back(PointD(std::cos(p * 0.785f), std::sin(p * 0.785f)));
+
+        units.push_back(unit);
+    }
+
+    setup.sorter.updatePCAUnits(units);
+
+    if (setup.sorter.sortSpike(spike, true))
+    {
+        state.SkipWithError("the spike was placed inside a polygon");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        bool sorted = setup.sorter.sortSpike(spike, true);
+        benchmark::DoNotOptimize(sorted);
+    }
+
+    setSpikeRate(state);
+}
+
+static void BM_WaveformStatsUpdate(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+    WaveformStats stats;
+
+    for (auto _ : state)
+    {
+        stats.update(spike);
+        benchmark::DoNotOptimize(stats.getNumSpikes());
+    }
+
+    setSpikeRate(state);
+}
+
+/** Combining the partial statistics of one unit gathered on another thread */
+static void BM_WaveformStatsMerge(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    WaveformStats partial;
+
+    for (int i = 0; i < SortPathSetup::numWaveforms; i++)
+        partial.update(setup.pool.getNextSpike(setup.getNextDescriptor()));
+
+    WaveformStats stats;
+
+    for (auto _ : state)
+    {
+        stats.merge(partial);
+        benchmark::DoNotOptimize(stats.getNumSpikes());
+    }
+}
+
+/** Adding a spike time to a unit's metrics (ring buffer, interval histogram) */
+static void BM_UnitMetricsAdd(benchmark::State& state)
+{
+    UnitMetrics metrics;
+    double time = 0;
+
+    srand(1);
+
+    for (auto _ : state)
+    {
+        time += 0.0005 + 0.1 * float(rand() % 1000) / 1000.0f;
+        metrics.addSpike(time);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Reading the quality figures of one unit, as the canvas does at each refresh */
+static void BM_UnitQuality(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)));
+
+    WaveformStats stats;
+    UnitMetrics metrics;
+
+    for (int i = 0; i < SortPathSetup::numWaveforms; i++)
+    {
+        stats.update(setup.pool.getNextSpike(setup.getNextDescriptor()));
+        metrics.addSpike(i * 0.01);
+    }
+
+    UnitQuality quality;
+
+    for (auto _ : state)
+    {
+        metrics.getQuality(quality, SortPathSetup::numWaveforms * 0.01);
+        quality.snr = UnitMetrics::computeSNR(stats, int(state.range(0)));
+        benchmark::DoNotOptimize(quality.snr);
+    }
+}
+
+/**
+    Compares CompiledBox with Box on randomized boxes and waveforms
+
+    Half of the boxes start and end exactly on sample times, and a quarter
+    of the samples lie exactly on the top or bottom edge of the box, where
+    the compiled margins decide the answer. Returns the number of
+    disagreements.
+*/
+static int countBoxMismatches(int numSamples, int numCases)
+{
+    SpikeChannelDescriptor channel;
+    channel.numChannels = 2;
+    channel.numSamples = numSamples;
+    channel.prePeakSamples = numSamples / 4;
+    channel.sampleRate = 30000.0f;
+
+    SorterSpikePool pool(channel.getDimension());
+    std::vector<float> waveform(channel.getDimension());
+
+    std::mt19937 generator(numSamples);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::uniform_int_distribution<int> sampleIndex(0, numSamples - 1);
+
+    const float duration = channel.timeBinToMicroseconds(numSamples - 1);
+
+    int numMismatches = 0;
+
+    for (int c = 0; c < numCases; c++)
+    {
+        float x = uniform(generator) * duration;
+        float w = uniform(generator) * duration * 0.5f;
+
+        if (c % 2 == 0)
+        {
+            const int first = sampleIndex(generator);
+            const int last = std::min(numSamples - 1, first + sampleIndex(generator) / 2);
+
+            x = channel.timeBinToMicroseconds(first);
+            w = channel.timeBinToMicroseconds(last) - x;
+        }
+
+        const float y = -100.0f + 200.0f * uniform(generator);
+        const float h = 1.0f + 100.0f * uniform(generator);
+
+        const Box box(x, y, w, h, c % channel.numChannels);
+
+        for (auto& value : waveform)
+        {
+            const float r = uniform(generator);
+
+            if (r < 0.125f)
+                value = y;
+            else if (r < 0.25f)
+                value = y - h;
+            else
+                value = -150.0f + 300.0f * uniform(generator);
+        }
+
+        SpikeDescriptor descriptor;
+        descriptor.channel = &channel;
+        descriptor.waveform = waveform.data();
+
+        SorterSpikePtr spike = pool.getNextSpike(descriptor);
+
+        if (box.isWaveFormInside(spike) != CompiledBox(box, channel).isWaveFormInside(*spike))
+            numMismatches++;
+    }
+
+    return numMismatches;
+}
+
+/** Box test on a spike's geometry (Box::isWaveFormInside), for a box above the waveform or one it crosses */
+static void BM_BoxGeometric(benchmark::State& state)
+{
+    SortPathSetup setup(1, int(state.range(0)));
+
+    const Box box = state.range(1) ? Box(100, 20, 300, 40) : Box(100, 1000, 300, 10);
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    for (auto _ : state)
+    {
+        bool inside = box.isWaveFormInside(spike);
+        benchmark::DoNotOptimize(inside);
+    }
+
+    setSpikeRate(state);
+}
+
+/** The same test with the box compiled to sample bins (checked against the geometric test first) */
+static void BM_BoxCompiled(benchmark::State& state)
+{
+    SortPathSetup setup(1, int(state.range(0)));
+
+    // the compiled test is only worth timing if it gives the same answers
+    if (countBoxMismatches(int(state.range(0)), 20000) > 0)
+    {
+        state.SkipWithError("CompiledBox disagrees with Box::isWaveFormInside");
+        return;
+    }
+
+    const Box box = state.range(1) ? Box(100, 20, 300, 40) : Box(100, 1000, 300, 10);
+    const CompiledBox compiledBox(box, setup.channel);
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    for (auto _ : state)
+    {
+        bool inside = compiledBox.isWaveFormInside(*spike);
+        benchmark::DoNotOptimize(inside);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Point-in-polygon test against every unit in turn */
+static void BM_PCAUnitsExact(benchmark::State& state)
+{
+    srand(1);
+
+    const std::vector<PCAUnit> units = makeDrawnUnits(int(state.range(0)), int(state.range(1)));
+    const std::vector<PointD> projections = makeProjections(1024);
+
+    int next = 0;
+
+    for (auto _ : state)
+    {
+        const PointD& p = projections[next++ & 1023];
+        int found = -1;
+
+        for (int k = 0; k < units.size() && found < 0; k++)
+        {
+            if (units[k].isPointInsidePolygon(p))
+                found = k;
+        }
+
+        benchmark::DoNotOptimize(found);
+    }
+
+    setSpikeRate(state);
+}
+
+/**
+    Compares PCAUnitGrid::findUnit with testing every unit in turn (as checkPCAUnits does)
+
+    A third of the units are drawn in a newer basis than the others, and
+    every other polygon carries an offset. Besides points spread over the
+    PC range, every vertex is looked up, along with the next float on
+    either side of it along both axes. Returns the number of disagreements.
+*/
+static int countGridMismatches(int numUnits, int numVertices)
+{
+    srand(2);
+
+    std::vector<PCAUnit> units = makeDrawnUnits(numUnits, numVertices);
+
+    for (size_t u = 0; u < units.size(); u++)
+    {
+        if (u % 3 == 1)
+            units[u].basisVersion = 2;
+
+        if (u % 2 == 1)
+            units[u].poly.offset = PointD(0.25f, -0.5f);
+    }
+
+    const PCAUnitGrid grid(units);
+
+    std::vector<PointD> points = makeProjections(20000);
+
+    for (auto& unit : units)
+    {
+        for (auto& vertex : unit.poly.pts)
+        {
+            const float x = vertex.X + unit.poly.offset.X;
+            const float y = vertex.Y + unit.poly.offset.Y;
+
+            points.push_back(PointD(x, y));
+            points.push_back(PointD(std::nextafter(x, -INFINITY), y));
+            points.push_back(PointD(std::nextafter(x, INFINITY), y));
+            points.push_back(PointD(x, std::nextafter(y, -INFINITY)));
+            points.push_back(PointD(x, std::nextafter(y, INFINITY)));
+        }
+    }
+
+    int numMismatches = 0;
+
+    for (auto& p : points)
+    {
+        int expected = PCAUnitGrid::noUnit;
+
+        for (int k = 0; k < (int) units.size() && expected == PCAUnitGrid::noUnit; k++)
+        {
+            if (units[k].basisVersion == grid.getBasisVersion() && units[k].isPointInsidePolygon(p))
+                expected = k;
+        }
+
+        if (grid.findUnit(p.X, p.Y, units) != expected)
+            numMismatches++;
+    }
+
+    return numMismatches;
+}
+
+/** Grid lookup, with the exact test for cells on a polygon's edge (checked against the exact loop first) */
+static void BM_PCAUnitsGrid(benchmark::State& state)
+{
+    // the grid is only worth timing if it finds the same units
+    if (countGridMismatches(int(state.range(0)), int(state.range(1))) > 0)
+    {
+        state.SkipWithError("PCAUnitGrid::findUnit disagrees with the exact test");
+        return;
+    }
+
+    srand(1);
+
+    const std::vector<PCAUnit> units = makeDrawnUnits(int(state.range(0)), int(state.range(1)));
+    const std::vector<PointD> projections = makeProjections(1024);
+    const PCAUnitGrid grid(units);
+
+    int next = 0;
+
+    for (auto _ : state)
+    {
+        const PointD& p = projections[next++ & 1023];
+        int found = grid.findUnit(p.X, p.Y, units);
+        benchmark::DoNotOptimize(found);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Rasterizing the units (done each time they are edited) */
+static void BM_PCAUnitGridBuild(benchmark::State& state)
+{
+    srand(1);
+
+    const std::vector<PCAUnit> units = makeDrawnUnits(int(state.range(0)), int(state.range(1)));
+
+    for (auto _ : state)
+    {
+        PCAUnitGrid grid(units);
+        benchmark::DoNotOptimize(grid.getBasisVersion());
+    }
+}
+
+/** Whitened template units (every other one shifted, so some spikes match) */
+static std::vector<TemplateUnit> makeTemplateUnits(int numUnits, int dim)
+{
+    std::vector<TemplateUnit> units;
+
+    for (int i = 0; i < numUnits; i++)
+    {
+        TemplateUnit unit(i + 1);
+
+        unit.numChannels = 1;
+        unit.numSamples = dim;
+
+        for (int k = 0; k < dim; k++)
+        {
+            unit.waveform.push_back(-60.0f * std::sin(k * 0.2f) + float(i % 2) * 200.0f);
+            unit.variance.push_back(25.0f + float(rand() % 100));
+        }
+
+        units.push_back(unit);
+    }
+
+    return units;
+}
+
+/** Template units tested one at a time, in double precision */
+static void BM_TemplateUnitsExact(benchmark::State& state)
+{
+    srand(1);
+
+    const int dim = int(state.range(0)) * 40;
+    const std::vector<TemplateUnit> units = makeTemplateUnits(int(state.range(1)), dim);
+    const std::vector<float> waveform = units[0].waveform;
+
+    for (auto _ : state)
+    {
+        int found = -1;
+        float best = 1.0f;
+
+        for (int k = 0; k < units.size(); k++)
+        {
+            const float ratio = units[k].getDistance(waveform.data()) / units[k].threshold;
+
+            if (ratio < best)
+            {
+                best = ratio;
+                found = k;
+            }
+        }
+
+        benchmark::DoNotOptimize(found);
+    }
+
+    setSpikeRate(state);
+}
+
+/** The same units packed in a TemplateBank */
+static void BM_TemplateBank(benchmark::State& state)
+{
+    srand(1);
+
+    const int dim = int(state.range(0)) * 40;
+    const std::vector<TemplateUnit> units = makeTemplateUnits(int(state.range(1)), dim);
+    const std::vector<float> waveform = units[0].waveform;
+    const TemplateBank bank(units);
+
+    for (auto _ : state)
+    {
+        int found = bank.findUnit(waveform.data(), dim);
+        benchmark::DoNotOptimize(found);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Ellipsoid units in 3 to 8 components, fitted to clusters along the first component */
+static void BM_EllipsoidUnits(benchmark::State& state)
+{
+    srand(1);
+
+    const int n = int(state.range(0));
+    const int numUnits = int(state.range(1));
+    const int numPoints = 200;
+
+    std::vector<EllipsoidUnit> units;
+    std::vector<float> points(size_t(numPoints) * n);
+
+    for (int u = 0; u < numUnits; u++)
+    {
+        for (int p = 0; p < numPoints * n; p++)
+            points[p] = float(rand() % 1000) / 500.0f - 1.0f + (p % n == 0 ? 10.0f * u : 0.0f);
+
+        EllipsoidUnit unit(1000 + u);
+        unit.fit(points.data(), numPoints, n);
+        units.push_back(unit);
+    }
+
+    // inside the last unit, so every unit is tested
+    float proj[SorterSpikeContainer::maxProjections] = { };
+    proj[0] = 10.0f * (numUnits - 1);
+
+    for (auto _ : state)
+    {
+        int found = -1;
+
+        for (int k = 0; k < units.size(); k++)
+        {
+            if (units[k].isPointInside(proj))
+            {
+                found = k;
+                break;
+            }
+        }
+
+        benchmark::DoNotOptimize(found);
+    }
+
+    setSpikeRate(state);
+}
+
+/** Offering one spike to a full training sample (arguments: channels, sample size) */
+static void BM_TrainingReservoirAdd(benchmark::State& state)
+{
+    const int dim = int(state.range(0)) * 40;
+    const int capacity = int(state.range(1));
+
+    TrainingReservoir reservoir(dim, capacity);
+    std::vector<float> waveform(dim, 1.0f);
+
+    for (int i = 0; i < capacity; i++)
+        reservoir.addSpike(waveform.data());
+
+    for (auto _ : state)
+        reservoir.addSpike(waveform.data());
+
+    setSpikeRate(state);
+}
+
+/** Copying a full training sample, as a PCA job does when it starts */
+static void BM_TrainingReservoirCopy(benchmark::State& state)
+{
+    const int dim = int(state.range(0)) * 40;
+    const int capacity = int(state.range(1));
+
+    TrainingReservoir reservoir(dim, capacity);
+    std::vector<float> waveform(dim, 1.0f);
+    std::vector<float> dest(size_t(capacity) * dim);
+
+    for (int i = 0; i < capacity; i++)
+        reservoir.addSpike(waveform.data());
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(reservoir.copyWaveforms(dest.data(), capacity));
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["spikes/s"] = benchmark::Counter(double(capacity), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+/** Everything handleSpike does for one spike, with 4 box units and 4 polygon units */
+static void sortOneSpike(SortPathSetup& setup)
+{
+    SorterSpikePtr spike = setup.pool.getNextSpike(setup.getNextDescriptor());
+
+    if (spike->checkThresholds(setup.thresholds.data(), (int) setup.thresholds.size()))
+    {
+        setup.sorter.projectOnPrincipalComponents(spike);
+        setup.sorter.sortSpike(spike, true);
+        setup.ring.addSpike(spike.get());
+    }
+}
+
+static void BM_SortPath(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), int(state.range(1)), 4, 4);
+
+    // fill the ring once, so the timed spikes run in steady state
+    for (int i = 0; i < setup.ring.getCapacity(); i++)
+        sortOneSpike(setup);
+
+    const int64_t allocationsBefore = numAllocations.load();
+
+    for (auto _ : state)
+        sortOneSpike(setup);
+
+    const int64_t allocations = numAllocations.load() - allocationsBefore;
+
+    setSpikeRate(state);
+    state.counters["allocations"] = double(allocations);
+
+    if (allocations > 0)
+        state.SkipWithError("the steady-state sort path allocated memory");
+}
+
+/** A burst of spikes from one electrode, projected and sorted one at a time */
+static void BM_BurstPerSpike(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), 40, 4, 4);
+
+    const int burstSize = int(state.range(1));
+    std::vector<SorterSpikePtr> spikes;
+
+    for (int i = 0; i < burstSize; i++)
+        spikes.push_back(setup.pool.getNextSpike(setup.getNextDescriptor()));
+
+    for (auto _ : state)
+    {
+        for (auto& spike : spikes)
+        {
+            setup.sorter.projectOnPrincipalComponents(spike);
+            setup.sorter.sortSpike(spike, true);
+        }
+
+        benchmark::DoNotOptimize(spikes[burstSize - 1]->sortedId);
+    }
+
+    setSpikeRate(state, burstSize);
+}
+
+/** The same burst through Sorter::sortBatch */
+static void BM_BurstSortBatch(benchmark::State& state)
+{
+    SortPathSetup setup(int(state.range(0)), 40, 4, 4);
+
+    const int burstSize = int(state.range(1));
+    std::vector<SorterSpikePtr> spikes;
+
+    for (int i = 0; i < burstSize; i++)
+        spikes.push_back(setup.pool.getNextSpike(setup.getNextDescriptor()));
+
+    for (auto _ : state)
+    {
+        int numSorted = setup.sorter.sortBatch(spikes.data(), burstSize, true);
+        benchmark::DoNotOptimize(numSorted);
+    }
+
+    setSpikeRate(state, burstSize);
+}
+
+// single electrodes up to 32-channel probes, short and long waveforms
+#define WAVEFORM_ARGS ArgsProduct({ { 1, 2, 4, 8, 32 }, { 40, 64 } })->ArgNames({ "channels", "samples" })
+
+BENCHMARK(BM_ContainerFromPool)->WAVEFORM_ARGS;
+BENCHMARK(BM_ContainerAllocated)->WAVEFORM_ARGS;
+BENCHMARK(BM_CheckThresholds)->WAVEFORM_ARGS;
+BENCHMARK(BM_ProjectOnPrincipalComponents)->WAVEFORM_ARGS;
+BENCHMARK(BM_ProjectBatch)->WAVEFORM_ARGS;
+BENCHMARK(BM_WaveformStatsUpdate)->WAVEFORM_ARGS;
+BENCHMARK(BM_WaveformStatsMerge)->WAVEFORM_ARGS;
+BENCHMARK(BM_UnitQuality)->WAVEFORM_ARGS;
+BENCHMARK(BM_SortPath)->WAVEFORM_ARGS;
+
+BENCHMARK(BM_UnitMetricsAdd);
+
+// channel-local bases on wide electrode groups (40 samples per channel)
+BENCHMARK(BM_ProjectLocal)
+    ->ArgsProduct({ { 4, 8, 32 }, { 1, 2 } })
+    ->ArgNames({ "channels", "localChannels" });
+
+// spikes delivered to one electrode in a single process() call
+#define BURST_ARGS ArgsProduct({ { 4, 32 }, { 1, 8, 32 } })->ArgNames({ "channels", "burst" })
+
+BENCHMARK(BM_BurstPerSpike)->BURST_ARGS;
+BENCHMARK(BM_BurstSortBatch)->BURST_ARGS;
+
+// box across 300 us of the waveform, at 30 kHz
+#define BOX_ARGS ArgsProduct({ { 40, 64, 128 }, { 0, 1 } })->ArgNames({ "samples", "crossing" })
+
+BENCHMARK(BM_BoxGeometric)->BOX_ARGS;
+BENCHMARK(BM_BoxCompiled)->BOX_ARGS;
+
+// polygons from a few clicks up to long hand-drawn outlines
+#define POLYGON_ARGS ArgsProduct({ { 1, 4, 16 }, { 8, 100, 400 } })->ArgNames({ "units", "vertices" })
+
+BENCHMARK(BM_PCAUnitsExact)->POLYGON_ARGS;
+BENCHMARK(BM_PCAUnitsGrid)->POLYGON_ARGS;
+BENCHMARK(BM_PCAUnitGridBuild)->POLYGON_ARGS;
+
+// dozens of templates on electrodes up to 32-channel probes (40 samples per channel)
+#define TEMPLATE_ARGS ArgsProduct({ { 1, 4, 32 }, { 4, 16, 64 } })->ArgNames({ "channels", "templates" })
+
+BENCHMARK(BM_TemplateUnitsExact)->TEMPLATE_ARGS;
+BENCHMARK(BM_TemplateBank)->TEMPLATE_ARGS;
+
+// training samples from the default size up to 10k spikes
+#define TRAINING_ARGS ArgsProduct({ { 1, 4 }, { 200, 10000 } })->ArgNames({ "channels", "spikes" })
+
+BENCHMARK(BM_TrainingReservoirAdd)->TRAINING_ARGS;
+BENCHMARK(BM_TrainingReservoirCopy)->TRAINING_ARGS;
+
+BENCHMARK(BM_EllipsoidUnits)
+    ->ArgsProduct({ { 3, 5, 8 }, { 1, 4, 16 } })
+    ->ArgNames({ "components", "units" });
+
+BENCHMARK(BM_SortSpike)
+    ->ArgsProduct({ { 1, 4, 32 }, { 40 }, { 0, 4, 16 }, { 0, 4, 16 } })
+    ->ArgNames({ "channels", "samples", "boxUnits", "pcaUnits" });
+
+BENCHMARK(BM_SortSpikeNearPolygons)
+    ->ArgsProduct({ { 1, 4, 32 }, { 40 }, { 1, 4, 16 } })
+    ->ArgNames({ "channels", "samples", "pcaUnits" });
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdio.h>
 #include <algorithm>
+#include <cmath>
 
 #include "BoxUnit.h"
 
@@ -54,7 +55,7 @@ Box::Box(float X, float Y, float W, float H, int ch)
     channel = ch;
 }
 
-bool Box::LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22)
+bool Box::LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22) const
 {
     PointD r = (p12 - p11);
     PointD s = (p22 - p21);
@@ -71,7 +72,7 @@ bool Box::LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22
 
 
 
-bool Box::isWaveFormInside(SorterSpikePtr so)
+bool Box::isSegmentInside(PointD Pwave1, PointD Pwave2) const
 {
     PointD BoxTopLeft(x, y);
     PointD BoxBottomLeft(x, (y - h));
@@ -79,6 +80,16 @@ bool Box::isWaveFormInside(SorterSpikePtr so)
     PointD BoxTopRight(x + w, y);
     PointD BoxBottomRight(x + w, (y - h));
 
+    bool bLeft = LineSegmentIntersection(Pwave1,Pwave2,BoxTopLeft,BoxBottomLeft) ;
+    bool bRight = LineSegmentIntersection(Pwave1,Pwave2,BoxTopRight,BoxBottomRight);
+    bool bTop = LineSegmentIntersection(Pwave1,Pwave2,BoxTopLeft,BoxTopRight);
+    bool bBottom = LineSegmentIntersection(Pwave1, Pwave2, BoxBottomLeft, BoxBottomRight);
+
+    return bLeft || bRight || bTop || bBottom;
+}
+
+bool Box::isWaveFormInside(SorterSpikePtr so) const
+{
     // y and h are given in microvolts
     // x and w and given in microseconds
 
@@ -91,11 +102,7 @@ bool Box::isWaveFormInside(SorterSpikePtr so)
         PointD Pwave1(so->spikeTimeBinToMicrosecond(pt), so->spikeDataBinToMicrovolts(pt, channel));
         PointD Pwave2(so->spikeTimeBinToMicrosecond(pt+1), so->spikeDataBinToMicrovolts(pt+1, channel));
 
-        bool bLeft = LineSegmentIntersection(Pwave1,Pwave2,BoxTopLeft,BoxBottomLeft) ;
-        bool bRight = LineSegmentIntersection(Pwave1,Pwave2,BoxTopRight,BoxBottomRight);
-        bool bTop = LineSegmentIntersection(Pwave1,Pwave2,BoxTopLeft,BoxTopRight);
-        bool bBottom = LineSegmentIntersection(Pwave1, Pwave2, BoxBottomLeft, BoxBottomRight);
-        if (bLeft || bRight || bTop || bBottom)
+        if (isSegmentInside(Pwave1, Pwave2))
         {
             return true;
         }
@@ -104,55 +111,109 @@ bool Box::isWaveFormInside(SorterSpikePtr so)
     return false;
 }
 
+CompiledBox::CompiledBox(const Box& box_, const SpikeChannelDescriptor& channel_)
+    : box(box_), channel(channel_), offset(0), binLeft(0), binRight(0)
+{
+    // same conversions as Box::isWaveFormInside
+    if (box.channel >= 0 && box.channel < channel.numChannels && channel.numSamples > 1)
+    {
+        offset = box.channel * channel.numSamples;
+        binLeft = channel.microSecondsToTimeBin(box.x);
+        binRight = channel.microSecondsToTimeBin(box.x + box.w);
+    }
 
-BoxUnit::BoxUnit(Box B, int id) 
-    : unitId(id), isActive(false)
+    for (int pt = binLeft; pt <= binRight; pt++)
+        binTimes.push_back(channel.timeBinToMicroseconds(pt));
+
+    const float top = float(box.y);
+    const float bottom = float(box.y - box.h);
+
+    lower = std::min(top, bottom);
+    upper = std::max(top, bottom);
+    tolerance = 1e-4f * (1.0f + std::max(fabs(lower), fabs(upper)));
+}
+
+bool CompiledBox::isCompiledFor(const SpikeChannelDescriptor& other) const
 {
-    addBox(B);
+    return channel.numChannels == other.numChannels
+        && channel.numSamples == other.numSamples
+        && channel.sampleRate == other.sampleRate;
 }
 
-BoxUnit::BoxUnit(int id) 
-    : unitId(id), isActive(false)
+bool CompiledBox::isWaveFormInside(const SorterSpikeContainer& so) const
 {
+    if (binRight <= binLeft)
+        return false;
 
-    setDefaultColors(colorRGB, unitId);
+    const float* samples = so.getData() + offset;
 
-    Box B(50, -20, 300, 40);
-    
-    addBox(B);
-}
+    float minimum = samples[binLeft];
+    float maximum = samples[binLeft];
 
+    for (int pt = binLeft + 1; pt <= binRight; pt++)
+    {
+        minimum = std::min(minimum, samples[pt]);
+        maximum = std::max(maximum, samples[pt]);
+    }
 
-void BoxUnit::setDefaultColors(uint8_t col[3], int id)
-{
-    int IDmodule = (id - 1) % 8; // ID can't be zero
-    
-    const int colors[8][3] =
+    // a segment that stays this far above or below the box can't reach an edge, even after rounding
+    const float margin = tolerance + 1e-5f * (maximum - minimum);
+    const float above = upper + margin;
+    const float below = lower - margin;
+
+    if (minimum > above || maximum < below)
+        return false;
+
+    for (int pt = binLeft; pt < binRight; pt++)
     {
-        {255,224,93},
-        {255,178,99},
-        {255,109,161},
-        {246,102,255},
-        {175,98,255},
-        {90,241,233},
-        {109,175,136},
-        {160,237,181}
-    };
-
-    col[0] = colors[IDmodule][0];
-    col[1] = colors[IDmodule][1];
-    col[2] = colors[IDmodule][2];
+        const float v1 = samples[pt];
+        const float v2 = samples[pt + 1];
+
+        if ((v1 > above && v2 > above) || (v1 < below && v2 < below))
+            continue;
+
+        if (box.isSegmentInside(PointD(binTimes[pt - binLeft], v1), PointD(binTimes[pt - binLeft + 1], v2)))
+            return true;
+    }
+
+    return false;
 }
 
-void BoxUnit::updateColor()
+
+BoxUnit::BoxUnit()
 {
-    setDefaultColors(colorRGB, unitId);
 }
 
+BoxUnit::BoxUnit(Box B, int id) 
+    : SortedUnit(id)
+{
+    addBox(B);
+}
 
-bool BoxUnit::isWaveFormInsideAllBoxes(SorterSpikePtr so)
+BoxUnit::BoxUnit(int id) 
+    : SortedUnit(id)
 {
+    Box B(50, -20, 300, 40);
     
+    addBox(B);
+}
+
+
+bool BoxUnit::isWaveFormInsideAllBoxes(SorterSpikePtr so) const
+{
+    if (compiledBoxes.size() > 0
+        && compiledBoxes.size() == lstBoxes.size()
+        && compiledBoxes[0].isCompiledFor(so->getChannel()))
+    {
+        for (auto& box : compiledBoxes)
+        {
+            if (!box.isWaveFormInside(*so))
+                return false;
+        }
+
+        return true;
+    }
+
     for (int k = 0; k < lstBoxes.size(); k++)
     {
         if (!lstBoxes[k].isWaveFormInside(so))
@@ -188,11 +249,13 @@ void BoxUnit::toggleActive()
 
 void BoxUnit::addBox(Box b)
 {
+    compiledBoxes.clear();
     lstBoxes.push_back(b);
 }
 
 void BoxUnit::addBox()
 {
+    compiledBoxes.clear();
     Box B(50 + 350 * lstBoxes.size(), -20 - unitId * 20, 300, 40);
     lstBoxes.push_back(B);
 }
@@ -204,12 +267,14 @@ int BoxUnit::getNumBoxes()
 
 void BoxUnit::modifyBox(int boxindex, Box b)
 {
+    compiledBoxes.clear();
     lstBoxes[boxindex] = b;
 }
 
 
 bool BoxUnit::deleteBox(int boxindex)
 {
+    compiledBoxes.clear();
 
     if (lstBoxes.size() > boxindex)
     {
@@ -226,6 +291,7 @@ Box BoxUnit::getBox(int box)
 
 void BoxUnit::setBox(int boxid, Box B)
 {
+    compiledBoxes.clear();
     lstBoxes[boxid].x = B.x;
     lstBoxes[boxid].y = B.y;
     lstBoxes[boxid].w = B.w;
@@ -235,18 +301,21 @@ void BoxUnit::setBox(int boxid, Box B)
 
 void BoxUnit::setBoxPos(int boxid, PointD P)
 {
+    compiledBoxes.clear();
     lstBoxes[boxid].x = P.X;
     lstBoxes[boxid].y = P.Y;
 }
 
 void BoxUnit::setBoxSize(int boxid, double W, double H)
 {
+    compiledBoxes.clear();
     lstBoxes[boxid].w = W;
     lstBoxes[boxid].h = H;
 }
 
 void BoxUnit::moveBox(int boxid, int dx, int dy)
 {
+    compiledBoxes.clear();
     lstBoxes[boxid].x += dx;
     lstBoxes[boxid].y += dy;
 }
@@ -256,12 +325,10 @@ std::vector<Box> BoxUnit::getBoxes()
     return lstBoxes;
 }
 
-int BoxUnit::getUnitId()
+void BoxUnit::compile(const SpikeChannelDescriptor& channel)
 {
-    return unitId;
-}
+    compiledBoxes.clear();
 
-void BoxUnit::updateWaveform(SorterSpikePtr so)
-{
-    stats.update(so);
+    for (auto& box : lstBoxes)
+        compiledBoxes.push_back(CompiledBox(box, channel));
 }
@@ -24,15 +24,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __BOX_UNIT_H
 #define __BOX_UNIT_H
 
-#include <ProcessorHeaders.h>
-
 #include "Containers.h"
-#include "WaveformStats.h"
+#include "SortedUnit.h"
 
 #include <algorithm>    // std::sort
+#include <vector>
 #include <list>
 #include <queue>
 #include <atomic>
+#include <memory>
 
 /** 
     Represents a Box in waveform amplitude space
@@ -51,10 +51,13 @@ public:
     Box(float X, float Y, float W, float H, int ch=0);
 
     /** Returns true if a line segment is inside the box */
-    bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22);
+    bool LineSegmentIntersection(PointD p11, PointD p12, PointD p21, PointD p22) const;
+
+    /** Returns true if a waveform segment (microseconds, microvolts) crosses one of the box's edges */
+    bool isSegmentInside(PointD Pwave1, PointD Pwave2) const;
 
     /** Returns true if a waveform is inside the box */
-    bool isWaveFormInside(SorterSpikePtr so);
+    bool isWaveFormInside(SorterSpikePtr so) const;
 
     /** Microseconds */
     double x, w;
@@ -66,6 +69,47 @@ public:
     int channel;
 };
 
+/**
+    A Box converted to sample bins for one channel layout
+
+    The conversion from microseconds to bins only depends on the box and
+    the electrode, so it is done when the box is edited rather than for
+    every spike. A spike is then rejected by a min/max scan over the samples
+    under the box; only segments that come near the box's amplitude range
+    go through Box::isSegmentInside, so the answer is the same as
+    Box::isWaveFormInside.
+*/
+class CompiledBox
+{
+public:
+
+    /** Constructor */
+    CompiledBox(const Box& box, const SpikeChannelDescriptor& channel);
+
+    /** Returns true if this box was compiled for spikes with the same shape and sample rate */
+    bool isCompiledFor(const SpikeChannelDescriptor& channel) const;
+
+    /** Returns true if a waveform is inside the box */
+    bool isWaveFormInside(const SorterSpikeContainer& so) const;
+
+private:
+
+    Box box;
+    SpikeChannelDescriptor channel;
+
+    /** Index of the box's channel in the waveform */
+    int offset;
+
+    /** Segments from binLeft to binRight are tested */
+    int binLeft, binRight;
+
+    /** Amplitude range of the box, and the margin below which rounding could change the answer */
+    float lower, upper, tolerance;
+
+    /** Time (microseconds) of each bin from binLeft to binRight */
+    std::vector<float> binTimes;
+};
+
 
 /** 
 
@@ -73,12 +117,12 @@ public:
     by multiple boxes across different channels
 
 */
-class BoxUnit
+class BoxUnit : public SortedUnit
 {
 public:
 
     /** Default constructor */
-    BoxUnit() { }
+    BoxUnit();
 
     /** Constructor based on unit ID*/
     BoxUnit(int id);
@@ -87,10 +131,10 @@ public:
     BoxUnit(Box B, int id);
 
     /** Returns true if spike waveform is inside all boxes*/
-    bool isWaveFormInsideAllBoxes(SorterSpikePtr so);
+    bool isWaveFormInsideAllBoxes(SorterSpikePtr so) const;
 
-    /** Returns the global ID for this unit */
-    int getUnitId();
+    /** Converts the boxes for spikes from a particular electrode (see CompiledBox) */
+    void compile(const SpikeChannelDescriptor& channel);
 
     /** Returns the local ID for this unit */
     int getLocalId();
@@ -140,29 +184,11 @@ public:
     /** Returns a vector of boxes for this unit */
     std::vector<Box> getBoxes();
     
-    /** Adds a new waveform to this unit's stats counter */
-	void updateWaveform(SorterSpikePtr so);
-
-    /** Sets the color for this unit */
-    static void setDefaultColors(uint8_t col[3], int ID);
-
-    /** Changes the unit color after the ID is updated */
-    void updateColor();
-
-    /** Identifier for this unit (global across the Spike Sorter)*/
-    int unitId;
-
     /** Vector of boxes for this unit */
     std::vector<Box> lstBoxes;
 
-    /** RGB color for this unit */
-    uint8_t colorRGB[3];
-    
-    /** Ongoing stats for this unit (not currently used) */
-    WaveformStats stats;
-    
-    /** True if the unit is active */
-    bool isActive;
+    /** Boxes converted by compile() (cleared when the boxes are changed through this class) */
+    std::vector<CompiledBox> compiledBoxes;
 
 };
 
@@ -0,0 +1,241 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#include "ClusterIsolation.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Iterations of the incomplete gamma series and continued fraction */
+static const int maxGammaIterations = 200;
+static const double gammaTolerance = 1e-12;
+
+ClusterIsolation::ClusterIsolation(int dim_)
+    : dim(std::min(std::max(1, dim_), maxDimension))
+{
+}
+
+void ClusterIsolation::addSpike(const float* x, int unit)
+{
+    features.insert(features.end(), x, x + dim);
+    labels.push_back(unit);
+
+    if (unit < 0)
+        return;
+
+    if (unit >= (int) units.size())
+        units.resize(unit + 1);
+
+    Accumulator& acc = units[unit];
+    acc.count++;
+
+    double delta[maxDimension];
+
+    for (int i = 0; i < dim; i++)
+    {
+        delta[i] = x[i] - acc.mean[i];
+        acc.mean[i] += delta[i] / acc.count;
+    }
+
+    // co-moment update: the old deviation times the new one
+    for (int i = 0; i < dim; i++)
+        for (int j = 0; j <= i; j++)
+            acc.m2[i * maxDimension + j] += delta[i] * (x[j] - acc.mean[j]);
+}
+
+bool ClusterIsolation::getWhitening(const Accumulator& unit, double* whitening) const
+{
+    double factor[maxDimension * maxDimension] = {};
+
+    // Cholesky factor of the covariance
+    for (int i = 0; i < dim; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            double sum = unit.m2[i * maxDimension + j] / (unit.count - 1);
+
+            for (int k = 0; k < j; k++)
+                sum -= factor[i * maxDimension + k] * factor[j * maxDimension + k];
+
+            if (i == j)
+            {
+                if (sum <= 0)
+                    return false;
+
+                factor[i * maxDimension + i] = std::sqrt(sum);
+            }
+            else
+            {
+                factor[i * maxDimension + j] = sum / factor[j * maxDimension + j];
+            }
+        }
+    }
+
+    // inverse of the (lower triangular) factor, one column at a time
+    std::fill(whitening, whitening + maxDimension * maxDimension, 0.0);
+
+    for (int j = 0; j < dim; j++)
+    {
+        whitening[j * maxDimension + j] = 1.0 / factor[j * maxDimension + j];
+
+        for (int i = j + 1; i < dim; i++)
+        {
+            double sum = 0;
+
+            for (int k = j; k < i; k++)
+                sum -= factor[i * maxDimension + k] * whitening[k * maxDimension + j];
+
+            whitening[i * maxDimension + j] = sum / factor[i * maxDimension + i];
+        }
+    }
+
+    return true;
+}
+
+void ClusterIsolation::compute(int numUnits, std::vector<UnitIsolation>& results) const
+{
+    results.assign(numUnits, UnitIsolation());
+
+    const int numSpikes = getNumSpikes();
+    const double logGammaHalfDof = std::lgamma(0.5 * dim);
+
+    std::vector<double> otherDistances;
+
+    for (int u = 0; u < numUnits && u < (int) units.size(); u++)
+    {
+        const Accumulator& unit = units[u];
+        results[u].numSpikes = unit.count;
+
+        double whitening[maxDimension * maxDimension];
+
+        if (unit.count < minSpikes(dim) || !getWhitening(unit, whitening))
+            continue;
+
+        otherDistances.clear();
+
+        for (int s = 0; s < numSpikes; s++)
+        {
+            if (labels[s] == u)
+                continue;
+
+            const float* x = features.data() + size_t(s) * dim;
+
+            double centered[maxDimension];
+
+            for (int i = 0; i < dim; i++)
+                centered[i] = x[i] - unit.mean[i];
+
+            // squared length of the whitened spike
+            double distance = 0;
+
+            for (int i = 0; i < dim; i++)
+            {
+                double w = 0;
+
+                for (int k = 0; k <= i; k++)
+                    w += whitening[i * maxDimension + k] * centered[k];
+
+                distance += w * w;
+            }
+
+            otherDistances.push_back(distance);
+        }
+
+        double sum = 0;
+
+        for (double distance : otherDistances)
+            sum += chiSquareSurvival(distance, dim, logGammaHalfDof);
+
+        results[u].lRatio = float(sum / unit.count);
+
+        if ((int) otherDistances.size() >= unit.count)
+        {
+            std::nth_element(otherDistances.begin(), otherDistances.begin() + (unit.count - 1), otherDistances.end());
+            results[u].isolationDistance = float(otherDistances[unit.count - 1]);
+        }
+    }
+}
+
+double ClusterIsolation::chiSquareSurvival(double x, int dof)
+{
+    return chiSquareSurvival(x, dof, std::lgamma(0.5 * dof));
+}
+
+double ClusterIsolation::chiSquareSurvival(double x, int dof, double logGammaHalfDof)
+{
+    if (x <= 0)
+        return 1.0;
+
+    // regularized upper incomplete gamma Q(dof / 2, x / 2)
+    const double a = 0.5 * dof;
+    const double z = 0.5 * x;
+    const double logPrefactor = a * std::log(z) - z - logGammaHalfDof;
+
+    if (z < a + 1)
+    {
+        // series for the lower function P
+        double term = 1.0 / a;
+        double sum = term;
+
+        for (int n = 1; n < maxGammaIterations; n++)
+        {
+            term *= z / (a + n);
+            sum += term;
+
+            if (std::abs(term) < std::abs(sum) * gammaTolerance)
+                break;
+        }
+
+        return std::max(0.0, 1.0 - sum * std::exp(logPrefactor));
+    }
+
+    // continued fraction for Q (modified Lentz)
+    const double tiny = 1e-300;
+
+    double b = z + 1 - a;
+    double c = 1.0 / tiny;
+    double d = 1.0 / b;
+    double h = d;
+
+    for (int n = 1; n < maxGammaIterations; n++)
+    {
+        const double an = -n * (n - a);
+        b += 2;
+
+        d = an * d + b;
+        if (std::abs(d) < tiny)
+            d = tiny;
+
+        c = b + an / c;
+        if (std::abs(c) < tiny)
+            c = tiny;
+
+        d = 1.0 / d;
+        const double delta = d * c;
+        h *= delta;
+
+        if (std::abs(delta - 1.0) < gammaTolerance)
+            break;
+    }
+
+    return std::min(1.0, std::exp(logPrefactor) * h);
+}
@@ -0,0 +1,112 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __CLUSTERISOLATION_H
+#define __CLUSTERISOLATION_H
+
+#include <vector>
+
+/** Isolation of one unit from the other spikes of its electrode (see ClusterIsolation) */
+struct UnitIsolation
+{
+    int unitId = 0;
+
+    /** Spikes of the unit among the evaluated ones */
+    int numSpikes = 0;
+
+    /** Squared Mahalanobis distance of the numSpikes-th closest other spike (negative if unknown) */
+    float isolationDistance = -1;
+
+    /** Expected fraction of other spikes per unit spike that belong to the unit (negative if unknown) */
+    float lRatio = -1;
+};
+
+/**
+
+    Isolation distance and L-ratio of units in PC space
+    (Schmitzer-Torbert et al., 2005)
+
+    Spikes are added one at a time with the index of the unit they fall
+    in (or -1). The mean and covariance of each unit are accumulated as
+    they arrive (Welford), so compute() starts from finished estimates.
+    compute() then factors each covariance once and whitens every spike
+    against it, giving all squared Mahalanobis distances for both metrics
+    in O(numUnits * numSpikes * dim^2).
+
+    A unit needs minSpikes(dim) spikes and a positive definite covariance;
+    its isolation distance also needs at least as many other spikes as it
+    has itself.
+
+*/
+class ClusterIsolation
+{
+public:
+
+    /** Constructor (dim features per spike, at most maxDimension) */
+    ClusterIsolation(int dim);
+
+    /** Adds the features of a spike, and the index of its unit (-1 for none) */
+    void addSpike(const float* features, int unit);
+
+    /** Computes the metrics of units 0 to numUnits - 1 (results[i].unitId is left to the caller) */
+    void compute(int numUnits, std::vector<UnitIsolation>& results) const;
+
+    /** Returns the number of spikes added */
+    int getNumSpikes() const { return (int) labels.size(); }
+
+    /** Returns P(X > x) for a chi-square variable with dof degrees of freedom */
+    static double chiSquareSurvival(double x, int dof);
+
+    /** Fewest spikes a unit needs for its covariance to be estimated */
+    static int minSpikes(int dim) { return 2 * dim + 2; }
+
+    /** Largest number of features per spike */
+    static const int maxDimension = 8;
+
+private:
+
+    /** Running mean and sum of squared deviations (lower triangle) of one unit */
+    struct Accumulator
+    {
+        int count = 0;
+        double mean[maxDimension] = {};
+        double m2[maxDimension * maxDimension] = {};
+    };
+
+    /**
+        Inverts the Cholesky factor of a unit's covariance into whitening (lower triangle)
+
+        Returns false if the covariance is not positive definite.
+    */
+    bool getWhitening(const Accumulator& unit, double* whitening) const;
+
+    /** chiSquareSurvival() with log(Gamma(dof / 2)) computed by the caller (once per unit) */
+    static double chiSquareSurvival(double x, int dof, double logGammaHalfDof);
+
+    int dim;
+
+    std::vector<float> features;
+    std::vector<int> labels;
+    std::vector<Accumulator> units;
+};
+
+#endif // __CLUSTERISOLATION_H
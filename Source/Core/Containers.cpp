@@ -0,0 +1,251 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Containers.h"
+
+#include <algorithm>
+#include <cstring>
+
+PointD::PointD()
+{
+    X = Y = 0;
+}
+
+PointD::PointD(float x, float y)
+{
+    X = x;
+    Y = y;
+}
+
+PointD::PointD(const PointD& P)
+{
+    X = P.X;
+    Y = P.Y;
+}
+
+PointD& PointD::operator+=(const PointD& rhs)
+{
+    X += rhs.X;
+    Y += rhs.Y;
+    return *this;
+}
+
+PointD& PointD::operator-=(const PointD& rhs)
+{
+    X -= rhs.X;
+    Y -= rhs.Y;
+    return *this;
+}
+
+const PointD PointD::operator+(const PointD& other) const
+{
+    PointD result = *this;
+    result += other;
+    return result;
+}
+
+const PointD PointD::operator-(const PointD& other) const
+{
+    PointD result = *this;
+    result -= other;
+    return result;
+}
+
+const PointD PointD::operator*(const PointD& other) const
+{
+    PointD result = *this;
+    result.X *= other.X;
+    result.Y *= other.Y;
+    return result;
+
+}
+
+float PointD::cross(PointD c) const
+{
+    return X * c.Y - Y * c.X;
+}
+
+
+SorterSpikeContainer::SorterSpikeContainer(const SpikeDescriptor& spike)
+    : sortedId(spike.sortedId),
+      timestamp(spike.timestamp),
+      chan(*spike.channel)
+{
+    color[0] = color[1] = color[2] = 127;
+    std::fill(pcProj, pcProj + maxProjections, 0.0f);
+    basisVersion = 0;
+
+    dimension = chan.getDimension();
+
+    ownedData.assign(spike.waveform, spike.waveform + dimension);
+    data = ownedData.data();
+
+}
+
+SorterSpikeContainer::SorterSpikeContainer(float* storage)
+    : sortedId(0),
+      timestamp(0),
+      data(storage),
+      dimension(0)
+{
+    color[0] = color[1] = color[2] = 127;
+    std::fill(pcProj, pcProj + maxProjections, 0.0f);
+    basisVersion = 0;
+}
+
+void SorterSpikeContainer::reset(const SpikeDescriptor& spike)
+{
+    chan = *spike.channel;
+    sortedId = spike.sortedId;
+    timestamp = spike.timestamp;
+
+    color[0] = color[1] = color[2] = 127;
+    std::fill(pcProj, pcProj + maxProjections, 0.0f);
+    basisVersion = 0;
+
+    dimension = chan.getDimension();
+
+    memcpy(data, spike.waveform, dimension * sizeof(float));
+}
+
+const float* SorterSpikeContainer::getData() const
+{
+    return data;
+}
+
+const SpikeChannelDescriptor& SorterSpikeContainer::getChannel() const
+{
+    return chan;
+}
+
+int64_t SorterSpikeContainer::getTimestamp() const
+{
+    return timestamp;
+}
+
+float SorterSpikeContainer::getMinimum(int channelIndex)
+{
+    int offset = channelIndex * chan.numSamples + chan.prePeakSamples + 1;
+
+    return data[offset];
+}
+
+float SorterSpikeContainer::getMaximum(int channelIndex)
+{
+    int offset = channelIndex * chan.numSamples;
+
+    float maximum = -99999.9f;
+
+    for (int i = offset; i < offset + chan.numSamples; i++)
+    {
+        if (data[i] > maximum)
+            maximum = data[i];
+    }
+
+    return maximum;
+}
+
+bool SorterSpikeContainer::checkThresholds(const float* thresholds, int numThresholds)
+{
+
+    bool belowThresh = true;
+
+    for (int i = 0; i < numThresholds; i++)
+    {
+        belowThresh &= getMinimum(i) < thresholds[i];
+    }
+
+    return belowThresh;
+}
+
+
+SorterSpikePool::SorterSpikePool(int samplesPerSpike_, int slotsPerSlab_)
+    : samplesPerSpike(samplesPerSpike_),
+      slotsPerSlab(slotsPerSlab_),
+      nextSlot(0),
+      numPoolAllocations(0)
+{
+    addSlab();
+}
+
+void SorterSpikePool::addSlab()
+{
+    float* slab = new float[size_t(slotsPerSlab) * samplesPerSpike];
+    slabs.emplace_back(slab);
+
+    slots.reserve(slots.size() + slotsPerSlab);
+
+    for (int i = 0; i < slotsPerSlab; i++)
+    {
+        slots.push_back(std::make_shared<SorterSpikeContainer>(slab + size_t(i) * samplesPerSpike));
+    }
+
+    // one allocation for the waveform slab, one per container, and one for the slot array
+    numPoolAllocations += slotsPerSlab + 2;
+}
+
+SorterSpikePtr SorterSpikePool::getNextSpike(const SpikeDescriptor& spike)
+{
+    if (spike.channel->getDimension() != samplesPerSpike)
+    {
+        // waveform doesn't fit in our slots; fall back to a regular allocation
+        numPoolAllocations += 2;
+        return std::make_shared<SorterSpikeContainer>(spike);
+    }
+
+    const int numSlots = (int) slots.size();
+
+    for (int i = 0; i < numSlots; i++)
+    {
+        int slot = (nextSlot + i) % numSlots;
+
+        const SorterSpikePtr& container = slots[slot];
+
+        // the pool holds the only reference, so this slot is free
+        if (container.use_count() == 1)
+        {
+            nextSlot = (slot + 1) % numSlots;
+            container->reset(spike);
+            return container;
+        }
+    }
+
+    // all slots are in use
+    addSlab();
+
+    const SorterSpikePtr& container = slots[numSlots];
+    nextSlot = (numSlots + 1) % (int) slots.size();
+    container->reset(spike);
+
+    return container;
+}
+
+int SorterSpikePool::getNumSlots() const
+{
+    return (int) slots.size();
+}
+
+int64_t SorterSpikePool::getNumPoolAllocations() const
+{
+    return numPoolAllocations;
+}
@@ -0,0 +1,282 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CONTAINERS_H__
+#define __CONTAINERS_H__
+
+#include "SpikeDescriptors.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifndef MAX
+#define MAX(x,y)((x)>(y))?(x):(y)
+#endif
+
+#ifndef MIN
+#define MIN(x,y)((x)<(y))?(x):(y)
+#endif
+
+/**
+    Heap-allocated array whose first element is aligned to a cache line
+
+    Only suitable for trivially copyable element types.
+*/
+template <typename ElementType>
+class AlignedHeapBlock
+{
+public:
+
+    /** Default constructor (no storage) */
+    AlignedHeapBlock() : data(nullptr), numElements(0) { }
+
+    /** Constructor with a number of zeroed elements */
+    explicit AlignedHeapBlock(size_t numElements_) : data(nullptr), numElements(0)
+    {
+        allocate(numElements_);
+    }
+
+    /** Frees the old storage and allocates a new, zeroed block */
+    void allocate(size_t numElements_)
+    {
+        numElements = numElements_;
+        storage.reset(new char[numElements * sizeof(ElementType) + alignment]());
+        data = reinterpret_cast<ElementType*>((reinterpret_cast<uintptr_t>(storage.get()) + alignment - 1)
+                                              & ~uintptr_t(alignment - 1));
+    }
+
+    /** Returns a pointer to the first (aligned) element */
+    ElementType* getData() const noexcept { return data; }
+
+    /** Returns the number of elements in this block */
+    size_t size() const noexcept { return numElements; }
+
+    operator ElementType*() const noexcept { return data; }
+
+    /** Alignment of the first element, in bytes */
+    static const size_t alignment = 64;
+
+    AlignedHeapBlock(const AlignedHeapBlock&) = delete;
+    AlignedHeapBlock& operator=(const AlignedHeapBlock&) = delete;
+
+private:
+    std::unique_ptr<char[]> storage;
+    ElementType* data;
+    size_t numElements;
+};
+
+/** 
+    Represents a point in 2D space
+*/
+class PointD
+{
+public:
+
+    /** Default constructor */
+    PointD();
+
+    /** Constructor with X/Y location*/
+    PointD(float x, float y);
+
+    /** Copy constructor */
+    PointD(const PointD& P);
+
+    /** Overload "+" operator */
+    const PointD operator+(const PointD& c1) const;
+
+    /** Overload "+= operator */
+    PointD& operator+=(const PointD& rhs);
+
+    /** Overload "-=" operator */
+    PointD& operator-=(const PointD& rhs);
+
+    /** Overload "-" operator */
+    const PointD operator-(const PointD& c1) const;
+
+    /** Overload "*" operator */
+    const PointD operator*(const PointD& c1) const;
+
+    /** Cross-product with another point */
+    float cross(PointD c) const;
+
+    /** X and Y coordinates*/
+    float X, Y;
+};
+
+/** 
+    Holds data about an individual spike
+*/
+class SorterSpikeContainer
+{
+public:
+
+    /** Constructor (copies the waveform data) */
+    SorterSpikeContainer(const SpikeDescriptor& spike);
+
+    /** Constructor for a pooled container, whose waveform storage is owned by a SorterSpikePool */
+    SorterSpikeContainer(float* storage);
+
+    /** Delete default constructor */
+    SorterSpikeContainer() = delete;
+
+    /** Re-initializes this container with a new spike (copies the waveform data) */
+    void reset(const SpikeDescriptor& spike);
+
+    /** Return a pointer to the spike waveform data*/
+    const float* getData() const;
+
+    /** Return the number of waveform values (channels x samples) */
+    int getDimension() const { return dimension; }
+
+    /** Return a description of the channel this spike came from */
+    const SpikeChannelDescriptor& getChannel() const;
+
+    /** Return the timestamp of this spike*/
+    int64_t getTimestamp() const;
+
+    /** Returns the minimum value of this spike's waveform on a particular channel*/
+    float getMinimum(int chan = 0);
+
+    /** Returns the maximum value of this spike's waveform on a particular channel*/
+    float getMaximum(int chan = 0);
+
+    /** Check that the minimum is below all thresholds (one per channel) */
+    bool checkThresholds(const float* thresholds, int numThresholds);
+
+    /** Spike color (RGB) */
+    uint8_t color[3];
+
+    /** Largest number of PC projections per spike */
+    static const int maxProjections = 8;
+
+    /** PC projections (as many as the basis has components; the first two are X/Y)*/
+    float pcProj[maxProjections];
+
+    /** Version of the PC basis used for pcProj (0 if the spike has not been projected) */
+    int basisVersion;
+
+    /** Sorted ID (> 0) */
+    uint16_t sortedId;
+
+    /** Helper function to find the microvolts value at a given bin for one channel*/
+    float spikeDataBinToMicrovolts(int bin, int ch)
+    {
+        assert(ch >= 0 && ch < chan.numChannels);
+        assert(bin >= 0 && bin <= chan.numSamples);
+
+        float v = getData()[bin + ch * chan.numSamples];
+
+        return v;
+    }
+
+    /** Helper function to find the microvolts value at a given index*/
+    float spikeDataIndexToMicrovolts(int index)
+    {
+        float v = getData()[index];
+        return v;
+    }
+
+    /** Helper function to find the microsecond value at a given bin for one channel*/
+    float spikeTimeBinToMicrosecond(int bin, int ch = 0)
+    {
+        return chan.timeBinToMicroseconds(bin);
+    }
+
+    /** Helper function to convert from microseconds to a time bin*/
+    int microSecondsToSpikeTimeBin(float t, int ch = 0)
+    {
+        // t = 0 corresponds to the left-most index.
+        return chan.microSecondsToTimeBin(t);
+    }
+
+private:
+    int64_t timestamp;
+    float* data;
+    int dimension;
+    std::vector<float> ownedData;
+    SpikeChannelDescriptor chan;
+};
+
+/** Reference-counted pointer to a spike container*/
+typedef std::shared_ptr<SorterSpikeContainer> SorterSpikePtr;
+
+/**
+    Per-electrode pool of pre-allocated spike containers
+
+    Waveform storage is carved out of contiguous slabs of fixed-size slots.
+    A slot is recycled as soon as the pool holds the only remaining reference
+    to it, so the steady-state sort path does not touch the heap. New slabs
+    are only allocated while the number of live spikes is still growing.
+
+    Must only be accessed from the processing thread; spikes handed out by
+    the pool must not outlive it.
+*/
+class SorterSpikePool
+{
+public:
+
+    /** Constructor */
+    SorterSpikePool(int samplesPerSpike, int slotsPerSlab = 256);
+
+    /** Destructor */
+    ~SorterSpikePool() { }
+
+    /** Returns a container holding a copy of the incoming spike */
+    SorterSpikePtr getNextSpike(const SpikeDescriptor& spike);
+
+    /** Returns the total number of slots currently allocated */
+    int getNumSlots() const;
+
+    /**
+        Returns the number of allocations the pool made for its own slots since it was created
+
+        Only slabs, containers and fallback copies are counted; allocations
+        made elsewhere on the sort path are not (sort_path_benchmark counts
+        every allocation of BM_SortPath).
+    */
+    int64_t getNumPoolAllocations() const;
+
+    SorterSpikePool(const SorterSpikePool&) = delete;
+    SorterSpikePool& operator=(const SorterSpikePool&) = delete;
+
+private:
+
+    /** Allocates another slab of slots */
+    void addSlab();
+
+    int samplesPerSpike;
+    int slotsPerSlab;
+    int nextSlot;
+
+    std::vector<SorterSpikePtr> slots;
+    std::vector<std::unique_ptr<float[]>> slabs;
+
+    std::atomic<int64_t> numPoolAllocations;
+};
+
+
+#endif  // __CONTAINERS_H__
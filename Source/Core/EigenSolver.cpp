@@ -0,0 +1,679 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EigenSolver.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+std::unique_ptr<EigenSolver> EigenSolver::create(Type type)
+{
+    switch (type)
+    {
+        case SVD_REFERENCE: return std::unique_ptr<EigenSolver>(new SvdEigenSolver());
+        default: return std::unique_ptr<EigenSolver>(new SubspaceIterationEigenSolver());
+    }
+}
+
+/*
+  An implementation of SVD from Numerical Recipes in C and Mike Erhdmann's lectures
+*/
+
+#define SIGN(a,b) ((b) > 0.0 ? fabs(a) : - fabs(a))
+
+static thread_local double maxarg1, maxarg2;
+#define FMAX(a,b) (maxarg1 = (a),maxarg2 = (b),(maxarg1) > (maxarg2) ? (maxarg1) : (maxarg2))
+
+static thread_local int iminarg1, iminarg2;
+#define IMIN(a,b) (iminarg1 = (a),iminarg2 = (b),(iminarg1 < (iminarg2) ? (iminarg1) : iminarg2))
+
+static thread_local double sqrarg;
+#define SQR(a) ((sqrarg = (a)) == 0.0 ? 0.0 : sqrarg * sqrarg)
+
+
+// calculates sqrt( a^2 + b^2 ) with decent precision
+float SvdEigenSolver::pythag(float a, float b)
+{
+    float absa,absb;
+
+    absa = fabs(a);
+    absb = fabs(b);
+
+    if (absa > absb)
+        return (absa * sqrt(1.0 + SQR(absb/absa)));
+    else
+        return (absb == 0.0 ? 0.0 : absb * sqrt(1.0 + SQR(absa / absb)));
+}
+
+/*
+  Modified from Numerical Recipes in C
+  Given a matrix a[nRows][nCols], svdcmp() computes its singular value
+  decomposition, A = U * W * Vt.  A is replaced by U when svdcmp
+  returns.  The diagonal matrix W is output as a vector w[nCols].
+  V (not V transpose) is output as the matrix V[nCols][nCols].
+*/
+int SvdEigenSolver::svdcmp(float** a, int nRows, int nCols, float* w, float** v)
+{
+
+    int flag, i, its, j, jj, k, l = 0, nm = 0;
+    float anorm, c, f, g, h, s, scale, x, y, z, *rv1;
+
+    rv1 = new float[nCols];
+    if (rv1 == NULL)
+    {
+        printf("svdcmp(): Unable to allocate vector\n");
+        return (-1);
+    }
+
+    g = scale = anorm = 0.0;
+    for (i = 0; i < nCols; i++)
+    {
+        l = i+1;
+        rv1[i] = scale*g;
+        g = s = scale = 0.0;
+        if (i < nRows)
+        {
+            for (k = i; k < nRows; k++)
+            {
+                //std::cout << k << " " << i << std::endl;
+                scale += fabs(a[k][i]);
+            }
+
+            if (scale)
+            {
+                for (k = i; k < nRows; k++)
+                {
+                    a[k][i] /= scale;
+                    s += a[k][i] * a[k][i];
+                }
+                f = a[i][i];
+                g = -SIGN(sqrt(s),f);
+                h = f * g - s;
+                a[i][i] = f - g;
+
+                for (j = l; j < nCols; j++)
+                {
+                    for (s = 0.0, k = i; k < nRows; k++) s += a[k][i] * a[k][j];
+                    f = s / h;
+                    for (k = i; k < nRows; k++) a[k][j] += f * a[k][i];
+                }
+
+                for (k = i; k < nRows; k++)
+                    a[k][i] *= scale;
+            } // end if (scale)
+        } // end if (i < nRows)
+        w[i] = scale * g;
+        g = s = scale = 0.0;
+        if (i < nRows && i != nCols-1)
+        {
+            for (k = l; k < nCols; k++) scale += fabs(a[i][k]);
+            if (scale)
+            {
+                for (k = l; k < nCols; k++)
+                {
+                    a[i][k] /= scale;
+                    s += a[i][k] * a[i][k];
+                }
+                f = a[i][l];
+                g = - SIGN(sqrt(s),f);
+                h = f * g - s;
+                a[i][l] = f - g;
+                for (k=l; k<nCols; k++) rv1[k] = a[i][k] / h;
+                for (j=l; j<nRows; j++)
+                {
+                    for (s=0.0,k=l; k<nCols; k++) s += a[j][k] * a[i][k];
+                    for (k=l; k<nCols; k++) a[j][k] += s * rv1[k];
+                }
+                for (k=l; k<nCols; k++) a[i][k] *= scale;
+            }
+        }
+        anorm = FMAX(anorm, (fabs(w[i]) + fabs(rv1[i])));
+
+
+    }
+
+    for (i=nCols-1; i>=0; i--)
+    {
+        if (i < nCols-1)
+        {
+            if (g)
+            {
+                for (j=l; j<nCols; j++)
+                    v[j][i] = (a[i][j] / a[i][l]) / g;
+                for (j=l; j<nCols; j++)
+                {
+                    for (s=0.0,k=l; k<nCols; k++) s += a[i][k] * v[k][j];
+                    for (k=l; k<nCols; k++) v[k][j] += s * v[k][i];
+                }
+            }
+            for (j=l; j<nCols; j++) v[i][j] = v[j][i] = 0.0;
+        }
+        v[i][i] = 1.0;
+        g = rv1[i];
+        l = i;
+    }
+
+    for (i=IMIN(nRows,nCols) - 1; i >= 0; i--)
+    {
+        l = i + 1;
+        g = w[i];
+        for (j=l; j<nCols; j++) a[i][j] = 0.0;
+        if (g)
+        {
+            g = 1.0 / g;
+            for (j=l; j<nCols; j++)
+            {
+                for (s=0.0,k=l; k<nRows; k++) s += a[k][i] * a[k][j];
+                f = (s / a[i][i]) * g;
+                for (k=i; k<nRows; k++) a[k][j] += f * a[k][i];
+            }
+            for (j=i; j<nRows; j++) a[j][i] *= g;
+        }
+        else
+            for (j=i; j<nRows; j++) a[j][i] = 0.0;
+        ++a[i][i];
+    }
+
+    for (k=nCols-1; k>=0; k--)
+    {
+        for (its=0; its<30; its++)
+        {
+            flag = 1;
+            for (l=k; l>=0; l--)
+            {
+                nm = l-1;
+                if ((fabs(rv1[l]) + anorm) == anorm)
+                {
+                    flag =  0;
+                    break;
+                }
+                if ((fabs(w[nm]) + anorm) == anorm) break;
+            }
+            if (flag)
+            {
+                c = 0.0;
+                s = 1.0;
+                for (i=l; i<=k; i++)
+                {
+                    f = s * rv1[i];
+                    rv1[i] = c * rv1[i];
+                    if ((fabs(f) + anorm) == anorm) break;
+                    g = w[i];
+                    h = pythag(f,g);
+                    w[i] = h;
+                    h = 1.0 / h;
+                    c = g * h;
+                    s = -f * h;
+                    for (j=0; j<nRows; j++)
+                    {
+                        y = a[j][nm];
+                        z = a[j][i];
+                        a[j][nm] = y * c + z * s;
+                        a[j][i] = z * c - y * s;
+                    }
+                }
+            }
+            z = w[k];
+            if (l == k)
+            {
+                if (z < 0.0)
+                {
+                    w[k] = -z;
+                    for (j=0; j<nCols; j++) v[j][k] = -v[j][k];
+                }
+                break;
+            }
+            //if(its == 29) printf("no convergence in 30 svdcmp iterations\n");
+            x = w[l];
+            nm = k-1;
+            y = w[nm];
+            g = rv1[nm];
+            h = rv1[k];
+            f = ((y - z) * (y + z) + (g - h) * (g + h)) / (2.0 * h * y);
+            g = pythag(f,1.0);
+            f = ((x - z) * (x + z) + h * ((y / (f + SIGN(g,f))) - h)) / x;
+            c = s = 1.0;
+            for (j=l; j<=nm; j++)
+            {
+                i = j+1;
+                g = rv1[i];
+                y = w[i];
+                h = s * g;
+                g = c * g;
+                z = pythag(f,h);
+                rv1[j] = z;
+                c = f/z;
+                s = h/z;
+                f = x * c + g * s;
+                g = g * c - x * s;
+                h = y * s;
+                y *= c;
+                for (jj=0; jj<nCols; jj++)
+                {
+                    x = v[jj][j];
+                    z = v[jj][i];
+                    v[jj][j] = x * c + z * s;
+                    v[jj][i] = z * c - x * s;
+                }
+                z = pythag(f,h);
+                w[j] = z;
+                if (z)
+                {
+                    z = 1.0 / z;
+                    c = f * z;
+                    s = h * z;
+                }
+                f = c * g + s * y;
+                x = c * y - s * g;
+                for (jj=0; jj < nRows; jj++)
+                {
+                    y = a[jj][j];
+                    z = a[jj][i];
+                    a[jj][j] = y * c + z * s;
+                    a[jj][i] = z * c - y * s;
+                }
+            }
+            rv1[l] = 0.0;
+            rv1[k] = f;
+            w[k] = x;
+        }
+    }
+
+    delete[] rv1;
+
+    return (0);
+}
+
+
+void SvdEigenSolver::computeTopK(const float* matrix, int dim, int ld, int k,
+                                 float* eigenvalues, float* eigenvectors)
+{
+    // svdcmp works in place on separate rows
+    std::vector<float> aData(size_t(dim) * dim), vData(size_t(dim) * dim, 0.0f), w(dim);
+    std::vector<float*> a(dim), v(dim);
+
+    for (int i = 0; i < dim; i++)
+    {
+        a[i] = aData.data() + size_t(i) * dim;
+        v[i] = vData.data() + size_t(i) * dim;
+
+        std::copy(matrix + size_t(i) * ld, matrix + size_t(i) * ld + dim, a[i]);
+    }
+
+    svdcmp(a.data(), dim, dim, w.data(), v.data());
+
+    std::vector<int> order(dim);
+
+    for (int i = 0; i < dim; i++)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&w](int i1, int i2) { return w[i1] > w[i2]; });
+
+    for (int i = 0; i < k; i++)
+    {
+        eigenvalues[i] = w[order[i]];
+
+        for (int j = 0; j < dim; j++)
+            eigenvectors[size_t(i) * dim + j] = v[j][order[i]];
+    }
+}
+
+/**************************/
+/* Subspace iteration     */
+/**************************/
+
+/**
+    Cyclic Jacobi eigendecomposition of a small symmetric (n x n) matrix
+
+    a is destroyed; column j of vectors holds the eigenvector of values[j].
+*/
+static void jacobiEigen(std::vector<double>& a, int n, std::vector<double>& values, std::vector<double>& vectors)
+{
+    vectors.assign(size_t(n) * n, 0.0);
+
+    for (int i = 0; i < n; i++)
+        vectors[size_t(i) * n + i] = 1.0;
+
+    for (int sweep = 0; sweep < 100; sweep++)
+    {
+        double offDiagonal = 0, diagonal = 0;
+
+        for (int p = 0; p < n; p++)
+        {
+            diagonal += a[size_t(p) * n + p] * a[size_t(p) * n + p];
+
+            for (int q = p + 1; q < n; q++)
+                offDiagonal += a[size_t(p) * n + q] * a[size_t(p) * n + q];
+        }
+
+        if (offDiagonal <= 1e-30 * diagonal || offDiagonal == 0)
+            break;
+
+        for (int p = 0; p < n - 1; p++)
+        {
+            for (int q = p + 1; q < n; q++)
+            {
+                const double apq = a[size_t(p) * n + q];
+
+                if (apq == 0)
+                    continue;
+
+                const double theta = (a[size_t(q) * n + q] - a[size_t(p) * n + p]) / (2 * apq);
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                const double c = 1 / std::sqrt(t * t + 1);
+                const double s = t * c;
+
+                for (int i = 0; i < n; i++)
+                {
+                    const double aip = a[size_t(i) * n + p], aiq = a[size_t(i) * n + q];
+                    a[size_t(i) * n + p] = c * aip - s * aiq;
+                    a[size_t(i) * n + q] = s * aip + c * aiq;
+                }
+
+                for (int i = 0; i < n; i++)
+                {
+                    const double api = a[size_t(p) * n + i], aqi = a[size_t(q) * n + i];
+                    a[size_t(p) * n + i] = c * api - s * aqi;
+                    a[size_t(q) * n + i] = s * api + c * aqi;
+                }
+
+                for (int i = 0; i < n; i++)
+                {
+                    const double vip = vectors[size_t(i) * n + p], viq = vectors[size_t(i) * n + q];
+                    vectors[size_t(i) * n + p] = c * vip - s * viq;
+                    vectors[size_t(i) * n + q] = s * vip + c * viq;
+                }
+            }
+        }
+    }
+
+    values.resize(n);
+
+    for (int i = 0; i < n; i++)
+        values[i] = a[size_t(i) * n + i];
+}
+
+/** Flips an eigenvector so that its largest component is positive (makes the output deterministic) */
+static void normalizeSign(float* vector, int dim)
+{
+    int largest = 0;
+
+    for (int j = 1; j < dim; j++)
+    {
+        if (std::fabs(vector[j]) > std::fabs(vector[largest]))
+            largest = j;
+    }
+
+    if (vector[largest] < 0)
+    {
+        for (int j = 0; j < dim; j++)
+            vector[j] = -vector[j];
+    }
+}
+
+/**
+    A block of column vectors, stored as (dim x projectionWidth) panels
+    so that products with the matrix can use SimdKernels::projectBatch
+*/
+class VectorBlock
+{
+public:
+
+    VectorBlock(int dim, int numColumns)
+        : panelStride(size_t((dim + 1) & ~1) * SimdKernels::projectionWidth),
+          storage(panelStride * (numColumns / SimdKernels::projectionWidth) + 16, 0.0f)
+    {
+        // panels start on 64-byte boundaries
+        data = reinterpret_cast<float*>((reinterpret_cast<uintptr_t>(storage.data()) + 63) & ~uintptr_t(63));
+    }
+
+    float& operator()(int row, int column)
+    {
+        const int W = SimdKernels::projectionWidth;
+        return data[(column / W) * panelStride + size_t(row) * W + column % W];
+    }
+
+    float* getPanel(int panel) { return data + panel * panelStride; }
+
+private:
+    size_t panelStride;
+    std::vector<float> storage;
+    float* data;
+};
+
+/** Gram-Schmidt with re-orthogonalization; columns that vanish are replaced by random vectors */
+static void orthonormalize(VectorBlock& Q, int dim, int numColumns, std::mt19937& rng)
+{
+    std::normal_distribution<float> gaussian;
+    std::vector<double> v(dim);
+
+    for (int c = 0; c < numColumns; c++)
+    {
+        for (int attempt = 0; attempt < 4; attempt++)
+        {
+            double initialNorm = 0;
+
+            for (int j = 0; j < dim; j++)
+            {
+                v[j] = Q(j, c);
+                initialNorm += v[j] * v[j];
+            }
+
+            for (int pass = 0; pass < 2; pass++)
+            {
+                for (int d = 0; d < c; d++)
+                {
+                    double r = 0;
+
+                    for (int j = 0; j < dim; j++)
+                        r += Q(j, d) * v[j];
+
+                    for (int j = 0; j < dim; j++)
+                        v[j] -= r * Q(j, d);
+                }
+            }
+
+            double norm = 0;
+
+            for (int j = 0; j < dim; j++)
+                norm += v[j] * v[j];
+
+            if (norm > 1e-12 * initialNorm && norm > 0)
+            {
+                const double scale = 1 / std::sqrt(norm);
+
+                for (int j = 0; j < dim; j++)
+                    Q(j, c) = float(v[j] * scale);
+
+                break;
+            }
+
+            // this direction is (numerically) spanned by the previous columns
+            for (int j = 0; j < dim; j++)
+                Q(j, c) = gaussian(rng);
+        }
+    }
+}
+
+SubspaceIterationEigenSolver::SubspaceIterationEigenSolver(float tolerance_, int maxIterations_)
+    : tolerance(tolerance_),
+      maxIterations(maxIterations_),
+      numIterations(0)
+{
+}
+
+void SubspaceIterationEigenSolver::computeTopK(const float* matrix, int dim, int ld, int k,
+                                               float* eigenvalues, float* eigenvectors)
+{
+    const int W = SimdKernels::projectionWidth;
+
+    // a few extra vectors speed up convergence of the leading ones
+    const int blockSize = (k + 4 + W - 1) / W * W;
+
+    numIterations = 0;
+
+    if (dim <= blockSize)
+    {
+        // small enough to decompose directly
+        std::vector<double> a(size_t(dim) * dim), values, vectors;
+
+        for (int i = 0; i < dim; i++)
+            for (int j = 0; j < dim; j++)
+                a[size_t(i) * dim + j] = matrix[size_t(i) * ld + j];
+
+        jacobiEigen(a, dim, values, vectors);
+
+        std::vector<int> order(dim);
+
+        for (int i = 0; i < dim; i++)
+            order[i] = i;
+
+        std::sort(order.begin(), order.end(), [&values](int i1, int i2) { return values[i1] > values[i2]; });
+
+        for (int i = 0; i < k; i++)
+        {
+            eigenvalues[i] = i < dim ? float(values[order[i]]) : 0.0f;
+
+            for (int j = 0; j < dim; j++)
+                eigenvectors[size_t(i) * dim + j] = i < dim ? float(vectors[size_t(j) * dim + order[i]]) : 0.0f;
+
+            normalizeSign(eigenvectors + size_t(i) * dim, dim);
+        }
+
+        return;
+    }
+
+    const int numPanels = blockSize / W;
+
+    std::vector<const float*> rows(dim);
+
+    for (int i = 0; i < dim; i++)
+        rows[i] = matrix + size_t(i) * ld;
+
+    VectorBlock Q(dim, blockSize), Z(dim, blockSize), rotatedQ(dim, blockSize), rotatedZ(dim, blockSize);
+
+    // random start; a fixed seed makes repeated jobs on the same data agree
+    std::mt19937 rng(12345);
+    std::normal_distribution<float> gaussian;
+
+    for (int j = 0; j < dim; j++)
+        for (int c = 0; c < blockSize; c++)
+            Q(j, c) = gaussian(rng);
+
+    orthonormalize(Q, dim, blockSize, rng);
+
+    std::vector<double> T(size_t(blockSize) * blockSize), values, vectors;
+    std::vector<int> order(blockSize);
+
+    for (int iteration = 0; iteration < maxIterations; iteration++)
+    {
+        numIterations = iteration + 1;
+
+        // 1. Z = A Q
+        for (int p = 0; p < numPanels; p++)
+            SimdKernels::projectBatch(rows.data(), dim, dim, Q.getPanel(p), Z.getPanel(p));
+
+        // 2. Rayleigh-Ritz: eigendecomposition of T = Q^T A Q
+        for (int a = 0; a < blockSize; a++)
+        {
+            for (int b = a; b < blockSize; b++)
+            {
+                double sum = 0;
+
+                for (int j = 0; j < dim; j++)
+                    sum += double(Q(j, a)) * Z(j, b) + double(Q(j, b)) * Z(j, a);
+
+                T[size_t(a) * blockSize + b] = T[size_t(b) * blockSize + a] = sum / 2;
+            }
+        }
+
+        jacobiEigen(T, blockSize, values, vectors);
+
+        for (int i = 0; i < blockSize; i++)
+            order[i] = i;
+
+        std::sort(order.begin(), order.end(), [&values](int i1, int i2) { return values[i1] > values[i2]; });
+
+        // 3. rotate the block onto the Ritz vectors (rotatedZ = A rotatedQ)
+        for (int j = 0; j < dim; j++)
+        {
+            for (int c = 0; c < blockSize; c++)
+            {
+                double q = 0, z = 0;
+
+                for (int b = 0; b < blockSize; b++)
+                {
+                    const double v = vectors[size_t(b) * blockSize + order[c]];
+                    q += Q(j, b) * v;
+                    z += Z(j, b) * v;
+                }
+
+                rotatedQ(j, c) = float(q);
+                rotatedZ(j, c) = float(z);
+            }
+        }
+
+        // 4. converged once the k leading residuals || A q - theta q || are small
+        double maxResidual = 0;
+
+        for (int i = 0; i < k; i++)
+        {
+            double residual = 0;
+
+            for (int j = 0; j < dim; j++)
+            {
+                const double r = rotatedZ(j, i) - values[order[i]] * rotatedQ(j, i);
+                residual += r * r;
+            }
+
+            // relative to each eigenvalue, but not below what float products can resolve
+            const double bound = std::max(tolerance * std::fabs(values[order[i]]), 1e-6 * std::fabs(values[order[0]]));
+
+            maxResidual = std::max(maxResidual, std::sqrt(residual) / bound);
+        }
+
+        if (maxResidual <= 1.0 || iteration == maxIterations - 1)
+        {
+            for (int i = 0; i < k; i++)
+            {
+                eigenvalues[i] = float(values[order[i]]);
+
+                for (int j = 0; j < dim; j++)
+                    eigenvectors[size_t(i) * dim + j] = rotatedQ(j, i);
+
+                normalizeSign(eigenvectors + size_t(i) * dim, dim);
+            }
+
+            return;
+        }
+
+        // 5. next block: orthonormalized A Q
+        std::swap(Q, rotatedZ);
+        orthonormalize(Q, dim, blockSize, rng);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __EIGENSOLVER_H
+#define __EIGENSOLVER_H
+
+#include <memory>
+
+/**
+
+    Computes the leading eigenpairs of a symmetric, positive semi-definite
+    matrix (e.g. the covariance of a PCA training set)
+
+    Matrices are row-major with a row stride of ld floats. Eigenvalues are
+    returned in decreasing order; eigenvector i is written to row i of a
+    (k x dim) matrix. Like SimdKernels, solvers only depend on the
+    standard library.
+
+*/
+class EigenSolver
+{
+public:
+
+    enum Type
+    {
+        SVD_REFERENCE = 0,   // full Numerical Recipes SVD (slow, kept as a reference)
+        SUBSPACE_ITERATION   // block power iteration with Rayleigh-Ritz, top k only
+    };
+
+    /** Destructor */
+    virtual ~EigenSolver() { }
+
+    /** Computes the k leading eigenvalues and eigenvectors of a (dim x dim) matrix */
+    virtual void computeTopK(const float* matrix, int dim, int ld, int k,
+                             float* eigenvalues, float* eigenvectors) = 0;
+
+    /** Returns a readable name for this solver */
+    virtual const char* getName() const = 0;
+
+    /** Creates a solver of a given type */
+    static std::unique_ptr<EigenSolver> create(Type type);
+};
+
+/**
+    Reference solver: full singular value decomposition (Golub-Kahan, from
+    Numerical Recipes in C), followed by sorting all singular values
+*/
+class SvdEigenSolver : public EigenSolver
+{
+public:
+
+    void computeTopK(const float* matrix, int dim, int ld, int k,
+                     float* eigenvalues, float* eigenvectors) override;
+
+    const char* getName() const override { return "SVD"; }
+
+    /** Computes A = U * W * Vt for a[nRows][nCols]; A is replaced by U */
+    static int svdcmp(float** a, int nRows, int nCols, float* w, float** v);
+
+private:
+    static float pythag(float a, float b);
+};
+
+/**
+    Randomized subspace iteration for the top k eigenpairs
+
+    Iterates on a block of SimdKernels::projectionWidth (or more) vectors,
+    so that each product with the matrix runs through the projection
+    kernel. Each iteration costs O(dim^2 * blockSize), instead of the
+    O(dim^3) of a full decomposition. Converges when the residual of each
+    of the k leading Ritz pairs drops below tolerance * its eigenvalue (or
+    below the resolution of float products, for very small eigenvalues).
+*/
+class SubspaceIterationEigenSolver : public EigenSolver
+{
+public:
+
+    /** Constructor */
+    SubspaceIterationEigenSolver(float tolerance = 1e-5f, int maxIterations = 200);
+
+    void computeTopK(const float* matrix, int dim, int ld, int k,
+                     float* eigenvalues, float* eigenvectors) override;
+
+    const char* getName() const override { return "subspace iteration"; }
+
+    /** Returns the number of iterations used by the last call */
+    int getNumIterations() const { return numIterations; }
+
+private:
+    float tolerance;
+    int maxIterations;
+    int numIterations;
+};
+
+#endif // __EIGENSOLVER_H
@@ -0,0 +1,260 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "EllipsoidUnit.h"
+
+/** Index of element (i, j), j <= i, of a lower triangular matrix packed by rows */
+static inline int packedIndex(int i, int j)
+{
+    return i * (i + 1) / 2 + j;
+}
+
+static const double twoPi = 6.283185307179586;
+
+EllipsoidUnit::EllipsoidUnit()
+    : basisVersion(0), numComponents(0), radius(0)
+{
+}
+
+EllipsoidUnit::EllipsoidUnit(int id)
+    : SortedUnit(id), basisVersion(0), numComponents(0), radius(0)
+{
+}
+
+bool EllipsoidUnit::fit(const float* points, int numPoints, int n)
+{
+    if (n < 1 || n > SorterSpikeContainer::maxProjections || numPoints < minPoints(n))
+        return false;
+
+    std::vector<double> mean(n, 0.0);
+    std::vector<double> cov(size_t(n) * n, 0.0);
+
+    for (int p = 0; p < numPoints; p++)
+    {
+        for (int i = 0; i < n; i++)
+            mean[i] += points[size_t(p) * n + i];
+    }
+
+    for (int i = 0; i < n; i++)
+        mean[i] /= numPoints;
+
+    for (int p = 0; p < numPoints; p++)
+    {
+        const float* point = points + size_t(p) * n;
+
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j <= i; j++)
+                cov[i * n + j] += (point[i] - mean[i]) * (point[j] - mean[j]);
+        }
+    }
+
+    double trace = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j <= i; j++)
+            cov[i * n + j] /= numPoints - 1;
+
+        trace += cov[i * n + i];
+    }
+
+    // keeps flat directions (e.g. a component that is almost constant within the unit) invertible
+    const double ridge = 1e-6 * trace / n + 1e-12;
+
+    for (int i = 0; i < n; i++)
+        cov[i * n + i] += ridge;
+
+    std::vector<float> factor(size_t(n) * (n + 1) / 2);
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j <= i; j++)
+        {
+            double sum = cov[i * n + j];
+
+            for (int k = 0; k < j; k++)
+                sum -= double(factor[packedIndex(i, k)]) * factor[packedIndex(j, k)];
+
+            if (i == j)
+            {
+                if (!(sum > 0))
+                    return false;
+
+                factor[packedIndex(i, i)] = float(std::sqrt(sum));
+            }
+            else
+            {
+                factor[packedIndex(i, j)] = float(sum / factor[packedIndex(j, j)]);
+            }
+        }
+    }
+
+    EllipsoidUnit fitted(*this);
+
+    fitted.numComponents = n;
+    fitted.center.assign(mean.begin(), mean.end());
+    fitted.cholesky = factor;
+    fitted.radius = defaultRadius(n);
+
+    if (!fitted.updateWhitening())
+        return false;
+
+    *this = fitted;
+
+    return true;
+}
+
+bool EllipsoidUnit::updateWhitening()
+{
+    const int n = numComponents;
+
+    if (n < 1 || n > SorterSpikeContainer::maxProjections
+        || center.size() != size_t(n) || cholesky.size() != size_t(n) * (n + 1) / 2)
+        return false;
+
+    std::vector<float> inverse(cholesky.size());
+
+    for (int i = 0; i < n; i++)
+    {
+        const double diagonal = cholesky[packedIndex(i, i)];
+
+        if (!(diagonal > 0))
+            return false;
+
+        inverse[packedIndex(i, i)] = float(1.0 / diagonal);
+
+        for (int j = 0; j < i; j++)
+        {
+            double sum = 0;
+
+            for (int k = j; k < i; k++)
+                sum += double(cholesky[packedIndex(i, k)]) * inverse[packedIndex(k, j)];
+
+            inverse[packedIndex(i, j)] = float(-sum / diagonal);
+        }
+    }
+
+    whitening = inverse;
+
+    return true;
+}
+
+float EllipsoidUnit::getDistanceSquared(const float* proj) const
+{
+    float diff[SorterSpikeContainer::maxProjections];
+    float sum = 0;
+
+    const float* row = whitening.data();
+
+    for (int i = 0; i < numComponents; i++)
+    {
+        diff[i] = proj[i] - center[i];
+
+        float z = 0;
+
+        for (int j = 0; j <= i; j++)
+            z += row[j] * diff[j];
+
+        sum += z * z;
+        row += i + 1;
+    }
+
+    return sum;
+}
+
+bool EllipsoidUnit::isPointInside(const float* proj) const
+{
+    if (numComponents == 0)
+        return false;
+
+    const float limit = radius * radius;
+
+    float diff[SorterSpikeContainer::maxProjections];
+    float sum = 0;
+
+    const float* row = whitening.data();
+
+    // every term is positive, so most spikes of other units are rejected after a component or two
+    for (int i = 0; i < numComponents; i++)
+    {
+        diff[i] = proj[i] - center[i];
+
+        float z = 0;
+
+        for (int j = 0; j <= i; j++)
+            z += row[j] * diff[j];
+
+        sum += z * z;
+
+        if (sum > limit)
+            return false;
+
+        row += i + 1;
+    }
+
+    return true;
+}
+
+bool EllipsoidUnit::isWaveFormInside(SorterSpikePtr so) const
+{
+    return isPointInside(so->pcProj);
+}
+
+std::vector<PointD> EllipsoidUnit::getContour(int numVertices) const
+{
+    std::vector<PointD> contour;
+
+    if (numComponents < 2)
+        return contour;
+
+    // the marginal of the first two components: center + L11 (r cos t, r sin t)
+    const double l11 = cholesky[packedIndex(0, 0)];
+    const double l21 = cholesky[packedIndex(1, 0)];
+    const double l22 = cholesky[packedIndex(1, 1)];
+
+    for (int v = 0; v < numVertices; v++)
+    {
+        const double t = twoPi * v / numVertices;
+        const double u = radius * std::cos(t);
+        const double w = radius * std::sin(t);
+
+        contour.push_back(PointD(float(center[0] + l11 * u),
+                                 float(center[1] + l21 * u + l22 * w)));
+    }
+
+    return contour;
+}
+
+float EllipsoidUnit::defaultRadius(int n)
+{
+    const double z = 2.326; // 99% quantile of the standard normal
+    const double h = 2.0 / (9.0 * std::max(1, n));
+    const double c = 1.0 - h + z * std::sqrt(h);
+
+    return float(std::sqrt(n * c * c * c));
+}
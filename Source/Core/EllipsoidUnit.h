@@ -0,0 +1,117 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __ELLIPSOID_UNIT_H
+#define __ELLIPSOID_UNIT_H
+
+#include "Containers.h"
+#include "SortedUnit.h"
+
+#include <memory>
+#include <vector>
+
+/**
+    A unit defined by an ellipsoid in principal component space
+
+    Unlike a PCAUnit polygon, which only looks at the first two
+    projections, the ellipsoid uses every component of the basis (3 up to
+    PCABasis::maxComponents). A spike belongs to the unit if its
+    Mahalanobis distance to the center is at most radius.
+
+    The ellipsoid is fitted to a set of projections (usually the spikes
+    inside a drawn polygon). The inverse of the Cholesky factor of their
+    covariance is kept, so the test is one triangular matrix-vector
+    product, which stops as soon as the partial sum is out of the radius.
+*/
+class EllipsoidUnit : public SortedUnit
+{
+public:
+
+    /** Default constructor */
+    EllipsoidUnit();
+
+    /** Constructor based on unit ID */
+    EllipsoidUnit(int id);
+
+    /**
+        Fits the ellipsoid to numPoints projections of numComponents values each
+
+        The radius is set to defaultRadius(numComponents). Returns false (and
+        leaves the unit unchanged) if there are fewer than minPoints(numComponents)
+        points or their covariance is degenerate.
+    */
+    bool fit(const float* points, int numPoints, int numComponents);
+
+    /**
+        Recomputes whitening after center, cholesky and numComponents were set (e.g. when loading)
+
+        Returns false if the factor has the wrong size or is singular.
+    */
+    bool updateWhitening();
+
+    /** Returns the number of components the ellipsoid is defined in (0 until fitted) */
+    int getNumComponents() const { return numComponents; }
+
+    /** Returns the squared Mahalanobis distance of a projection to the center */
+    float getDistanceSquared(const float* proj) const;
+
+    /** Returns true if a projection is within the radius */
+    bool isPointInside(const float* proj) const;
+
+    /** Returns true if the spike's projection is within the radius (the caller checks the basis version) */
+    bool isWaveFormInside(SorterSpikePtr so) const;
+
+    /** Returns the outline of the ellipsoid projected on the PC1/PC2 plane */
+    std::vector<PointD> getContour(int numVertices = 32) const;
+
+    /**
+        Mahalanobis radius that holds 99% of a Gaussian cluster in n dimensions
+
+        (Wilson-Hilferty approximation of the chi-square quantile)
+    */
+    static float defaultRadius(int n);
+
+    /** Smallest number of points accepted by fit() */
+    static int minPoints(int n) { return 2 * n + 2; }
+
+    /** Version of the PC basis the ellipsoid was fitted in */
+    int basisVersion;
+
+    /** Number of components of the ellipsoid (a prefix of the basis components) */
+    int numComponents;
+
+    /** Center of the ellipsoid */
+    std::vector<float> center;
+
+    /** Lower triangular Cholesky factor of the covariance, packed by rows (n(n+1)/2 values) */
+    std::vector<float> cholesky;
+
+    /** Inverse of the Cholesky factor, packed the same way */
+    std::vector<float> whitening;
+
+    /** Largest Mahalanobis distance of a spike in this unit */
+    float radius;
+};
+
+#endif // __ELLIPSOID_UNIT_H
@@ -0,0 +1,434 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "GaussianMixture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double twoPi = 6.283185307179586;
+
+/** Number of k-means iterations used to seed EM */
+static const int numSeedIterations = 10;
+
+/** EM stops once the mean log-likelihood per point improves by less than this */
+static const double convergenceTolerance = 1e-4;
+
+GaussianMixture::GaussianMixture(int maxComponents_, int maxIterations_)
+    : maxComponents(std::max(1, maxComponents_)),
+      maxIterations(std::max(1, maxIterations_)),
+      bic(std::numeric_limits<double>::infinity()),
+      minVariance(0),
+      rngState(1)
+{
+}
+
+double GaussianMixture::random()
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+
+    return double((rngState * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int GaussianMixture::fit(const float* x, const float* y, int numPoints)
+{
+    components.clear();
+    bic = std::numeric_limits<double>::infinity();
+    points.clear();
+
+    // an evenly spaced subset bounds the cost of each iteration
+    const int numUsed = std::min(numPoints, maxPoints);
+
+    for (int i = 0; i < numUsed; i++)
+    {
+        const int index = int(int64_t(i) * numPoints / numUsed);
+
+        if (std::isfinite(x[index]) && std::isfinite(y[index]))
+        {
+            points.push_back(x[index]);
+            points.push_back(y[index]);
+        }
+    }
+
+    const int n = (int) points.size() / 2;
+
+    if (n < minPointsPerComponent)
+        return 0;
+
+    double meanX = 0, meanY = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        meanX += points[2 * i];
+        meanY += points[2 * i + 1];
+    }
+
+    meanX /= n;
+    meanY /= n;
+
+    double variance = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        const double dx = points[2 * i] - meanX;
+        const double dy = points[2 * i + 1] - meanY;
+        variance += dx * dx + dy * dy;
+    }
+
+    variance /= 2.0 * n;
+
+    // keeps components from collapsing onto a single point
+    minVariance = std::max(1e-4 * variance, 1e-12);
+
+    rngState = 0x9E3779B97F4A7C15ULL;
+
+    int numWorse = 0;
+
+    for (int k = 1; k <= maxComponents && n >= k * minPointsPerComponent; k++)
+    {
+        // EM only finds a local optimum, so each size starts from a few seeds
+        std::vector<Component> model;
+        double logLikelihood = -std::numeric_limits<double>::infinity();
+
+        for (int restart = 0; restart < (k == 1 ? 1 : numRestarts); restart++)
+        {
+            std::vector<Component> candidate;
+
+            initialize(k, candidate);
+
+            const double candidateLikelihood = expectationMaximization(candidate);
+
+            if (candidateLikelihood > logLikelihood)
+            {
+                logLikelihood = candidateLikelihood;
+                model = candidate;
+            }
+        }
+
+        // weight, mean and covariance for each component, minus one weight
+        const int numParameters = 6 * k - 1;
+        const double modelBIC = -2.0 * logLikelihood + numParameters * std::log(double(n));
+
+        if (modelBIC < bic)
+        {
+            bic = modelBIC;
+            components = model;
+            numWorse = 0;
+        }
+        else if (++numWorse == 2)
+        {
+            break; // larger models are unlikely to do better
+        }
+    }
+
+    components.erase(std::remove_if(components.begin(), components.end(),
+                                    [](const Component& c) { return !(c.weight > 0); }),
+                     components.end());
+
+    return (int) components.size();
+}
+
+void GaussianMixture::initialize(int k, std::vector<Component>& model)
+{
+    const int n = (int) points.size() / 2;
+
+    std::vector<double> centers(2 * k);
+    std::vector<double> distance(n, std::numeric_limits<double>::max());
+    std::vector<int> labels(n, 0);
+
+    // k-means++: each new center is drawn with probability proportional to the squared distance
+    int first = std::min(n - 1, int(random() * n));
+
+    centers[0] = points[2 * first];
+    centers[1] = points[2 * first + 1];
+
+    for (int c = 1; c < k; c++)
+    {
+        double total = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            const double dx = points[2 * i] - centers[2 * (c - 1)];
+            const double dy = points[2 * i + 1] - centers[2 * (c - 1) + 1];
+
+            distance[i] = std::min(distance[i], dx * dx + dy * dy);
+            total += distance[i];
+        }
+
+        int chosen = std::min(n - 1, int(random() * n));
+
+        if (total > 0)
+        {
+            double r = random() * total;
+
+            for (int i = 0; i < n; i++)
+            {
+                r -= distance[i];
+
+                if (r <= 0)
+                {
+                    chosen = i;
+                    break;
+                }
+            }
+        }
+
+        centers[2 * c] = points[2 * chosen];
+        centers[2 * c + 1] = points[2 * chosen + 1];
+    }
+
+    std::vector<double> sums(2 * k);
+    std::vector<int> counts(k);
+
+    for (int iteration = 0; iteration <= numSeedIterations; iteration++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            double best = std::numeric_limits<double>::max();
+
+            for (int c = 0; c < k; c++)
+            {
+                const double dx = points[2 * i] - centers[2 * c];
+                const double dy = points[2 * i + 1] - centers[2 * c + 1];
+                const double d = dx * dx + dy * dy;
+
+                if (d < best)
+                {
+                    best = d;
+                    labels[i] = c;
+                }
+            }
+        }
+
+        if (iteration == numSeedIterations)
+            break;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for (int i = 0; i < n; i++)
+        {
+            sums[2 * labels[i]] += points[2 * i];
+            sums[2 * labels[i] + 1] += points[2 * i + 1];
+            counts[labels[i]]++;
+        }
+
+        // empty clusters keep their center
+        for (int c = 0; c < k; c++)
+        {
+            if (counts[c] > 0)
+            {
+                centers[2 * c] = sums[2 * c] / counts[c];
+                centers[2 * c + 1] = sums[2 * c + 1] / counts[c];
+            }
+        }
+    }
+
+    model.assign(k, Component());
+
+    for (int c = 0; c < k; c++)
+    {
+        Component& component = model[c];
+
+        component.weight = 0;
+        component.mean[0] = centers[2 * c];
+        component.mean[1] = centers[2 * c + 1];
+        component.cov[0] = component.cov[1] = component.cov[2] = 0;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        Component& component = model[labels[i]];
+
+        const double dx = points[2 * i] - component.mean[0];
+        const double dy = points[2 * i + 1] - component.mean[1];
+
+        component.weight += 1;
+        component.cov[0] += dx * dx;
+        component.cov[1] += dx * dy;
+        component.cov[2] += dy * dy;
+    }
+
+    for (auto& component : model)
+    {
+        const double count = std::max(1.0, component.weight);
+
+        component.cov[0] = component.cov[0] / count + minVariance;
+        component.cov[1] = component.cov[1] / count;
+        component.cov[2] = component.cov[2] / count + minVariance;
+
+        // an empty cluster still gets a chance in EM
+        component.weight = std::max(component.weight, 1.0) / n;
+    }
+}
+
+double GaussianMixture::expectationMaximization(std::vector<Component>& model)
+{
+    const int n = (int) points.size() / 2;
+    const int k = (int) model.size();
+
+    resp.resize(size_t(n) * k);
+
+    std::vector<double> logNorm(k), inverse(3 * k), logp(k);
+
+    double logLikelihood = -std::numeric_limits<double>::infinity();
+    double previous = logLikelihood;
+
+    for (int iteration = 0; iteration <= maxIterations; iteration++)
+    {
+        // E step
+        for (int c = 0; c < k; c++)
+        {
+            const Component& component = model[c];
+            const double det = component.cov[0] * component.cov[2] - component.cov[1] * component.cov[1];
+
+            if (component.weight > 0 && det > 0)
+            {
+                inverse[3 * c] = component.cov[2] / det;
+                inverse[3 * c + 1] = -component.cov[1] / det;
+                inverse[3 * c + 2] = component.cov[0] / det;
+                logNorm[c] = std::log(component.weight) - std::log(twoPi) - 0.5 * std::log(det);
+            }
+            else
+            {
+                inverse[3 * c] = inverse[3 * c + 1] = inverse[3 * c + 2] = 0;
+                logNorm[c] = -std::numeric_limits<double>::infinity();
+            }
+        }
+
+        logLikelihood = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            double largest = -std::numeric_limits<double>::infinity();
+
+            for (int c = 0; c < k; c++)
+            {
+                const double dx = points[2 * i] - model[c].mean[0];
+                const double dy = points[2 * i + 1] - model[c].mean[1];
+                const double mahalanobis = dx * (inverse[3 * c] * dx + inverse[3 * c + 1] * dy)
+                                         + dy * (inverse[3 * c + 1] * dx + inverse[3 * c + 2] * dy);
+
+                logp[c] = logNorm[c] - 0.5 * mahalanobis;
+                largest = std::max(largest, logp[c]);
+            }
+
+            double sum = 0;
+            double* r = resp.data() + size_t(i) * k;
+
+            for (int c = 0; c < k; c++)
+            {
+                r[c] = std::exp(logp[c] - largest);
+                sum += r[c];
+            }
+
+            for (int c = 0; c < k; c++)
+                r[c] /= sum;
+
+            logLikelihood += largest + std::log(sum);
+        }
+
+        if (iteration == maxIterations || logLikelihood - previous < convergenceTolerance * n)
+            break;
+
+        previous = logLikelihood;
+
+        // M step
+        for (int c = 0; c < k; c++)
+        {
+            Component& component = model[c];
+
+            double total = 0, sumX = 0, sumY = 0;
+
+            for (int i = 0; i < n; i++)
+            {
+                const double r = resp[size_t(i) * k + c];
+
+                total += r;
+                sumX += r * points[2 * i];
+                sumY += r * points[2 * i + 1];
+            }
+
+            if (total < 1e-9)
+            {
+                component.weight = 0;
+                continue;
+            }
+
+            component.weight = total / n;
+            component.mean[0] = sumX / total;
+            component.mean[1] = sumY / total;
+
+            double xx = 0, xy = 0, yy = 0;
+
+            for (int i = 0; i < n; i++)
+            {
+                const double r = resp[size_t(i) * k + c];
+                const double dx = points[2 * i] - component.mean[0];
+                const double dy = points[2 * i + 1] - component.mean[1];
+
+                xx += r * dx * dx;
+                xy += r * dx * dy;
+                yy += r * dy * dy;
+            }
+
+            component.cov[0] = xx / total + minVariance;
+            component.cov[1] = xy / total;
+            component.cov[2] = yy / total + minVariance;
+        }
+    }
+
+    return logLikelihood;
+}
+
+std::vector<PointD> GaussianMixture::getContour(int index, double radius, int numVertices) const
+{
+    std::vector<PointD> contour;
+
+    if (index < 0 || index >= (int) components.size())
+        return contour;
+
+    const Component& component = components[index];
+
+    // mean + L (r cos t, r sin t), with L L^T = cov
+    const double l11 = std::sqrt(component.cov[0]);
+    const double l21 = component.cov[1] / l11;
+    const double l22 = std::sqrt(std::max(0.0, component.cov[2] - l21 * l21));
+
+    for (int v = 0; v < numVertices; v++)
+    {
+        const double t = twoPi * v / numVertices;
+        const double u = radius * std::cos(t);
+        const double w = radius * std::sin(t);
+
+        contour.push_back(PointD(float(component.mean[0] + l11 * u),
+                                 float(component.mean[1] + l21 * u + l22 * w)));
+    }
+
+    return contour;
+}
@@ -0,0 +1,122 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GAUSSIANMIXTURE_H
+#define __GAUSSIANMIXTURE_H
+
+#include "Containers.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+
+    Gaussian mixture model of spike projections in the PC1/PC2 plane
+
+    fit() tries 1 to maxComponents components. Each candidate is seeded
+    with k-means++ (numRestarts times) and a few k-means iterations, then
+    refined with EM
+    (full 2x2 covariances). The candidate with the lowest Bayesian
+    information criterion is kept; the search stops early once two sizes
+    in a row did worse than the best one. The cost is bounded by maxPoints,
+    maxComponents and maxIterations, so a fit takes a few milliseconds
+    whatever the spike rate.
+
+    The random seeds are fixed, so the same points always give the same
+    model.
+
+*/
+class GaussianMixture
+{
+public:
+
+    /** One component of the mixture */
+    struct Component
+    {
+        double weight;
+        double mean[2];
+
+        /** Covariance (xx, xy, yy) */
+        double cov[3];
+    };
+
+    /** Constructor */
+    GaussianMixture(int maxComponents = 6, int maxIterations = 50);
+
+    /**
+        Fits the mixture to numPoints projections
+
+        If there are more than maxPoints, an evenly spaced subset is used.
+        Returns the number of components of the selected model (0 if there
+        are too few points).
+    */
+    int fit(const float* x, const float* y, int numPoints);
+
+    /** Returns the components of the selected model */
+    const std::vector<Component>& getComponents() const { return components; }
+
+    /** Returns the BIC of the selected model */
+    double getBIC() const { return bic; }
+
+    /** Returns numVertices points of the ellipse at a Mahalanobis radius from a component's mean */
+    std::vector<PointD> getContour(int component, double radius, int numVertices = 32) const;
+
+    /** Largest number of points used in a fit */
+    static const int maxPoints = 2000;
+
+    /** Number of k-means++ seeds tried for each number of components */
+    static const int numRestarts = 3;
+
+    /** Fewest points per component (larger models are not tried with less data) */
+    static const int minPointsPerComponent = 10;
+
+private:
+
+    /** Seeds k components with k-means++ followed by a few k-means iterations */
+    void initialize(int k, std::vector<Component>& model);
+
+    /** Runs EM from the seeded components; returns the log-likelihood */
+    double expectationMaximization(std::vector<Component>& model);
+
+    /** Returns a uniform random number in [0, 1) */
+    double random();
+
+    int maxComponents, maxIterations;
+
+    std::vector<Component> components;
+    double bic;
+
+    /** Points of the current fit (x and y interleaved) */
+    std::vector<double> points;
+
+    /** Responsibilities (numPoints x k) */
+    std::vector<double> resp;
+
+    /** Smallest variance, relative to the variance of all points */
+    double minVariance;
+
+    uint64_t rngState;
+};
+
+#endif // __GAUSSIANMIXTURE_H
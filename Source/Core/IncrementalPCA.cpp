@@ -0,0 +1,154 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "IncrementalPCA.h"
+
+#include <algorithm>
+#include <cmath>
+
+IncrementalPCA::IncrementalPCA(int dim_, int numComponents_, float forgettingFactor_)
+    : dim(dim_),
+      numComponents(numComponents_),
+      forgettingFactor(1.0f),
+      numSamples(0),
+      mean(dim_, 0.0),
+      vectors(size_t(numComponents_) * dim_, 0.0),
+      residual(dim_, 0.0)
+{
+    setForgettingFactor(forgettingFactor_);
+}
+
+void IncrementalPCA::setForgettingFactor(float forgettingFactor_)
+{
+    forgettingFactor = std::min(1.0f, std::max(forgettingFactor_, 0.5f));
+}
+
+void IncrementalPCA::initialize(const float* mean_, const float* components, const float* eigenvalues, int64_t numSamples_)
+{
+    numSamples = numSamples_;
+
+    for (int j = 0; j < dim; j++)
+        mean[j] = mean_[j];
+
+    for (int i = 0; i < numComponents; i++)
+    {
+        // vectors carry their eigenvalue as their norm
+        const double scale = std::max(double(eigenvalues[i]), 0.0);
+
+        for (int j = 0; j < dim; j++)
+            vectors[size_t(i) * dim + j] = components[size_t(i) * dim + j] * scale;
+    }
+}
+
+void IncrementalPCA::update(const float* waveform)
+{
+    numSamples++;
+
+    const double w = std::max(1.0 / double(numSamples), 1.0 - double(forgettingFactor));
+
+    for (int j = 0; j < dim; j++)
+    {
+        mean[j] = (1 - w) * mean[j] + w * waveform[j];
+        residual[j] = waveform[j] - mean[j];
+    }
+
+    for (int i = 0; i < numComponents; i++)
+    {
+        double* v = vectors.data() + size_t(i) * dim;
+
+        double norm = 0, dot = 0;
+
+        for (int j = 0; j < dim; j++)
+        {
+            norm += v[j] * v[j];
+            dot += v[j] * residual[j];
+        }
+
+        norm = std::sqrt(norm);
+
+        if (norm == 0)
+        {
+            // first usable sample for this component
+            for (int j = 0; j < dim; j++)
+                v[j] = residual[j];
+
+            return;
+        }
+
+        // v <- (1 - w) v + w (u . v / |v|) u
+        const double gain = w * dot / norm;
+
+        norm = 0;
+        dot = 0;
+
+        for (int j = 0; j < dim; j++)
+        {
+            v[j] = (1 - w) * v[j] + gain * residual[j];
+
+            norm += v[j] * v[j];
+            dot += v[j] * residual[j];
+        }
+
+        if (norm == 0)
+            continue;
+
+        // remove this component from the residual before updating the next one
+        const double deflation = dot / norm;
+
+        for (int j = 0; j < dim; j++)
+            residual[j] -= deflation * v[j];
+    }
+}
+
+void IncrementalPCA::getComponent(int index, float* dest) const
+{
+    const double* v = vectors.data() + size_t(index) * dim;
+
+    double norm = 0;
+
+    for (int j = 0; j < dim; j++)
+        norm += v[j] * v[j];
+
+    const double scale = norm > 0 ? 1 / std::sqrt(norm) : 0;
+
+    for (int j = 0; j < dim; j++)
+        dest[j] = float(v[j] * scale);
+}
+
+float IncrementalPCA::getEigenvalue(int index) const
+{
+    const double* v = vectors.data() + size_t(index) * dim;
+
+    double norm = 0;
+
+    for (int j = 0; j < dim; j++)
+        norm += v[j] * v[j];
+
+    return float(std::sqrt(norm));
+}
+
+void IncrementalPCA::getMean(float* dest) const
+{
+    for (int j = 0; j < dim; j++)
+        dest[j] = float(mean[j]);
+}
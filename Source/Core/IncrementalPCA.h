@@ -0,0 +1,95 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INCREMENTALPCA_H
+#define __INCREMENTALPCA_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+
+    Streaming estimate of the mean and leading principal components
+
+    Implements candid covariance-free incremental PCA (CCIPCA, an Oja-type
+    update that needs no learning rate): each waveform moves the mean and
+    the component vectors towards itself, then is deflated before updating
+    the next component. The norm of each vector tracks its eigenvalue.
+
+    Each new waveform gets a weight of max(1/n, 1 - forgettingFactor), so
+    a factor of 1 gives a plain running estimate, and a factor below 1
+    forgets old spikes with a time constant of 1 / (1 - forgettingFactor)
+    spikes. An update costs O(numComponents x dim).
+
+    Not thread-safe; the owner serializes access.
+
+*/
+class IncrementalPCA
+{
+public:
+
+    /** Constructor */
+    IncrementalPCA(int dim, int numComponents, float forgettingFactor);
+
+    /** Changes the forgetting factor (0 < factor <= 1) */
+    void setForgettingFactor(float forgettingFactor);
+
+    /** Returns the forgetting factor */
+    float getForgettingFactor() const { return forgettingFactor; }
+
+    /**
+        Starts from a batch estimate
+
+        components holds numComponents unit vectors of length dim;
+        numSamples is the size of the batch they were computed from.
+    */
+    void initialize(const float* mean, const float* components, const float* eigenvalues, int64_t numSamples);
+
+    /** Adds one waveform */
+    void update(const float* waveform);
+
+    /** Writes a unit-length copy of a component to dest */
+    void getComponent(int index, float* dest) const;
+
+    /** Returns the current eigenvalue (variance) estimate of a component */
+    float getEigenvalue(int index) const;
+
+    /** Writes the current mean to dest */
+    void getMean(float* dest) const;
+
+    /** Returns the number of waveforms seen so far (including the initial batch) */
+    int64_t getNumSamples() const { return numSamples; }
+
+private:
+
+    int dim;
+    int numComponents;
+    float forgettingFactor;
+    int64_t numSamples;
+
+    std::vector<double> mean;
+    std::vector<double> vectors;
+    std::vector<double> residual;
+};
+
+#endif // __INCREMENTALPCA_H
@@ -0,0 +1,160 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __LOCKFREESNAPSHOT_H
+#define __LOCKFREESNAPSHOT_H
+
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+/**
+
+    Holds an immutable object that writers replace as a whole, and that
+    one real-time reader can use without ever taking a lock.
+
+    The reader pins the current object with a hazard pointer (see ScopedRead).
+    Writers must be serialized by the caller; publish() retires the previous
+    object and frees it once the reader is no longer using it, so memory is
+    never released on the reader's thread.
+
+*/
+template <typename ObjectType>
+class LockFreeSnapshot
+{
+public:
+
+    /** Constructor (takes ownership of the initial object) */
+    LockFreeSnapshot(ObjectType* initialObject)
+        : current(initialObject), hazard(nullptr)
+    {
+    }
+
+    /** Destructor */
+    ~LockFreeSnapshot()
+    {
+        assert(hazard.load() == nullptr);
+
+        for (auto object : retired)
+            delete object;
+
+        delete current.load();
+    }
+
+    LockFreeSnapshot(const LockFreeSnapshot&) = delete;
+    LockFreeSnapshot& operator=(const LockFreeSnapshot&) = delete;
+
+    /** Returns the current object (writer side; caller must hold the writer lock) */
+    const ObjectType* get() const
+    {
+        return current.load(std::memory_order_acquire);
+    }
+
+    /** Replaces the current object (writer side; caller must hold the writer lock) */
+    void publish(ObjectType* newObject)
+    {
+        ObjectType* oldObject = current.exchange(newObject, std::memory_order_seq_cst);
+
+        retired.push_back(oldObject);
+
+        reclaim();
+    }
+
+    /**
+        Pins the current object for the lifetime of this scope (reader side)
+    */
+    class ScopedRead
+    {
+    public:
+
+        /** Constructor */
+        ScopedRead(LockFreeSnapshot& owner_) : owner(owner_), object(owner_.acquire()) { }
+
+        /** Destructor */
+        ~ScopedRead() { owner.release(); }
+
+        const ObjectType& operator*() const noexcept { return *object; }
+        const ObjectType* operator->() const noexcept { return object; }
+        const ObjectType* get() const noexcept { return object; }
+
+        ScopedRead(const ScopedRead&) = delete;
+        ScopedRead& operator=(const ScopedRead&) = delete;
+
+    private:
+        LockFreeSnapshot& owner;
+        const ObjectType* object;
+    };
+
+private:
+
+    const ObjectType* acquire()
+    {
+        ObjectType* object = current.load(std::memory_order_acquire);
+
+        for (;;)
+        {
+            hazard.store(object, std::memory_order_seq_cst);
+
+            // make sure the object wasn't retired before the hazard became visible
+            ObjectType* check = current.load(std::memory_order_seq_cst);
+
+            if (check == object)
+                return object;
+
+            object = check;
+        }
+    }
+
+    void release()
+    {
+        hazard.store(nullptr, std::memory_order_release);
+    }
+
+    void reclaim()
+    {
+        ObjectType* inUse = hazard.load(std::memory_order_seq_cst);
+
+        auto it = retired.begin();
+
+        while (it != retired.end())
+        {
+            if (*it != inUse)
+            {
+                delete *it;
+                it = retired.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    std::atomic<ObjectType*> current;
+    std::atomic<ObjectType*> hazard;
+
+    std::vector<ObjectType*> retired;
+
+};
+
+#endif // __LOCKFREESNAPSHOT_H
@@ -0,0 +1,193 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PCABasis.h"
+
+#include <algorithm>
+
+static_assert(PCABasis::maxComponents <= SorterSpikeContainer::maxProjections, "Spikes can't hold all projections");
+
+PCABasis::PCABasis(int dimension_, int version_, int revision_, int numComponents_)
+    : numTrainingSpikes(0),
+      dimension(dimension_),
+      version(version_),
+      revision(revision_),
+      numComponents(std::min(std::max(numComponents_, int(defaultComponents)), int(maxComponents))),
+      numChannels(1),
+      numLocalChannels(0),
+      peakSample(0),
+      numStoredComponents(numComponents),
+      componentLength(dimension)
+{
+    allocate();
+}
+
+PCABasis::PCABasis(const SpikeChannelDescriptor& channel, int numLocalChannels_, int version_, int numComponents_)
+    : numTrainingSpikes(0),
+      dimension(channel.getDimension()),
+      version(version_),
+      revision(0),
+      numComponents(std::min(std::max(numComponents_, int(defaultComponents)), int(maxComponents))),
+      numChannels(std::max(1, channel.numChannels)),
+      numLocalChannels(std::max(1, clampLocalChannels(numLocalChannels_, numChannels, numComponents))),
+      peakSample(std::min(std::max(channel.prePeakSamples + 1, 0), std::max(channel.numSamples - 1, 0))),
+      componentLength(channel.numSamples)
+{
+    // components per channel, so that the window provides numComponents features
+    numStoredComponents = std::min((numComponents + numLocalChannels - 1) / numLocalChannels, std::max(1, componentLength));
+
+    allocate();
+}
+
+void PCABasis::allocate()
+{
+    components.allocate(size_t(numStoredComponents) * componentLength);
+    mean.allocate(componentLength);
+    projectionMatrix.allocate(size_t(componentLength) * SimdKernels::projectionWidth);
+
+    for (int k = 0; k < componentLength; k++)
+        mean[k] = 0;
+
+    for (size_t k = 0; k < size_t(numStoredComponents) * componentLength; k++)
+        components[k] = 0;
+
+    for (int i = 0; i < maxComponents; i++)
+    {
+        rangeMin[i] = -1;
+        rangeMax[i] = 1;
+        eigenvalues[i] = 0;
+    }
+}
+
+float* PCABasis::getComponent(int index)
+{
+    assert(index >= 0 && index < numStoredComponents);
+
+    return components.getData() + size_t(index) * componentLength;
+}
+
+const float* PCABasis::getComponent(int index) const
+{
+    assert(index >= 0 && index < numStoredComponents);
+
+    return components.getData() + size_t(index) * componentLength;
+}
+
+int PCABasis::clampLocalChannels(int numLocalChannels_, int numChannels_, int numComponents_)
+{
+    if (numLocalChannels_ <= 0)
+        return 0;
+
+    return std::max(1, std::min(numLocalChannels_, std::min(numChannels_, numComponents_)));
+}
+
+int PCABasis::findPeakChannel(const float* waveform) const
+{
+    int peakChannel = 0;
+    float largest = -1;
+
+    // peak-to-peak up to the peak sample, so that channels where the spike is positive rank as well
+    for (int c = 0; c < numChannels; c++)
+    {
+        const float* samples = waveform + size_t(c) * componentLength;
+        float lo = samples[0], hi = samples[0];
+
+        for (int k = 1; k <= peakSample; k++)
+        {
+            lo = std::min(lo, samples[k]);
+            hi = std::max(hi, samples[k]);
+        }
+
+        if (hi - lo > largest)
+        {
+            largest = hi - lo;
+            peakChannel = c;
+        }
+    }
+
+    return peakChannel;
+}
+
+int PCABasis::getFirstLocalChannel(int peakChannel) const
+{
+    return std::min(std::max(peakChannel - (numLocalChannels - 1) / 2, 0), numChannels - numLocalChannels);
+}
+
+void PCABasis::updateProjectionMatrix()
+{
+    const int width = SimdKernels::projectionWidth;
+
+    for (int k = 0; k < componentLength; k++)
+    {
+        float* row = projectionMatrix.getData() + size_t(k) * width;
+
+        for (int j = 0; j < width; j++)
+            row[j] = j < numStoredComponents ? getComponent(j)[k] : 0.0f;
+    }
+}
+
+void PCABasis::project(const float* waveform, float* proj) const
+{
+    float out[SimdKernels::projectionWidth];
+
+    if (numLocalChannels == 0)
+    {
+        SimdKernels::project(waveform, dimension, projectionMatrix, out);
+
+        for (int j = 0; j < numComponents; j++)
+            proj[j] = out[j];
+
+        return;
+    }
+
+    const int firstChannel = getFirstLocalChannel(findPeakChannel(waveform));
+
+    for (int r = 0; r < numLocalChannels; r++)
+    {
+        SimdKernels::project(waveform + size_t(firstChannel + r) * componentLength, componentLength, projectionMatrix, out);
+
+        for (int p = 0; p < numStoredComponents; p++)
+        {
+            const int j = p * numLocalChannels + r;
+
+            if (j < numComponents)
+                proj[j] = out[p];
+        }
+    }
+
+    // only short waveforms run out of components
+    for (int j = numStoredComponents * numLocalChannels; j < numComponents; j++)
+        proj[j] = 0;
+}
+
+void PCABasis::projectBatch(const float* const* waveforms, int numWaveforms, float* proj) const
+{
+    if (numLocalChannels == 0)
+    {
+        SimdKernels::projectBatch(waveforms, numWaveforms, dimension, projectionMatrix, proj);
+        return;
+    }
+
+    for (int i = 0; i < numWaveforms; i++)
+        project(waveforms[i], proj + size_t(i) * SimdKernels::projectionWidth);
+}
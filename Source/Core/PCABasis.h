@@ -0,0 +1,172 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PCABASIS_H
+#define __PCABASIS_H
+
+#include "Containers.h"
+#include "SimdKernels.h"
+#include "SpikeDescriptors.h"
+
+/**
+
+    A set of principal components for one electrode
+
+    A basis is filled once (by a PCAjob, or when loading settings) and is
+    never modified after it has been handed to the Sorter. Each basis
+    carries a version number, so that projections and PCA units can tell
+    which basis they belong to. Streaming updates (see IncrementalPCA)
+    keep the version of the basis they refine and bump its revision; the
+    Sorter holds them back while units are drawn in that version (see
+    Sorter::setStreamingPCA).
+
+    Besides the components themselves, the basis keeps a transposed copy
+    (one padded row of components per waveform sample) that lets
+    SimdKernels compute all projections in a single pass. The kernel
+    computes maxComponents columns either way, so extra components (up to
+    maxComponents) cost nothing on the per-spike path.
+
+    A channel-local basis holds temporal components of a single channel
+    (shared by all channels) instead of components over the concatenated
+    waveform. Each spike is projected only on numLocalChannels adjacent
+    channels centered on its peak channel (the channel with the largest
+    peak-to-peak amplitude up to the peak sample), so that fitting and
+    projecting cost the same for a 32-channel group as for a tetrode.
+    Features are keyed to the position of the channel in that window, not
+    to its strength: feature j is component j / numLocalChannels of window
+    channel j % numLocalChannels.
+
+*/
+class PCABasis
+{
+public:
+
+    /** Constructor (all components start at zero) */
+    PCABasis(int dimension, int version, int revision = 0, int numComponents = defaultComponents);
+
+    /** Constructor for a channel-local basis (all components start at zero) */
+    PCABasis(const SpikeChannelDescriptor& channel, int numLocalChannels, int version,
+             int numComponents = defaultComponents);
+
+    /** Destructor */
+    ~PCABasis() { }
+
+    /** Largest number of components in a basis (one per column of the projection kernel) */
+    static constexpr int maxComponents = SimdKernels::projectionWidth;
+
+    /** Number of components computed unless configured otherwise (also the number displayed) */
+    static constexpr int defaultComponents = 3;
+
+    /** Returns the number of components in this basis (defaultComponents to maxComponents) */
+    int getNumComponents() const { return numComponents; }
+
+    /** Returns the waveform dimension (channels x samples) */
+    int getDimension() const { return dimension; }
+
+    /** Returns the number of channels each spike is projected on (0 for a basis over the whole waveform) */
+    int getNumLocalChannels() const { return numLocalChannels; }
+
+    /**
+        Returns the number of channels a local basis actually uses
+
+        0 stays 0 (a basis over the whole waveform). Otherwise at least 1 and
+        at most numChannels and numComponents (one feature per channel).
+    */
+    static int clampLocalChannels(int numLocalChannels, int numChannels, int numComponents);
+
+    /** Returns the number of stored components (getNumComponents(), or the components per channel of a local basis) */
+    int getNumStoredComponents() const { return numStoredComponents; }
+
+    /** Returns the length of a stored component (the dimension, or the samples per channel of a local basis) */
+    int getComponentLength() const { return componentLength; }
+
+    /** Returns the last sample of the window used to find the peak channel of a local basis */
+    int getPeakSample() const { return peakSample; }
+
+    /** Returns the channel with the largest peak-to-peak amplitude over samples 0 to getPeakSample() */
+    int findPeakChannel(const float* waveform) const;
+
+    /** Returns the first of the numLocalChannels channels centered on a peak channel (local bases only) */
+    int getFirstLocalChannel(int peakChannel) const;
+
+    /** Returns the version of this basis (> 0) */
+    int getVersion() const { return version; }
+
+    /** Returns the number of streaming updates applied since the basis was computed */
+    int getRevision() const { return revision; }
+
+    /** Returns a pointer to one stored component (getComponentLength() values) */
+    float* getComponent(int index);
+
+    /** Returns a pointer to one stored component (getComponentLength() values) */
+    const float* getComponent(int index) const;
+
+    /** Rebuilds the transposed projection matrix (call once the components are filled, before publishing) */
+    void updateProjectionMatrix();
+
+    /** Projects a waveform onto the components (writes getNumComponents() values) */
+    void project(const float* waveform, float* proj) const;
+
+    /** Projects a batch of waveforms (writes SimdKernels::projectionWidth values per waveform) */
+    void projectBatch(const float* const* waveforms, int numWaveforms, float* proj) const;
+
+    /** Returns the mean waveform of the training set (getComponentLength() values) */
+    float* getMean() { return mean.getData(); }
+
+    /** Returns the mean waveform of the training set (getComponentLength() values) */
+    const float* getMean() const { return mean.getData(); }
+
+    /** Display range for each component, derived from the training set */
+    float rangeMin[maxComponents], rangeMax[maxComponents];
+
+    /** Variance along each stored component */
+    float eigenvalues[maxComponents];
+
+    /** Number of spikes the basis was estimated from */
+    int64_t numTrainingSpikes;
+
+    PCABasis(const PCABasis&) = delete;
+    PCABasis& operator=(const PCABasis&) = delete;
+
+private:
+
+    /** Allocates and clears the components, mean and projection matrix */
+    void allocate();
+
+    int dimension;
+    int version;
+    int revision;
+    int numComponents;
+
+    int numChannels;
+    int numLocalChannels;
+    int peakSample;
+    int numStoredComponents;
+    int componentLength;
+
+    AlignedHeapBlock<float> components;
+    AlignedHeapBlock<float> mean;
+    AlignedHeapBlock<float> projectionMatrix;
+};
+
+#endif // __PCABASIS_H
@@ -0,0 +1,349 @@
+﻿/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PCAJob.h"
+#include "Sorter.h"
+#include "GaussianMixture.h"
+
+SorterJob::SorterJob(Sorter* sorter_, int basisVersion_)
+    : sorter(sorter_),
+      basisVersion(basisVersion_),
+      submitTicks(0)
+{
+}
+
+PCAjob::PCAjob(const SpikeRing& ring, int64_t firstSpike, int numSpikes_, Sorter* sorter_, int basisVersion_,
+               int numComponents_, EigenSolver::Type solverType_)
+    : SorterJob(sorter_, basisVersion_),
+      numSpikes(numSpikes_),
+      numComponents(numComponents_),
+      numLocalChannels(0),
+      solverType(solverType_)
+{
+    dim = ring.getDimension();
+
+    waveforms.allocate(size_t(numSpikes) * dim);
+    ring.copyWaveforms(firstSpike, numSpikes, waveforms);
+
+};
+
+PCAjob::PCAjob(std::shared_ptr<const TrainingReservoir> trainingSet_, Sorter* sorter_, int basisVersion_,
+               int numComponents_, EigenSolver::Type solverType_)
+    : SorterJob(sorter_, basisVersion_),
+      numSpikes(0),
+      trainingSet(std::move(trainingSet_)),
+      numComponents(numComponents_),
+      numLocalChannels(0),
+      solverType(solverType_),
+      dim(trainingSet->getDimension())
+{
+}
+
+PCAjob::~PCAjob()
+{
+
+}
+
+void PCAjob::setLocalChannels(const SpikeChannelDescriptor& channel_, int numLocalChannels_)
+{
+    channel = channel_;
+    numLocalChannels = channel.getDimension() == dim ? numLocalChannels_ : 0;
+}
+
+void PCAjob::compute()
+{
+    if (trainingSet != nullptr)
+    {
+        const int maxRows = trainingSet->getNumStored();
+
+        waveforms.allocate(size_t(maxRows) * dim);
+        numSpikes = trainingSet->copyWaveforms(waveforms, maxRows);
+        trainingSet.reset();
+    }
+
+    if (numLocalChannels > 0)
+        computeLocalCov();
+    else
+        computeCov();
+
+    computeSVD();
+}
+
+void PCAjob::computeCov()
+{
+    const int ld = SimdKernels::padDimension(dim);
+
+    basis.reset(new PCABasis(dim, basisVersion, 0, numComponents));
+    basis->numTrainingSpikes = numSpikes;
+
+    // 1. pack the training set into a contiguous, centered (numSpikes x dim) matrix
+    std::vector<double> mean(dim, 0.0);
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        const float* spike = waveforms + int64_t(i) * dim;
+
+        for (int j = 0; j < dim; j++)
+            mean[j] += spike[j];
+    }
+
+    for (int j = 0; j < dim; j++)
+    {
+        mean[j] /= numSpikes;
+        basis->getMean()[j] = float(mean[j]);
+    }
+
+    AlignedHeapBlock<float> centered(size_t(numSpikes) * ld);
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        const float* spike = waveforms + int64_t(i) * dim;
+        float* row = centered + size_t(i) * ld;
+
+        for (int j = 0; j < dim; j++)
+            row[j] = float(spike[j] - mean[j]);
+    }
+
+    // 2. cov = X^T X / (N-1), computed into one contiguous block
+    covariance.allocate(size_t(ld) * ld);
+
+    SimdKernels::syrk(centered, numSpikes, dim, ld, covariance, ld);
+
+    const float scale = 1.0f / std::max(1, numSpikes - 1);
+
+    for (int i = 0; i < dim; i++)
+    {
+        float* row = covariance + size_t(i) * ld;
+
+        for (int j = 0; j < dim; j++)
+            row[j] *= scale;
+    }
+
+}
+
+void PCAjob::computeLocalCov()
+{
+    basis.reset(new PCABasis(channel, numLocalChannels, basisVersion, numComponents));
+    basis->numTrainingSpikes = numSpikes;
+
+    const int numSamples = basis->getComponentLength();
+    const int numLocal = basis->getNumLocalChannels();
+    const int ld = SimdKernels::padDimension(numSamples);
+    const int numRows = numSpikes * numLocal;
+
+    // 1. gather the channels around the peak of every spike into a (numRows x numSamples) matrix
+    AlignedHeapBlock<float> centered(size_t(numRows) * ld);
+    std::vector<double> mean(numSamples, 0.0);
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        const float* spike = waveforms + int64_t(i) * dim;
+        const int firstChannel = basis->getFirstLocalChannel(basis->findPeakChannel(spike));
+
+        for (int r = 0; r < numLocal; r++)
+        {
+            const float* samples = spike + size_t(firstChannel + r) * numSamples;
+            float* row = centered + (size_t(i) * numLocal + r) * ld;
+
+            for (int k = 0; k < numSamples; k++)
+            {
+                row[k] = samples[k];
+                mean[k] += samples[k];
+            }
+        }
+    }
+
+    for (int k = 0; k < numSamples; k++)
+    {
+        mean[k] /= std::max(1, numRows);
+        basis->getMean()[k] = float(mean[k]);
+    }
+
+    for (int i = 0; i < numRows; i++)
+    {
+        float* row = centered + size_t(i) * ld;
+
+        for (int k = 0; k < numSamples; k++)
+            row[k] = float(row[k] - mean[k]);
+    }
+
+    // 2. cov = X^T X / (rows-1), numSamples x numSamples whatever the number of channels
+    covariance.allocate(size_t(ld) * ld);
+
+    SimdKernels::syrk(centered, numRows, numSamples, ld, covariance, ld);
+
+    const float scale = 1.0f / std::max(1, numRows - 1);
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        float* row = covariance + size_t(i) * ld;
+
+        for (int j = 0; j < numSamples; j++)
+            row[j] *= scale;
+    }
+}
+
+void PCAjob::computeSVD()
+{
+    // only the leading components are needed
+    const int numStored = basis->getNumStoredComponents();
+    const int length = basis->getComponentLength();
+
+    std::vector<float> eigenvalues(numStored, 0.0f);
+
+    std::unique_ptr<EigenSolver> solver = EigenSolver::create(solverType);
+
+    solver->computeTopK(covariance, length, SimdKernels::padDimension(length), std::min(numStored, length),
+                        eigenvalues.data(), basis->getComponent(0));
+
+    for (int i = 0; i < numStored; i++)
+        basis->eigenvalues[i] = eigenvalues[i];
+
+    // project samples to find the display range
+    const int numComponents = basis->getNumComponents();
+
+    float minProj[PCABasis::maxComponents], maxProj[PCABasis::maxComponents];
+    float proj[PCABasis::maxComponents];
+
+    std::fill(minProj, minProj + numComponents, 1e10f);
+    std::fill(maxProj, maxProj + numComponents, -1e10f);
+
+    basis->updateProjectionMatrix();
+
+    for (int j = 0; j < numSpikes; j++)
+    {
+        basis->project(waveforms + int64_t(j) * dim, proj);
+
+        for (int i = 0; i < numComponents; i++)
+        {
+            minProj[i] = std::min(minProj[i], proj[i]);
+            maxProj[i] = std::max(maxProj[i], proj[i]);
+        }
+    }
+
+    for (int i = 0; i < numComponents; i++)
+    {
+        basis->rangeMin[i] = minProj[i] - 1.5 * (maxProj[i] - minProj[i]);
+        basis->rangeMax[i] = maxProj[i] + 1.5 * (maxProj[i] - minProj[i]);
+    }
+
+    // release covariances
+    covariance.allocate(0);
+
+}
+
+void PCAjob::reportDone()
+{
+    sorter->setPCABasis(basis.release());
+}
+
+IncrementalPCAjob::IncrementalPCAjob(const SpikeRing& ring, int64_t firstSpike, int numSpikes, Sorter* sorter, int basisVersion)
+    : PCAjob(ring, firstSpike, numSpikes, sorter, basisVersion)
+{
+}
+
+void IncrementalPCAjob::compute()
+{
+    sorter->updateStreamingPCA(waveforms, numSpikes, basisVersion);
+}
+
+void IncrementalPCAjob::reportDone()
+{
+}
+
+
+ClusteringJob::ClusteringJob(std::vector<float> x, std::vector<float> y, Sorter* sorter, int basisVersion)
+    : SorterJob(sorter, basisVersion),
+      projX(std::move(x)),
+      projY(std::move(y)),
+      numSpikes((int) std::min(projX.size(), projY.size()))
+{
+}
+
+void ClusteringJob::compute()
+{
+    GaussianMixture mixture;
+
+    const int numClusters = mixture.fit(projX.data(), projY.data(), numSpikes);
+
+    std::vector<std::pair<double, int>> order;
+
+    for (int c = 0; c < numClusters; c++)
+    {
+        const GaussianMixture::Component& component = mixture.getComponents()[c];
+
+        if (component.weight * numSpikes < minClusterSize)
+            continue;
+
+        const double det = component.cov[0] * component.cov[2] - component.cov[1] * component.cov[1];
+        order.push_back(std::make_pair(det, c));
+    }
+
+    std::sort(order.begin(), order.end());
+
+    for (auto& entry : order)
+    {
+        cPolygon poly;
+        poly.offset = PointD(0, 0);
+        poly.pts = mixture.getContour(entry.second, contourRadius);
+        polygons.push_back(poly);
+    }
+}
+
+void ClusteringJob::reportDone()
+{
+    sorter->setClusteredUnits(polygons, basisVersion);
+}
+
+
+IsolationJob::IsolationJob(std::vector<float> features_, std::vector<int> labels_, std::vector<int> unitIds_, int dim,
+                           Sorter* sorter, int basisVersion)
+    : SorterJob(sorter, basisVersion),
+      features(std::move(features_)),
+      labels(std::move(labels_)),
+      unitIds(std::move(unitIds_)),
+      numFeatures(dim),
+      numSpikes((int) labels.size())
+{
+}
+
+void IsolationJob::compute()
+{
+    ClusterIsolation isolation(numFeatures);
+
+    for (int i = 0; i < numSpikes; i++)
+        isolation.addSpike(features.data() + size_t(i) * numFeatures, labels[i]);
+
+    isolation.compute((int) unitIds.size(), results);
+
+    for (size_t u = 0; u < results.size(); u++)
+        results[u].unitId = unitIds[u];
+}
+
+void IsolationJob::reportDone()
+{
+    sorter->setIsolationMetrics(results, basisVersion);
+}
+
+
+/**************************/
@@ -0,0 +1,272 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PCAJOB_H
+#define __PCAJOB_H
+
+#include "Containers.h"
+#include "SpikeRing.h"
+#include "TrainingReservoir.h"
+#include "PCABasis.h"
+#include "SimdKernels.h"
+#include "EigenSolver.h"
+#include "PCAUnit.h"
+#include "ClusterIsolation.h"
+
+#include <algorithm>
+#include <list>
+#include <queue>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class Sorter;
+
+/**
+
+    A piece of background work for one Sorter, run by the PCAJobScheduler
+
+    compute() runs on a PCA worker thread, then reportDone() hands the
+    result to the Sorter, which drops it if the basis has changed since.
+
+*/
+class SorterJob
+{
+public:
+
+    /** What a job computes (see PCAJobScheduler for how each kind is queued) */
+    enum JobType
+    {
+        FULL_PCA = 0,
+        INCREMENTAL_PCA,
+        CLUSTERING,
+        ISOLATION
+    };
+
+    /** Constructor */
+    SorterJob(Sorter* sorter, int basisVersion);
+
+    /** Destructor */
+    virtual ~SorterJob() { }
+
+    /** Runs the job (on a PCA worker thread) */
+    virtual void compute() = 0;
+
+    /** Hands the result over to the Sorter */
+    virtual void reportDone() = 0;
+
+    /** Returns the kind of job */
+    virtual JobType getType() const = 0;
+
+    Sorter* sorter;
+
+    /** Version of the basis this job computes, refines or works in */
+    int basisVersion;
+
+    /** Time at which the job was queued (for latency metrics) */
+    int64_t submitTicks;
+
+    SorterJob(const SorterJob&) = delete;
+    SorterJob& operator=(const SorterJob&) = delete;
+};
+
+typedef std::shared_ptr<SorterJob> SorterJobPtr;
+
+/** 
+    
+    Represents one job for analyzing an array of incoming spikes.
+
+*/
+class PCAjob : public SorterJob
+{
+public:
+
+    /** Constructor (copies the training waveforms out of the ring) */
+    PCAjob(const SpikeRing& ring, int64_t firstSpike, int numSpikes, Sorter* sorter, int basisVersion,
+           int numComponents = PCABasis::defaultComponents,
+           EigenSolver::Type solverType = EigenSolver::SUBSPACE_ITERATION);
+
+    /**
+        Constructor for a job fitted to a training sample
+
+        The waveforms are copied out of the reservoir when the job runs, so
+        submitting the job costs the processing thread nothing.
+    */
+    PCAjob(std::shared_ptr<const TrainingReservoir> trainingSet, Sorter* sorter, int basisVersion,
+           int numComponents = PCABasis::defaultComponents,
+           EigenSolver::Type solverType = EigenSolver::SUBSPACE_ITERATION);
+
+    /** Destructor */
+    virtual ~PCAjob();
+
+    /**
+        Makes the job compute a channel-local basis (see PCABasis)
+
+        The covariance is then estimated over single channels, from the
+        numLocalChannels channels around the peak of each training spike:
+        O(numSpikes * numLocalChannels * numSamples^2) instead of
+        O(numSpikes * (numChannels * numSamples)^2).
+    */
+    void setLocalChannels(const SpikeChannelDescriptor& channel, int numLocalChannels);
+
+    /** Fits the basis (on a PCA worker thread) */
+    void compute() override;
+
+    /** Computes covariance of the waveforms*/
+    void computeCov();
+
+    /** Computes covariance of the channels around the peak of the waveforms (channel-local basis) */
+    void computeLocalCov();
+
+    /** Computes the leading eigenvectors of the covariance (the principal components) */
+    void computeSVD();
+
+    /** Hands the finished basis over to the Sorter */
+    void reportDone() override;
+
+    JobType getType() const override { return FULL_PCA; }
+
+    /** Covariance matrix (one padded, contiguous block with a row stride of SimdKernels::padDimension(dim)) */
+    AlignedHeapBlock<float> covariance;
+
+    AlignedHeapBlock<float> waveforms;
+    int numSpikes;
+
+    /** Sample to copy the waveforms from when the job runs (null if they were copied from the ring) */
+    std::shared_ptr<const TrainingReservoir> trainingSet;
+
+    /** Number of components to compute */
+    int numComponents;
+
+    /** Layout of the waveforms, and the channels used per spike (0 for a basis over the whole waveform) */
+    SpikeChannelDescriptor channel;
+    int numLocalChannels;
+
+    /** The basis being computed (private to this job until reportDone() is called) */
+    std::unique_ptr<PCABasis> basis;
+
+    /** Solver used for the decomposition (the SVD is kept as a reference) */
+    EigenSolver::Type solverType;
+
+private:
+    
+    int dim;
+};
+
+/**
+
+    Refines the current basis with a mini-batch of new spikes, when the
+    Sorter runs in streaming PCA mode (see IncrementalPCA)
+
+*/
+class IncrementalPCAjob : public PCAjob
+{
+public:
+
+    /** Constructor (copies the new waveforms out of the ring) */
+    IncrementalPCAjob(const SpikeRing& ring, int64_t firstSpike, int numSpikes, Sorter* sorter, int basisVersion);
+
+    /** Updates the Sorter's streaming estimate, which publishes a new revision of the basis */
+    void compute() override;
+
+    /** Nothing to hand over (the Sorter already published the update) */
+    void reportDone() override;
+
+    JobType getType() const override { return INCREMENTAL_PCA; }
+};
+
+/**
+
+    Clusters the recent spikes of an electrode in the PC1/PC2 plane
+    (see GaussianMixture) and replaces its PCA units with one ellipse
+    per cluster
+
+*/
+class ClusteringJob : public SorterJob
+{
+public:
+
+    /** Constructor (takes PC1/PC2 projections computed in the basis basisVersion) */
+    ClusteringJob(std::vector<float> x, std::vector<float> y, Sorter* sorter, int basisVersion);
+
+    /** Fits the mixture and builds the polygons */
+    void compute() override;
+
+    /** Hands the polygons to the Sorter (dropped if the basis changed in the meantime) */
+    void reportDone() override;
+
+    JobType getType() const override { return CLUSTERING; }
+
+    /** Mahalanobis radius of the contours (about 95% of a cluster's spikes fall inside) */
+    static constexpr double contourRadius = 2.45;
+
+    /** Clusters with fewer spikes are not turned into units */
+    static const int minClusterSize = 20;
+
+    std::vector<float> projX, projY;
+    int numSpikes;
+
+    /** One polygon per cluster, most compact first (overlaps go to the tighter cluster) */
+    std::vector<cPolygon> polygons;
+};
+
+/**
+
+    Computes the isolation distance and L-ratio of the units drawn in PC
+    space (see ClusterIsolation), over the recent spikes of an electrode
+
+*/
+class IsolationJob : public SorterJob
+{
+public:
+
+    /**
+        Constructor
+
+        Takes dim PC projections per spike (computed in the basis basisVersion),
+        the index in unitIds of the unit each spike falls in (-1 for none),
+        and the IDs of the evaluated units.
+    */
+    IsolationJob(std::vector<float> features, std::vector<int> labels, std::vector<int> unitIds, int dim,
+                 Sorter* sorter, int basisVersion);
+
+    /** Computes the metrics of every unit */
+    void compute() override;
+
+    /** Hands the metrics to the Sorter (dropped if the basis changed in the meantime) */
+    void reportDone() override;
+
+    JobType getType() const override { return ISOLATION; }
+
+    std::vector<float> features;
+    std::vector<int> labels;
+    std::vector<int> unitIds;
+    int numFeatures;
+    int numSpikes;
+
+    std::vector<UnitIsolation> results;
+};
+
+typedef std::shared_ptr<PCAjob> PCAJobPtr;
+
+#endif // __PCAJOB_H
@@ -0,0 +1,187 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "PCAJobScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+PCAJobScheduler::PCAJobScheduler(int numWorkers_)
+    : numWorkers(numWorkers_),
+      shouldExit(false),
+      prioritySorter(nullptr),
+      maxQueueDepth(0),
+      numCompleted(0),
+      numCoalesced(0),
+      totalWaitMs(0),
+      totalLatencyMs(0),
+      maxLatencyMs(0)
+{
+    // leave one core to the processing thread
+    if (numWorkers <= 0)
+        numWorkers = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+}
+
+PCAJobScheduler::~PCAJobScheduler()
+{
+    {
+        std::lock_guard<std::mutex> critical(lock);
+        shouldExit = true;
+    }
+
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int64_t PCAJobScheduler::getTicks()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PCAJobScheduler::addPCAjob(SorterJobPtr job)
+{
+    job->submitTicks = getTicks();
+
+    {
+        std::lock_guard<std::mutex> critical(lock);
+
+        if (job->getType() != SorterJob::INCREMENTAL_PCA)
+        {
+            auto superseded = [&job](const SorterJobPtr& queued)
+            {
+                return queued->sorter == job->sorter && queued->getType() == job->getType();
+            };
+
+            const size_t numQueued = jobs.size();
+            jobs.erase(std::remove_if(jobs.begin(), jobs.end(), superseded), jobs.end());
+            numCoalesced += numQueued - jobs.size();
+        }
+
+        jobs.push_back(job);
+        maxQueueDepth = std::max(maxQueueDepth, (int) jobs.size());
+
+        if (workers.empty())
+        {
+            for (int i = 0; i < numWorkers; i++)
+                workers.emplace_back(&PCAJobScheduler::run, this);
+        }
+    }
+
+    jobAvailable.notify_one();
+}
+
+void PCAJobScheduler::setPrioritySorter(const Sorter* sorter)
+{
+    prioritySorter = sorter;
+}
+
+int PCAJobScheduler::getNumWorkers() const
+{
+    return numWorkers;
+}
+
+PCAJobStats PCAJobScheduler::getStats()
+{
+    std::lock_guard<std::mutex> critical(lock);
+
+    PCAJobStats stats;
+
+    stats.queueDepth = (int) jobs.size();
+    stats.maxQueueDepth = maxQueueDepth;
+    stats.numCompleted = numCompleted;
+    stats.numCoalesced = numCoalesced;
+    stats.meanWaitMs = numCompleted > 0 ? totalWaitMs / numCompleted : 0;
+    stats.meanLatencyMs = numCompleted > 0 ? totalLatencyMs / numCompleted : 0;
+    stats.maxLatencyMs = maxLatencyMs;
+
+    return stats;
+}
+
+SorterJobPtr PCAJobScheduler::takeNextJob()
+{
+    std::unique_lock<std::mutex> critical(lock);
+
+    jobAvailable.wait(critical, [this] { return shouldExit || !jobs.empty(); });
+
+    if (shouldExit)
+        return nullptr;
+
+    auto next = jobs.begin();
+    const Sorter* priority = prioritySorter;
+
+    if (priority != nullptr)
+    {
+        auto prioritized = std::find_if(jobs.begin(), jobs.end(),
+                                        [priority](const SorterJobPtr& job) { return job->sorter == priority; });
+
+        if (prioritized != jobs.end())
+            next = prioritized;
+    }
+
+    SorterJobPtr job = *next;
+    jobs.erase(next);
+
+    return job;
+}
+
+void PCAJobScheduler::jobFinished(const SorterJob* job, int64_t startTicks)
+{
+    const int64_t now = getTicks();
+
+    const double waitMs = double(startTicks - job->submitTicks) * 1e-6;
+    const double latencyMs = double(now - job->submitTicks) * 1e-6;
+
+    std::lock_guard<std::mutex> critical(lock);
+
+    numCompleted++;
+    totalWaitMs += waitMs;
+    totalLatencyMs += latencyMs;
+    maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+}
+
+void PCAJobScheduler::run()
+{
+    for (;;)
+    {
+        SorterJobPtr J = takeNextJob();
+
+        if (J == nullptr)
+            return;
+
+        const int64_t startTicks = getTicks();
+
+        // compute PCA
+        // 1. Compute Covariance matrix
+        // 2. Find the leading eigenvectors of the covariance matrix
+        // 3. Report to the spike sorting electrode that PCA is finished
+
+        J->compute();
+        J->reportDone();
+
+        jobFinished(J.get(), startTicks);
+    }
+}
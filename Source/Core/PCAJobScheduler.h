@@ -0,0 +1,130 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PCAJOBSCHEDULER_H
+#define __PCAJOBSCHEDULER_H
+
+#include "PCAJob.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Sorter;
+
+/** Queue metrics for the PCA job scheduler */
+struct PCAJobStats
+{
+    /** Jobs waiting for a worker right now, and the largest backlog seen */
+    int queueDepth;
+    int maxQueueDepth;
+
+    /** Jobs that ran to completion, and queued jobs replaced by a newer one */
+    int64_t numCompleted;
+    int64_t numCoalesced;
+
+    /** Time from submission to the start of a job, and to its completion (ms) */
+    double meanWaitMs;
+    double meanLatencyMs;
+    double maxLatencyMs;
+};
+
+/**
+
+    Runs PCA jobs (and the other SorterJobs) for all electrodes on a pool of worker threads
+
+    The pool has one worker per core, except for the one used by the
+    processing thread. All workers take jobs from a single queue:
+
+    - A new full PCA (or clustering, or isolation) job replaces any job of the same kind
+      still queued for the same Sorter (its result would be discarded
+      anyway). Streaming updates are never replaced.
+    - Jobs from the priority Sorter (the electrode the user is looking
+      at) are taken first; other jobs run in the order they were submitted.
+
+    Workers are started with the first job and stopped by the destructor.
+
+*/
+class PCAJobScheduler
+{
+public:
+
+    /** Constructor (numWorkers <= 0 sizes the pool to the machine) */
+    PCAJobScheduler(int numWorkers = 0);
+
+    /** Destructor (waits for running jobs to finish) */
+    ~PCAJobScheduler();
+
+    /** Adds a job to the queue */
+    void addPCAjob(SorterJobPtr job);
+
+    /** Gives jobs from one Sorter priority over the others (nullptr for none) */
+    void setPrioritySorter(const Sorter* sorter);
+
+    /** Returns the number of worker threads */
+    int getNumWorkers() const;
+
+    /** Returns the current queue metrics */
+    PCAJobStats getStats();
+
+    /** Returns a monotonic timestamp in ticks (for job latencies) */
+    static int64_t getTicks();
+
+    PCAJobScheduler(const PCAJobScheduler&) = delete;
+    PCAJobScheduler& operator=(const PCAJobScheduler&) = delete;
+
+private:
+
+    /** Runs queued jobs until the scheduler shuts down (one per worker thread) */
+    void run();
+
+    /** Waits for the next job (nullptr once the scheduler shuts down) */
+    SorterJobPtr takeNextJob();
+
+    /** Records the latency of a finished job */
+    void jobFinished(const SorterJob* job, int64_t startTicks);
+
+    int numWorkers;
+    std::vector<std::thread> workers;
+
+    std::deque<SorterJobPtr> jobs;
+    std::mutex lock;
+
+    /** Notified when jobs are added or the scheduler shuts down */
+    std::condition_variable jobAvailable;
+    bool shouldExit;
+
+    std::atomic<const Sorter*> prioritySorter;
+
+    int maxQueueDepth;
+    int64_t numCompleted, numCoalesced;
+    double totalWaitMs, totalLatencyMs, maxLatencyMs;
+};
+
+
+#endif // __PCAJOBSCHEDULER_H
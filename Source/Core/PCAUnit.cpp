@@ -27,7 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "PCAUnit.h"
 
 
-bool cPolygon::isPointInside(PointD p)
+bool cPolygon::isPointInside(PointD p) const
 {
     PointD p1, p2;
 
@@ -67,62 +67,30 @@ bool cPolygon::isPointInside(PointD p)
     return inside;
 }
 
-void PCAUnit::setDefaultColors(uint8_t col[3], int id)
+PCAUnit::PCAUnit()
+    : basisVersion(0)
 {
-    int IDmodule = (id - 1) % 8; // ID can't be zero
-    
-    const int colors[8][3] =
-    {
-        {255,224,93},
-        {255,178,99},
-        {255,109,161},
-        {246,102,255},
-        {175,98,255},
-        {90,241,233},
-        {109,175,136},
-        {160,237,181}
-    };
-
-    col[0] = colors[IDmodule][0];
-    col[1] = colors[IDmodule][1];
-    col[2] = colors[IDmodule][2];
 }
 
-void PCAUnit::updateColor()
+PCAUnit::PCAUnit(int id): SortedUnit(id), basisVersion(0)
 {
-    setDefaultColors(colorRGB, unitId);
-}
-
-PCAUnit::PCAUnit(int id): unitId(id)
-{
-    setDefaultColors(colorRGB, unitId);
 };
 
 PCAUnit::~PCAUnit()
 {
 }
 
-PCAUnit::PCAUnit(cPolygon B, int id) : unitId(id)
+PCAUnit::PCAUnit(cPolygon B, int id) : SortedUnit(id), basisVersion(0)
 {
     poly = B;
 }
 
-int PCAUnit::getUnitId()
-{
-    return unitId;
-}
-
-bool PCAUnit::isPointInsidePolygon(PointD p)
+bool PCAUnit::isPointInsidePolygon(PointD p) const
 {
     return poly.isPointInside(p);
 }
 
-bool PCAUnit::isWaveFormInsidePolygon(SorterSpikePtr so)
+bool PCAUnit::isWaveFormInsidePolygon(SorterSpikePtr so) const
 {
     return poly.isPointInside(PointD(so->pcProj[0],so->pcProj[1]));
 }
-
-void PCAUnit::updateWaveform(SorterSpikePtr so)
-{
-    stats.update(so);
-}
@@ -24,15 +24,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef __PCA_UNIT_H
 #define __PCA_UNIT_H
 
-#include <ProcessorHeaders.h>
-
 #include "Containers.h"
-#include "WaveformStats.h"
+#include "SortedUnit.h"
 
 #include <algorithm>    // std::sort
 #include <list>
 #include <queue>
 #include <atomic>
+#include <memory>
 
 /** 
     Represents a polygon in 2D PCA space
@@ -45,7 +44,7 @@ public:
     cPolygon() { }
 
     /** Returns true if 2D point is inside polygon */
-    bool isPointInside(PointD p);
+    bool isPointInside(PointD p) const;
 
     std::vector<PointD> pts;
 
@@ -55,12 +54,12 @@ public:
 /** 
     A unit defined by a polygon in principal component space
 */
-class PCAUnit
+class PCAUnit : public SortedUnit
 {
 public:
 
     /** Default constructor */
-    PCAUnit() { }
+    PCAUnit();
 
     /** Constructor with global and local IDs specified */
     PCAUnit(int id);
@@ -71,38 +70,17 @@ public:
     /** Destructor */
     ~PCAUnit();
 
-    /** Returns global ID for this unit */
-    int getUnitId();
-
     /** Checks whether waveform is inside this unit's polygon */
-	bool isWaveFormInsidePolygon(SorterSpikePtr so);
+	bool isWaveFormInsidePolygon(SorterSpikePtr so) const;
 
     /** Checks whether a point is inside this unit's polygone */
-    bool isPointInsidePolygon(PointD p);
-
-    /** Updates the waveform for this unit */
-	void updateWaveform(SorterSpikePtr so);
-
-    /** Sets the color for this unit */
-    static void setDefaultColors(uint8_t col[3], int ID);
-
-    /** Updates the unit's color (when a new ID is assigned) */
-    void updateColor();
-  
-    /** Identifier for this unit (global across the Spike Sorter) */
-    int unitId;
+    bool isPointInsidePolygon(PointD p) const;
 
     /** Polygon that defines this unit's boundaries in PCA space*/
     cPolygon poly;
 
-    /** RGB color for this unit */
-    uint8_t colorRGB[3];
-
-    /** Ongoing stats for this unit (not currently used) */
-    WaveformStats stats;
-
-    /** True if this unit is active */
-    bool isActive;
+    /** Version of the PC basis the polygon was drawn in (0 if not yet known) */
+    int basisVersion;
 
 };
 
@@ -0,0 +1,255 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "PCAUnitGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+PCAUnitGrid::PCAUnitGrid(const std::vector<PCAUnit>& units)
+    : basisVersion(0),
+      left(0),
+      bottom(0),
+      cellWidth(1),
+      cellHeight(1),
+      columnsPerUnit(0),
+      rowsPerUnit(0),
+      margin(0),
+      labels(resolution * resolution, int16_t(noUnit))
+{
+    for (auto& unit : units)
+        basisVersion = std::max(basisVersion, unit.basisVersion);
+
+    // bounding box of the polygons, with vertices computed as in cPolygon::isPointInside
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = -std::numeric_limits<double>::max();
+    double maxY = -std::numeric_limits<double>::max();
+    double maxAbs = 0;
+
+    for (auto& unit : units)
+    {
+        if (unit.basisVersion != basisVersion)
+            continue;
+
+        for (auto& pt : unit.poly.pts)
+        {
+            PointD vertex(pt.X + unit.poly.offset.X, pt.Y + unit.poly.offset.Y);
+
+            minX = std::min(minX, double(vertex.X));
+            maxX = std::max(maxX, double(vertex.X));
+            minY = std::min(minY, double(vertex.Y));
+            maxY = std::max(maxY, double(vertex.Y));
+            maxAbs = std::max(maxAbs, double(std::max(fabs(vertex.X), fabs(vertex.Y))));
+        }
+    }
+
+    // unit indices are stored as 16-bit labels
+    if (basisVersion <= 0 || minX > maxX || !std::isfinite(maxAbs) || units.size() > std::numeric_limits<int16_t>::max())
+    {
+        basisVersion = 0;
+        return;
+    }
+
+    // largest error of the float arithmetic in isPointInside, well rounded up
+    const double roundingError = 1e-5 * (maxAbs + 1.0);
+
+    left = minX - 2 * roundingError;
+    bottom = minY - 2 * roundingError;
+    cellWidth = (maxX - minX + 4 * roundingError) / resolution;
+    cellHeight = (maxY - minY + 4 * roundingError) / resolution;
+    columnsPerUnit = float(1.0 / cellWidth);
+    rowsPerUnit = float(1.0 / cellHeight);
+
+    // also covers projections that land in a neighbouring cell after rounding
+    margin = roundingError + 0.01 * std::max(cellWidth, cellHeight);
+
+    std::vector<uint8_t> cells;
+
+    // units to test on each boundary cell; a list is closed by the first unit covering the whole cell
+    std::vector<std::vector<int16_t>> candidates(labels.size());
+    std::vector<bool> closed(labels.size(), false);
+
+    for (int k = 0; k < units.size(); k++)
+    {
+        if (units[k].basisVersion != basisVersion)
+            continue;
+
+        rasterize(units[k].poly, cells);
+
+        // earlier units take precedence, as in Sorter::checkPCAUnits
+        for (int c = 0; c < labels.size(); c++)
+        {
+            if (closed[c] || cells[c] == CELL_OUTSIDE)
+                continue;
+
+            if (candidates[c].empty() && cells[c] == CELL_INSIDE)
+            {
+                labels[c] = int16_t(k);
+                closed[c] = true;
+                continue;
+            }
+
+            candidates[c].push_back(int16_t(k));
+            closed[c] = cells[c] == CELL_INSIDE;
+        }
+    }
+
+    candidateStart.push_back(0);
+
+    for (int c = 0; c < labels.size(); c++)
+    {
+        if (candidates[c].empty())
+            continue;
+
+        labels[c] = int16_t(-2 - int(candidateStart.size() - 1));
+        candidateUnits.insert(candidateUnits.end(), candidates[c].begin(), candidates[c].end());
+        candidateStart.push_back((int) candidateUnits.size());
+    }
+}
+
+int PCAUnitGrid::getBasisVersion() const
+{
+    return basisVersion;
+}
+
+int PCAUnitGrid::findUnitOnBoundary(float x, float y, int list, const std::vector<PCAUnit>& units) const
+{
+    for (int i = candidateStart[list]; i < candidateStart[list + 1]; i++)
+    {
+        if (units[candidateUnits[i]].isPointInsidePolygon(PointD(x, y)))
+            return candidateUnits[i];
+    }
+
+    return noUnit;
+}
+
+bool PCAUnitGrid::haveSamePolygons(const std::vector<PCAUnit>& units, const std::vector<PCAUnit>& otherUnits)
+{
+    if (units.size() != otherUnits.size())
+        return false;
+
+    for (int k = 0; k < units.size(); k++)
+    {
+        const cPolygon& poly = units[k].poly;
+        const cPolygon& otherPoly = otherUnits[k].poly;
+
+        if (units[k].basisVersion != otherUnits[k].basisVersion
+            || poly.pts.size() != otherPoly.pts.size()
+            || poly.offset.X != otherPoly.offset.X
+            || poly.offset.Y != otherPoly.offset.Y)
+            return false;
+
+        for (int i = 0; i < poly.pts.size(); i++)
+        {
+            if (poly.pts[i].X != otherPoly.pts[i].X || poly.pts[i].Y != otherPoly.pts[i].Y)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void PCAUnitGrid::rasterize(const cPolygon& poly, std::vector<uint8_t>& cells) const
+{
+    cells.assign(resolution * resolution, CELL_OUTSIDE);
+
+    if (poly.pts.size() < 3)
+        return;
+
+    auto toCell = [](double position) { return std::min(resolution - 1, std::max(0, int(std::floor(position)))); };
+
+    // cells within the margin of an edge
+    PointD oldPoint(poly.pts[poly.pts.size() - 1].X + poly.offset.X, poly.pts[poly.pts.size() - 1].Y + poly.offset.Y);
+
+    for (int i = 0; i < poly.pts.size(); i++)
+    {
+        PointD newPoint(poly.pts[i].X + poly.offset.X, poly.pts[i].Y + poly.offset.Y);
+
+        const double x1 = oldPoint.X, y1 = oldPoint.Y;
+        const double x2 = newPoint.X, y2 = newPoint.Y;
+
+        const int firstRow = toCell((std::min(y1, y2) - margin - bottom) / cellHeight);
+        const int lastRow = toCell((std::max(y1, y2) + margin - bottom) / cellHeight);
+
+        for (int row = firstRow; row <= lastRow; row++)
+        {
+            // part of the edge within the row, widened by the margin
+            double xLow = std::min(x1, x2);
+            double xHigh = std::max(x1, x2);
+
+            if (y1 != y2)
+            {
+                double t1 = (bottom + row * cellHeight - margin - y1) / (y2 - y1);
+                double t2 = (bottom + (row + 1) * cellHeight + margin - y1) / (y2 - y1);
+
+                if (t1 > t2)
+                    std::swap(t1, t2);
+
+                t1 = std::max(t1, 0.0);
+                t2 = std::min(t2, 1.0);
+
+                if (t1 > t2)
+                    continue;
+
+                xLow = std::min(x1 + t1 * (x2 - x1), x1 + t2 * (x2 - x1));
+                xHigh = std::max(x1 + t1 * (x2 - x1), x1 + t2 * (x2 - x1));
+            }
+
+            const int firstColumn = toCell((xLow - margin - left) / cellWidth);
+            const int lastColumn = toCell((xHigh + margin - left) / cellWidth);
+
+            for (int column = firstColumn; column <= lastColumn; column++)
+                cells[row * resolution + column] = CELL_BOUNDARY;
+        }
+
+        oldPoint = newPoint;
+    }
+
+    // no edge separates neighbouring cells in a run, so one exact test covers the whole run
+    for (int row = 0; row < resolution; row++)
+    {
+        int column = 0;
+
+        while (column < resolution)
+        {
+            if (cells[row * resolution + column] == CELL_BOUNDARY)
+            {
+                column++;
+                continue;
+            }
+
+            const int runStart = column;
+
+            while (column < resolution && cells[row * resolution + column] != CELL_BOUNDARY)
+                column++;
+
+            PointD center(float(left + (runStart + 0.5) * cellWidth), float(bottom + (row + 0.5) * cellHeight));
+
+            if (poly.isPointInside(center))
+                std::fill(cells.begin() + row * resolution + runStart, cells.begin() + row * resolution + column, uint8_t(CELL_INSIDE));
+        }
+    }
+}
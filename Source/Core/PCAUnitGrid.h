@@ -0,0 +1,119 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PCA_UNIT_GRID_H
+#define __PCA_UNIT_GRID_H
+
+#include "PCAUnit.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+    Label grid over the polygons of an electrode's PCA units
+
+    Built whenever the units are edited, so that a spike can be assigned
+    to a unit with a single lookup instead of one point-in-polygon test per
+    unit. Each cell holds the index of the first unit that covers all of
+    it, or noUnit. Cells that a polygon edge passes through (or comes close
+    enough to for rounding to matter) instead hold a short list of the
+    units to test exactly with cPolygon::isPointInside, in unit order.
+
+    Only units drawn in the newest basis are rasterized; spikes projected
+    in another basis must use the exact test.
+*/
+class PCAUnitGrid
+{
+public:
+
+    /** Constructor (units with the highest basis version are rasterized) */
+    PCAUnitGrid(const std::vector<PCAUnit>& units);
+
+    /** Returns the version of the PC basis the rasterized polygons were drawn in (0 if none) */
+    int getBasisVersion() const;
+
+    /**
+        Returns the index of the first unit containing a projection, or noUnit
+
+        units must be the ones the grid was built from.
+    */
+    int findUnit(float x, float y, const std::vector<PCAUnit>& units) const
+    {
+        const float column = (x - left) * columnsPerUnit;
+        const float row = (y - bottom) * rowsPerUnit;
+
+        // also catches NaN
+        if (!(column >= 0 && column < resolution && row >= 0 && row < resolution))
+            return noUnit;
+
+        const int label = labels[int(row) * resolution + int(column)];
+
+        if (label >= noUnit)
+            return label;
+
+        return findUnitOnBoundary(x, y, -label - 2, units);
+    }
+
+    /** Returns true if a grid built from one set of units also describes another */
+    static bool haveSamePolygons(const std::vector<PCAUnit>& units, const std::vector<PCAUnit>& otherUnits);
+
+    /** Number of cells along each axis */
+    static const int resolution = 128;
+
+    static const int noUnit = -1;
+
+private:
+
+    /** What rasterize() found for a cell */
+    enum CellState
+    {
+        CELL_OUTSIDE = 0,
+        CELL_INSIDE,
+        CELL_BOUNDARY
+    };
+
+    /** Marks the cells of one polygon as inside, outside or boundary */
+    void rasterize(const cPolygon& poly, std::vector<uint8_t>& cells) const;
+
+    /** Runs the exact test for the units listed for a boundary cell */
+    int findUnitOnBoundary(float x, float y, int list, const std::vector<PCAUnit>& units) const;
+
+    int basisVersion;
+
+    /** Area covered by the grid (the polygons' bounding box, plus a margin) */
+    double left, bottom, cellWidth, cellHeight;
+    float columnsPerUnit, rowsPerUnit;
+
+    /** Distance from an edge within which cells are treated as boundary */
+    double margin;
+
+    /** Unit index, noUnit, or -2 - (index of a boundary cell's list) */
+    std::vector<int16_t> labels;
+
+    /** Units to test for each boundary cell (list i is candidateUnits[candidateStart[i]] onwards) */
+    std::vector<int> candidateStart;
+    std::vector<int16_t> candidateUnits;
+};
+
+#endif // __PCA_UNIT_GRID_H
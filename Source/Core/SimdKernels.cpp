@@ -0,0 +1,783 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define SIMD_KERNELS_X86 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define SIMD_TARGET_AVX2
+  #define SIMD_TARGET_AVX512
+ #else
+  #define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+  #define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+ #endif
+#else
+ #define SIMD_KERNELS_X86 0
+#endif
+
+static const int W = SimdKernels::projectionWidth;
+
+/**************************/
+/* Instruction set        */
+/**************************/
+
+static SimdKernels::InstructionSet detectInstructionSet()
+{
+#if SIMD_KERNELS_X86
+ #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+
+    __cpuid(info, 0);
+
+    if (info[0] < 7)
+        return SimdKernels::SCALAR;
+
+    __cpuid(info, 1);
+
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+
+    if (!osxsave || !avx || !fma)
+        return SimdKernels::SCALAR;
+
+    // the OS must save the YMM (and ZMM) registers on context switches
+    const unsigned long long xcr0 = _xgetbv(0);
+
+    if ((xcr0 & 0x6) != 0x6)
+        return SimdKernels::SCALAR;
+
+    __cpuidex(info, 7, 0);
+
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx2 && avx512f && (xcr0 & 0xe6) == 0xe6)
+        return SimdKernels::AVX512;
+
+    if (avx2)
+        return SimdKernels::AVX2;
+ #else
+    __builtin_cpu_init();
+
+    const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+    if (avx2 && __builtin_cpu_supports("avx512f"))
+        return SimdKernels::AVX512;
+
+    if (avx2)
+        return SimdKernels::AVX2;
+ #endif
+#endif
+
+    return SimdKernels::SCALAR;
+}
+
+static std::atomic<int>& currentInstructionSet()
+{
+    static std::atomic<int> instructionSet(detectInstructionSet());
+    return instructionSet;
+}
+
+SimdKernels::InstructionSet SimdKernels::getInstructionSet()
+{
+    return (InstructionSet) currentInstructionSet().load(std::memory_order_relaxed);
+}
+
+SimdKernels::InstructionSet SimdKernels::getSupportedInstructionSet()
+{
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+void SimdKernels::setInstructionSet(InstructionSet instructionSet)
+{
+    currentInstructionSet() = std::min(instructionSet, getSupportedInstructionSet());
+}
+
+const char* SimdKernels::getName(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+        case AVX512: return "AVX-512";
+        case AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+/**************************/
+/* Projection             */
+/**************************/
+
+static void projectScalar(const float* waveform, int dim, const float* basis, float* out)
+{
+    // local accumulators, so the compiler doesn't have to assume out aliases the inputs
+    float acc[W] = { 0 };
+
+    for (int k = 0; k < dim; k++)
+    {
+        const float v = waveform[k];
+        const float* row = basis + k * W;
+
+        for (int j = 0; j < W; j++)
+            acc[j] += row[j] * v;
+    }
+
+    for (int j = 0; j < W; j++)
+        out[j] = acc[j];
+}
+
+#if SIMD_KERNELS_X86
+
+SIMD_TARGET_AVX2 static void projectAVX2(const float* waveform, int dim, const float* basis, float* out)
+{
+    // one row of the basis holds all components of one sample
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+
+    int k = 0;
+
+    for (; k + 4 <= dim; k += 4)
+    {
+        const float* row = basis + k * W;
+
+        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k]), _mm256_load_ps(row), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k + 1]), _mm256_load_ps(row + W), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k + 2]), _mm256_load_ps(row + 2 * W), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k + 3]), _mm256_load_ps(row + 3 * W), acc3);
+    }
+
+    for (; k < dim; k++)
+        acc0 = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k]), _mm256_load_ps(basis + k * W), acc0);
+
+    _mm256_storeu_ps(out, _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+}
+
+SIMD_TARGET_AVX2 static void projectBatchAVX2(const float* const* waveforms, int numWaveforms, int dim,
+                                              const float* basis, float* out)
+{
+    int i = 0;
+
+    // four spikes share each load of a basis row
+    for (; i + 4 <= numWaveforms; i += 4)
+    {
+        const float* w0 = waveforms[i];
+        const float* w1 = waveforms[i + 1];
+        const float* w2 = waveforms[i + 2];
+        const float* w3 = waveforms[i + 3];
+
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        for (int k = 0; k < dim; k++)
+        {
+            const __m256 row = _mm256_load_ps(basis + k * W);
+
+            acc0 = _mm256_fmadd_ps(_mm256_set1_ps(w0[k]), row, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_set1_ps(w1[k]), row, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_set1_ps(w2[k]), row, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_set1_ps(w3[k]), row, acc3);
+        }
+
+        _mm256_storeu_ps(out + (i + 0) * W, acc0);
+        _mm256_storeu_ps(out + (i + 1) * W, acc1);
+        _mm256_storeu_ps(out + (i + 2) * W, acc2);
+        _mm256_storeu_ps(out + (i + 3) * W, acc3);
+    }
+
+    for (; i < numWaveforms; i++)
+        projectAVX2(waveforms[i], dim, basis, out + i * W);
+}
+
+/*
+  GCC 12 passes _mm512_undefined_ps() through the unmasked forms of
+  vpermps and vextractf64x4, which -Wall reports as uninitialized reads.
+  The zero-masked forms below compile to the same instructions without
+  the warnings.
+*/
+
+/** Broadcasts lanes of v as selected by index (same as _mm512_permutexvar_ps) */
+SIMD_TARGET_AVX512 static inline __m512 permuteLanes(__m512i index, __m512 v)
+{
+    return _mm512_maskz_permutexvar_ps((__mmask16) 0xFFFF, index, v);
+}
+
+/** Adds the two halves of a 512-bit accumulator (AVX-512F only, no DQ) */
+SIMD_TARGET_AVX512 static inline __m256 foldHalves(__m512 v)
+{
+    const __m512d d = _mm512_castps_pd(v);
+    const __m256 lo = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd((__mmask8) 0xFF, d, 0));
+    const __m256 hi = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd((__mmask8) 0xFF, d, 1));
+
+    return _mm256_add_ps(lo, hi);
+}
+
+SIMD_TARGET_AVX512 static void projectAVX512(const float* waveform, int dim, const float* basis, float* out)
+{
+    // each 512-bit register covers two consecutive rows of the basis
+    const __m512i firstPair = _mm512_set_epi32(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m512i secondPair = _mm512_set_epi32(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2);
+
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+
+    int k = 0;
+
+    for (; k + 4 <= dim; k += 4)
+    {
+        const __m512 v = _mm512_zextps128_ps512(_mm_loadu_ps(waveform + k));
+        const float* row = basis + k * W;
+
+        acc0 = _mm512_fmadd_ps(permuteLanes(firstPair, v), _mm512_load_ps(row), acc0);
+        acc1 = _mm512_fmadd_ps(permuteLanes(secondPair, v), _mm512_load_ps(row + 2 * W), acc1);
+    }
+
+    __m256 sum = foldHalves(_mm512_add_ps(acc0, acc1));
+
+    for (; k < dim; k++)
+        sum = _mm256_fmadd_ps(_mm256_set1_ps(waveform[k]), _mm256_load_ps(basis + k * W), sum);
+
+    _mm256_storeu_ps(out, sum);
+}
+
+SIMD_TARGET_AVX512 static void projectBatchAVX512(const float* const* waveforms, int numWaveforms, int dim,
+                                                  const float* basis, float* out)
+{
+    const __m512i firstPair = _mm512_set_epi32(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m512i secondPair = _mm512_set_epi32(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2);
+
+    int i = 0;
+
+    for (; i + 4 <= numWaveforms; i += 4)
+    {
+        __m512 acc[4][2];
+
+        for (int s = 0; s < 4; s++)
+            acc[s][0] = acc[s][1] = _mm512_setzero_ps();
+
+        int k = 0;
+
+        for (; k + 4 <= dim; k += 4)
+        {
+            const __m512 rows01 = _mm512_load_ps(basis + k * W);
+            const __m512 rows23 = _mm512_load_ps(basis + (k + 2) * W);
+
+            for (int s = 0; s < 4; s++)
+            {
+                const __m512 v = _mm512_zextps128_ps512(_mm_loadu_ps(waveforms[i + s] + k));
+
+                acc[s][0] = _mm512_fmadd_ps(permuteLanes(firstPair, v), rows01, acc[s][0]);
+                acc[s][1] = _mm512_fmadd_ps(permuteLanes(secondPair, v), rows23, acc[s][1]);
+            }
+        }
+
+        for (int s = 0; s < 4; s++)
+        {
+            __m256 sum = foldHalves(_mm512_add_ps(acc[s][0], acc[s][1]));
+
+            for (int t = k; t < dim; t++)
+                sum = _mm256_fmadd_ps(_mm256_set1_ps(waveforms[i + s][t]), _mm256_load_ps(basis + t * W), sum);
+
+            _mm256_storeu_ps(out + (i + s) * W, sum);
+        }
+    }
+
+    for (; i < numWaveforms; i++)
+        projectAVX512(waveforms[i], dim, basis, out + i * W);
+}
+
+#endif
+
+void SimdKernels::project(const float* waveform, int dim, const float* basis, float* out)
+{
+#if SIMD_KERNELS_X86
+    switch (getInstructionSet())
+    {
+        case AVX512: projectAVX512(waveform, dim, basis, out); return;
+        case AVX2: projectAVX2(waveform, dim, basis, out); return;
+        default: break;
+    }
+#endif
+
+    projectScalar(waveform, dim, basis, out);
+}
+
+void SimdKernels::projectBatch(const float* const* waveforms, int numWaveforms, int dim,
+                               const float* basis, float* out)
+{
+#if SIMD_KERNELS_X86
+    switch (getInstructionSet())
+    {
+        case AVX512: projectBatchAVX512(waveforms, numWaveforms, dim, basis, out); return;
+        case AVX2: projectBatchAVX2(waveforms, numWaveforms, dim, basis, out); return;
+        default: break;
+    }
+#endif
+
+    for (int i = 0; i < numWaveforms; i++)
+        projectScalar(waveforms[i], dim, basis, out + i * W);
+}
+
+/**************************/
+/* Symmetric rank-k       */
+/**************************/
+
+/** Rows of X per panel, so that a 16-column strip of the panel stays in L1 */
+static const int syrkPanelRows = 256;
+
+static void syrkScalar(const float* X, int k0, int k1, int paddedDim, int ldx, float* C, int ldc)
+{
+    for (int j0 = 0; j0 < paddedDim; j0 += 16)
+    {
+        for (int i0 = 0; i0 < j0 + 16; i0 += 4)
+        {
+            float acc[4][16] = { { 0 } };
+
+            for (int k = k0; k < k1; k++)
+            {
+                const float* row = X + size_t(k) * ldx;
+
+                for (int r = 0; r < 4; r++)
+                {
+                    const float a = row[i0 + r];
+
+                    for (int c = 0; c < 16; c++)
+                        acc[r][c] += a * row[j0 + c];
+                }
+            }
+
+            for (int r = 0; r < 4; r++)
+            {
+                float* dest = C + size_t(i0 + r) * ldc + j0;
+
+                for (int c = 0; c < 16; c++)
+                    dest[c] += acc[r][c];
+            }
+        }
+    }
+}
+
+#if SIMD_KERNELS_X86
+
+SIMD_TARGET_AVX2 static void syrkAVX2(const float* X, int k0, int k1, int paddedDim, int ldx, float* C, int ldc)
+{
+    // 4 x 16 tile of C held in eight registers
+    for (int j0 = 0; j0 < paddedDim; j0 += 16)
+    {
+        for (int i0 = 0; i0 < j0 + 16; i0 += 4)
+        {
+            __m256 acc[4][2];
+
+            for (int r = 0; r < 4; r++)
+                acc[r][0] = acc[r][1] = _mm256_setzero_ps();
+
+            for (int k = k0; k < k1; k++)
+            {
+                const float* row = X + size_t(k) * ldx;
+
+                const __m256 b0 = _mm256_loadu_ps(row + j0);
+                const __m256 b1 = _mm256_loadu_ps(row + j0 + 8);
+
+                for (int r = 0; r < 4; r++)
+                {
+                    const __m256 a = _mm256_set1_ps(row[i0 + r]);
+
+                    acc[r][0] = _mm256_fmadd_ps(a, b0, acc[r][0]);
+                    acc[r][1] = _mm256_fmadd_ps(a, b1, acc[r][1]);
+                }
+            }
+
+            for (int r = 0; r < 4; r++)
+            {
+                float* dest = C + size_t(i0 + r) * ldc + j0;
+
+                _mm256_storeu_ps(dest, _mm256_add_ps(_mm256_loadu_ps(dest), acc[r][0]));
+                _mm256_storeu_ps(dest + 8, _mm256_add_ps(_mm256_loadu_ps(dest + 8), acc[r][1]));
+            }
+        }
+    }
+}
+
+SIMD_TARGET_AVX512 static void syrkAVX512(const float* X, int k0, int k1, int paddedDim, int ldx, float* C, int ldc)
+{
+    // 8 x 16 tile of C held in eight registers
+    for (int j0 = 0; j0 < paddedDim; j0 += 16)
+    {
+        for (int i0 = 0; i0 < j0 + 16; i0 += 8)
+        {
+            __m512 acc[8];
+
+            for (int r = 0; r < 8; r++)
+                acc[r] = _mm512_setzero_ps();
+
+            for (int k = k0; k < k1; k++)
+            {
+                const float* row = X + size_t(k) * ldx;
+
+                const __m512 b = _mm512_loadu_ps(row + j0);
+
+                for (int r = 0; r < 8; r++)
+                    acc[r] = _mm512_fmadd_ps(_mm512_set1_ps(row[i0 + r]), b, acc[r]);
+            }
+
+            for (int r = 0; r < 8; r++)
+            {
+                float* dest = C + size_t(i0 + r) * ldc + j0;
+
+                _mm512_storeu_ps(dest, _mm512_add_ps(_mm512_loadu_ps(dest), acc[r]));
+            }
+        }
+    }
+}
+
+#endif
+
+void SimdKernels::syrk(const float* X, int n, int dim, int ldx, float* C, int ldc)
+{
+    const int paddedDim = padDimension(dim);
+
+    for (int i = 0; i < paddedDim; i++)
+        memset(C + size_t(i) * ldc, 0, sizeof(float) * paddedDim);
+
+#if SIMD_KERNELS_X86
+    const InstructionSet instructionSet = getInstructionSet();
+#endif
+
+    for (int k0 = 0; k0 < n; k0 += syrkPanelRows)
+    {
+        const int k1 = std::min(n, k0 + syrkPanelRows);
+
+#if SIMD_KERNELS_X86
+        if (instructionSet == AVX512)
+            syrkAVX512(X, k0, k1, paddedDim, ldx, C, ldc);
+        else if (instructionSet == AVX2)
+            syrkAVX2(X, k0, k1, paddedDim, ldx, C, ldc);
+        else
+#endif
+            syrkScalar(X, k0, k1, paddedDim, ldx, C, ldc);
+    }
+
+    // mirror the upper triangle
+    for (int i = 1; i < dim; i++)
+    {
+        for (int j = 0; j < i; j++)
+            C[size_t(i) * ldc + j] = C[size_t(j) * ldc + i];
+    }
+}
+
+/**************************/
+/* Template distances     */
+/**************************/
+
+static void templateDistancesScalar(const float* waveform, int dim, const float* templates, const float* weights,
+                                    int ld, int numTemplates, float* out)
+{
+    for (int t = 0; t < numTemplates; t++)
+    {
+        const float* mean = templates + size_t(t) * ld;
+        const float* weight = weights + size_t(t) * ld;
+
+        float sum = 0;
+
+        for (int k = 0; k < dim; k++)
+        {
+            const float d = waveform[k] - mean[k];
+            sum += weight[k] * d * d;
+        }
+
+        out[t] = sum;
+    }
+}
+
+#if SIMD_KERNELS_X86
+
+SIMD_TARGET_AVX2 static inline float horizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+
+    return _mm_cvtss_f32(s);
+}
+
+SIMD_TARGET_AVX2 static void templateDistancesAVX2(const float* waveform, int dim, const float* templates,
+                                                   const float* weights, int ld, int numTemplates, float* out)
+{
+    // the last vector of the waveform is masked, so nothing past dim is read
+    const int tail = dim & 7;
+    const int end = dim - tail;
+    const __m256i tailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(tail), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    int t = 0;
+
+    // four templates share each load of the waveform
+    for (; t + 4 <= numTemplates; t += 4)
+    {
+        const float* mean = templates + size_t(t) * ld;
+        const float* weight = weights + size_t(t) * ld;
+
+        __m256 acc[4];
+
+        for (int s = 0; s < 4; s++)
+            acc[s] = _mm256_setzero_ps();
+
+        for (int k = 0; k < end; k += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(waveform + k);
+
+            for (int s = 0; s < 4; s++)
+            {
+                const __m256 d = _mm256_sub_ps(x, _mm256_load_ps(mean + s * ld + k));
+                acc[s] = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_load_ps(weight + s * ld + k), d), d, acc[s]);
+            }
+        }
+
+        if (tail > 0)
+        {
+            const __m256 x = _mm256_maskload_ps(waveform + end, tailMask);
+
+            for (int s = 0; s < 4; s++)
+            {
+                const __m256 d = _mm256_sub_ps(x, _mm256_load_ps(mean + s * ld + end));
+                acc[s] = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_load_ps(weight + s * ld + end), d), d, acc[s]);
+            }
+        }
+
+        for (int s = 0; s < 4; s++)
+            out[t + s] = horizontalSum(acc[s]);
+    }
+
+    for (; t < numTemplates; t++)
+    {
+        const float* mean = templates + size_t(t) * ld;
+        const float* weight = weights + size_t(t) * ld;
+
+        __m256 acc = _mm256_setzero_ps();
+
+        for (int k = 0; k < end; k += 8)
+        {
+            const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(waveform + k), _mm256_load_ps(mean + k));
+            acc = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_load_ps(weight + k), d), d, acc);
+        }
+
+        if (tail > 0)
+        {
+            const __m256 d = _mm256_sub_ps(_mm256_maskload_ps(waveform + end, tailMask), _mm256_load_ps(mean + end));
+            acc = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_load_ps(weight + end), d), d, acc);
+        }
+
+        out[t] = horizontalSum(acc);
+    }
+}
+
+SIMD_TARGET_AVX512 static void templateDistancesAVX512(const float* waveform, int dim, const float* templates,
+                                                       const float* weights, int ld, int numTemplates, float* out)
+{
+    const int tail = dim & 15;
+    const int end = dim - tail;
+    const __mmask16 tailMask = __mmask16((1u << tail) - 1);
+
+    int t = 0;
+
+    for (; t + 4 <= numTemplates; t += 4)
+    {
+        const float* mean = templates + size_t(t) * ld;
+        const float* weight = weights + size_t(t) * ld;
+
+        __m512 acc[4];
+
+        for (int s = 0; s < 4; s++)
+            acc[s] = _mm512_setzero_ps();
+
+        for (int k = 0; k < end; k += 16)
+        {
+            const __m512 x = _mm512_loadu_ps(waveform + k);
+
+            for (int s = 0; s < 4; s++)
+            {
+                const __m512 d = _mm512_sub_ps(x, _mm512_load_ps(mean + s * ld + k));
+                acc[s] = _mm512_fmadd_ps(_mm512_mul_ps(_mm512_load_ps(weight + s * ld + k), d), d, acc[s]);
+            }
+        }
+
+        if (tail > 0)
+        {
+            const __m512 x = _mm512_maskz_loadu_ps(tailMask, waveform + end);
+
+            for (int s = 0; s < 4; s++)
+            {
+                const __m512 d = _mm512_sub_ps(x, _mm512_load_ps(mean + s * ld + end));
+                acc[s] = _mm512_fmadd_ps(_mm512_mul_ps(_mm512_load_ps(weight + s * ld + end), d), d, acc[s]);
+            }
+        }
+
+        for (int s = 0; s < 4; s++)
+            out[t + s] = horizontalSum(foldHalves(acc[s]));
+    }
+
+    for (; t < numTemplates; t++)
+    {
+        const float* mean = templates + size_t(t) * ld;
+        const float* weight = weights + size_t(t) * ld;
+
+        __m512 acc = _mm512_setzero_ps();
+
+        for (int k = 0; k < end; k += 16)
+        {
+            const __m512 d = _mm512_sub_ps(_mm512_loadu_ps(waveform + k), _mm512_load_ps(mean + k));
+            acc = _mm512_fmadd_ps(_mm512_mul_ps(_mm512_load_ps(weight + k), d), d, acc);
+        }
+
+        if (tail > 0)
+        {
+            const __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(tailMask, waveform + end), _mm512_load_ps(mean + end));
+            acc = _mm512_fmadd_ps(_mm512_mul_ps(_mm512_load_ps(weight + end), d), d, acc);
+        }
+
+        out[t] = horizontalSum(foldHalves(acc));
+    }
+}
+
+#endif
+
+void SimdKernels::templateDistances(const float* waveform, int dim, const float* templates, const float* weights,
+                                    int ld, int numTemplates, float* out)
+{
+#if SIMD_KERNELS_X86
+    switch (getInstructionSet())
+    {
+        case AVX512: templateDistancesAVX512(waveform, dim, templates, weights, ld, numTemplates, out); return;
+        case AVX2: templateDistancesAVX2(waveform, dim, templates, weights, ld, numTemplates, out); return;
+        default: break;
+    }
+#endif
+
+    templateDistancesScalar(waveform, dim, templates, weights, ld, numTemplates, out);
+}
+
+/**************************/
+/* Running statistics     */
+/**************************/
+
+static void welfordUpdateScalar(const float* x, int dim, float invCount, float* mean, float* m2)
+{
+    for (int k = 0; k < dim; k++)
+    {
+        const float delta = x[k] - mean[k];
+        mean[k] += delta * invCount;
+        m2[k] += delta * (x[k] - mean[k]);
+    }
+}
+
+#if SIMD_KERNELS_X86
+
+SIMD_TARGET_AVX2 static void welfordUpdateAVX2(const float* x, int dim, float invCount, float* mean, float* m2)
+{
+    const __m256 scale = _mm256_set1_ps(invCount);
+
+    const int tail = dim & 7;
+    const int end = dim - tail;
+
+    for (int k = 0; k < end; k += 8)
+    {
+        const __m256 v = _mm256_loadu_ps(x + k);
+        const __m256 delta = _mm256_sub_ps(v, _mm256_load_ps(mean + k));
+        const __m256 newMean = _mm256_fmadd_ps(delta, scale, _mm256_load_ps(mean + k));
+
+        _mm256_store_ps(mean + k, newMean);
+        _mm256_store_ps(m2 + k, _mm256_fmadd_ps(delta, _mm256_sub_ps(v, newMean), _mm256_load_ps(m2 + k)));
+    }
+
+    // masked, so the padding after dim is neither read from x nor written
+    if (tail > 0)
+    {
+        const __m256i tailMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(tail), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+        const __m256 v = _mm256_maskload_ps(x + end, tailMask);
+        const __m256 delta = _mm256_sub_ps(v, _mm256_load_ps(mean + end));
+        const __m256 newMean = _mm256_fmadd_ps(delta, scale, _mm256_load_ps(mean + end));
+
+        _mm256_maskstore_ps(mean + end, tailMask, newMean);
+        _mm256_maskstore_ps(m2 + end, tailMask,
+                            _mm256_fmadd_ps(delta, _mm256_sub_ps(v, newMean), _mm256_load_ps(m2 + end)));
+    }
+}
+
+SIMD_TARGET_AVX512 static void welfordUpdateAVX512(const float* x, int dim, float invCount, float* mean, float* m2)
+{
+    const __m512 scale = _mm512_set1_ps(invCount);
+
+    const int tail = dim & 15;
+    const int end = dim - tail;
+
+    for (int k = 0; k < end; k += 16)
+    {
+        const __m512 v = _mm512_loadu_ps(x + k);
+        const __m512 delta = _mm512_sub_ps(v, _mm512_load_ps(mean + k));
+        const __m512 newMean = _mm512_fmadd_ps(delta, scale, _mm512_load_ps(mean + k));
+
+        _mm512_store_ps(mean + k, newMean);
+        _mm512_store_ps(m2 + k, _mm512_fmadd_ps(delta, _mm512_sub_ps(v, newMean), _mm512_load_ps(m2 + k)));
+    }
+
+    if (tail > 0)
+    {
+        const __mmask16 tailMask = __mmask16((1u << tail) - 1);
+
+        const __m512 v = _mm512_maskz_loadu_ps(tailMask, x + end);
+        const __m512 delta = _mm512_sub_ps(v, _mm512_load_ps(mean + end));
+        const __m512 newMean = _mm512_fmadd_ps(delta, scale, _mm512_load_ps(mean + end));
+
+        _mm512_mask_store_ps(mean + end, tailMask, newMean);
+        _mm512_mask_store_ps(m2 + end, tailMask,
+                             _mm512_fmadd_ps(delta, _mm512_sub_ps(v, newMean), _mm512_load_ps(m2 + end)));
+    }
+}
+
+#endif
+
+void SimdKernels::welfordUpdate(const float* x, int dim, float invCount, float* mean, float* m2)
+{
+#if SIMD_KERNELS_X86
+    switch (getInstructionSet())
+    {
+        case AVX512: welfordUpdateAVX512(x, dim, invCount, mean, m2); return;
+        case AVX2: welfordUpdateAVX2(x, dim, invCount, mean, m2); return;
+        default: break;
+    }
+#endif
+
+    welfordUpdateScalar(x, dim, invCount, mean, m2);
+}
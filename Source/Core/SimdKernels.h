@@ -0,0 +1,121 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SIMDKERNELS_H
+#define __SIMDKERNELS_H
+
+#include <cstddef>
+
+/**
+
+    Vectorized numeric kernels used on the per-spike path
+
+    Each kernel has a scalar version and, on x86, AVX2 and AVX-512
+    versions. The instruction set is detected once at runtime, so the
+    plugin can be built without architecture flags and still use the
+    widest units available on the machine it runs on.
+
+    The kernels only depend on the standard library, so they can be
+    benchmarked outside of the GUI.
+
+*/
+class SimdKernels
+{
+public:
+
+    enum InstructionSet
+    {
+        SCALAR = 0,
+        AVX2,
+        AVX512
+    };
+
+    /** Returns the instruction set used by the kernels */
+    static InstructionSet getInstructionSet();
+
+    /** Forces a (supported) instruction set, e.g. to compare against the scalar kernels */
+    static void setInstructionSet(InstructionSet instructionSet);
+
+    /** Returns the widest instruction set supported by this CPU */
+    static InstructionSet getSupportedInstructionSet();
+
+    /** Returns a readable name for an instruction set */
+    static const char* getName(InstructionSet instructionSet);
+
+    /** Number of columns of a transposed projection matrix (components are padded with zeros) */
+    static const int projectionWidth = 8;
+
+    /**
+        Projects one waveform onto a transposed basis
+
+        basis is a (dim x projectionWidth) matrix, 64-byte aligned, holding
+        one row per waveform sample. All projectionWidth outputs are written.
+    */
+    static void project(const float* waveform, int dim, const float* basis, float* out);
+
+    /**
+        Projects a batch of waveforms onto a transposed basis
+
+        Writes projectionWidth values per waveform to out. Each row of the
+        basis is loaded once for several spikes.
+    */
+    static void projectBatch(const float* const* waveforms, int numWaveforms, int dim,
+                             const float* basis, float* out);
+
+    /** Returns dim rounded up to the column padding required by syrk() */
+    static int padDimension(int dim) { return (dim + 15) & ~15; }
+
+    /**
+        Computes the symmetric product C = X^T X of a row-major (n x dim) matrix
+
+        X must have a row stride ldx >= padDimension(dim), with zeros in the
+        padding columns. C is overwritten; it needs padDimension(dim) rows
+        with a stride ldc >= padDimension(dim). Only the upper triangle is
+        accumulated (in cache-sized panels of rows), then mirrored.
+    */
+    static void syrk(const float* X, int n, int dim, int ldx, float* C, int ldc);
+
+    /**
+        Computes weighted squared distances from one waveform to a bank of templates
+
+        templates and weights hold numTemplates rows with a stride ld >=
+        padDimension(dim), 64-byte aligned. out[t] is the sum over the first
+        dim samples of weights[t][k] * (waveform[k] - templates[t][k])^2.
+        The waveform is loaded once for several templates.
+    */
+    static void templateDistances(const float* waveform, int dim, const float* templates, const float* weights,
+                                  int ld, int numTemplates, float* out);
+
+    /**
+        Adds one waveform to a running mean and sum of squared deviations (Welford)
+
+        mean and m2 are 64-byte aligned, with room for padDimension(dim)
+        values; only the first dim values are written. With delta = x - mean: mean += delta * invCount, then
+        m2 += delta * (x - mean), where invCount is 1 / (number of waveforms
+        including this one).
+    */
+    static void welfordUpdate(const float* x, int dim, float invCount, float* mean, float* m2);
+
+};
+
+#endif // __SIMDKERNELS_H
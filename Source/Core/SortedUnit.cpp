@@ -0,0 +1,72 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SortedUnit.h"
+
+SortedUnit::SortedUnit()
+    : unitId(0), colorRGB{0, 0, 0}, stats(std::make_shared<WaveformStats>()), metrics(std::make_shared<UnitMetrics>()), isActive(false)
+{
+}
+
+SortedUnit::SortedUnit(int id)
+    : unitId(id), stats(std::make_shared<WaveformStats>()), metrics(std::make_shared<UnitMetrics>()), isActive(false)
+{
+    setDefaultColors(colorRGB, unitId);
+}
+
+int SortedUnit::getUnitId() const
+{
+    return unitId;
+}
+
+void SortedUnit::updateWaveform(SorterSpikePtr so) const
+{
+    stats->update(so);
+    metrics->addSpike(so->getTimestamp() / double(so->getChannel().sampleRate));
+}
+
+void SortedUnit::setDefaultColors(uint8_t col[3], int id)
+{
+    int IDmodule = (id - 1) % 8; // ID can't be zero
+
+    const int colors[8][3] =
+    {
+        {255,224,93},
+        {255,178,99},
+        {255,109,161},
+        {246,102,255},
+        {175,98,255},
+        {90,241,233},
+        {109,175,136},
+        {160,237,181}
+    };
+
+    col[0] = colors[IDmodule][0];
+    col[1] = colors[IDmodule][1];
+    col[2] = colors[IDmodule][2];
+}
+
+void SortedUnit::updateColor()
+{
+    setDefaultColors(colorRGB, unitId);
+}
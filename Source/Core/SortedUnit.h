@@ -0,0 +1,77 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SORTED_UNIT_H
+#define __SORTED_UNIT_H
+
+#include "Containers.h"
+#include "UnitMetrics.h"
+#include "WaveformStats.h"
+
+#include <memory>
+
+/**
+    State common to every kind of unit (boxes, polygons, templates, ellipsoids)
+
+    Copies of a unit share its stats and metrics, so that spikes sorted
+    with an older snapshot of the units still count towards the unit.
+*/
+class SortedUnit
+{
+public:
+
+    /** Default constructor (the unit is left without a color) */
+    SortedUnit();
+
+    /** Constructor based on unit ID (the color is derived from the ID) */
+    SortedUnit(int id);
+
+    /** Returns the global ID for this unit */
+    int getUnitId() const;
+
+    /** Adds a new waveform to this unit's stats and metrics */
+    void updateWaveform(SorterSpikePtr so) const;
+
+    /** Sets the color for a unit ID */
+    static void setDefaultColors(uint8_t col[3], int ID);
+
+    /** Changes the unit color after the ID is updated */
+    void updateColor();
+
+    /** Identifier for this unit (global across the Spike Sorter) */
+    int unitId;
+
+    /** RGB color for this unit */
+    uint8_t colorRGB[3];
+
+    /** Ongoing stats for this unit (shared by all copies of the unit) */
+    std::shared_ptr<WaveformStats> stats;
+
+    /** Spike-train metrics for this unit (shared by all copies of the unit) */
+    std::shared_ptr<UnitMetrics> metrics;
+
+    /** True if the unit is active */
+    bool isActive;
+};
+
+#endif // __SORTED_UNIT_H
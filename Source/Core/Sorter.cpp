@@ -0,0 +1,1618 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+
+#include "Sorter.h"
+#include "PCAJobScheduler.h"
+
+#include "BoxUnit.h"
+#include "PCAUnit.h"
+
+std::atomic<int> Sorter::nextUnitId(1);
+
+Sorter::Sorter(SpikeRing* spikeRing_, PCAJobScheduler* pcaScheduler_)
+    : pcaScheduler(pcaScheduler_),
+      spikeRing(spikeRing_),
+      numChannels(spikeRing_->getNumChannels()),
+      waveformLength(spikeRing_->getNumSamples()),
+      selectedUnit(-1),
+      selectedBox(-1),
+      pc1min(-5),
+      pc2min(-5),
+      pc3min(-5),
+      pc1max(5),
+      pc2max(5),
+      pc3max(5),
+      trainingSet(std::make_shared<TrainingReservoir>(spikeRing_->getDimension(), TrainingReservoir::defaultCapacity)),
+      pendingTrainingSet(nullptr),
+      bPCAJobSubmitted(false),
+      bPCAComputed(false),
+      bRePCA(false),
+      bPCAFirstJobFinished(false),
+      bPCAJobFinished(false),
+      bClusteringFinished(false),
+      unitsRevision(0),
+      isolationUnitsRevision(-1),
+      isolationBasisVersion(0),
+      isolationBasisRevision(0),
+      isolationNumSpikes(0),
+      units(new SorterUnits()),
+      pcaBasis(nullptr),
+      latestBasisVersion(0),
+      numPCAComponents(PCABasis::defaultComponents),
+      numLocalPCAChannels(0),
+      trainingSetSize(TrainingReservoir::defaultCapacity),
+      bStreamingEnabled(false),
+      bStreamingJobPending(false),
+      forgettingFactor(0.999f),
+      streamingBatchSize(20),
+      nextStreamingSpike(0),
+      streamingBasisVersion(0)
+     
+{
+}
+
+void Sorter::setChannel(const SpikeChannelDescriptor& channel)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    spikeChannel = channel;
+
+    publishUnits(new SorterUnits(*units.get()));
+}
+
+void Sorter::publishUnits(SorterUnits* newUnits)
+{
+    if (spikeChannel.sampleRate > 0)
+    {
+        for (auto& unit : newUnits->boxUnits)
+            unit.compile(spikeChannel);
+    }
+
+    // box edits leave the polygons alone, so the grid can usually be kept
+    const SorterUnits* currentUnits = units.get();
+
+    if (newUnits->pcaUnits.size() == 0)
+        newUnits->pcaGrid.reset();
+    else if (currentUnits->pcaGrid != nullptr && PCAUnitGrid::haveSamePolygons(currentUnits->pcaUnits, newUnits->pcaUnits))
+        newUnits->pcaGrid = currentUnits->pcaGrid;
+    else
+        newUnits->pcaGrid = std::make_shared<const PCAUnitGrid>(newUnits->pcaUnits);
+
+    if (newUnits->templateUnits.size() == 0)
+        newUnits->templateBank.reset();
+    else
+        newUnits->templateBank = std::make_shared<const TemplateBank>(newUnits->templateUnits);
+
+    units.publish(newUnits);
+    unitsRevision++;
+}
+
+void Sorter::resizeWaveform(int numSamples)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    waveformLength = numSamples;
+
+    // any job still running was computed for the old waveform size
+    latestBasisVersion++;
+    pcaBasis.publish(nullptr);
+    streamingPCA.reset();
+    
+    bPCAComputed = false;
+    delete pendingTrainingSet.exchange(new TrainingReservoir(numChannels * numSamples, trainingSetSize));
+	bPCAJobSubmitted = false;
+	bPCAJobFinished = false;
+	selectedUnit = -1;
+	selectedBox = -1;
+	bRePCA = false;
+	pc1min = -1;
+	pc2min = -1;
+    pc3min = -1;
+	pc1max = 1;
+	pc2max = 1;
+    pc3max = 1;
+}
+
+Sorter::~Sorter()
+{
+    delete pendingTrainingSet.exchange(nullptr);
+}
+
+void Sorter::setSelectedUnitAndBox(int unitID, int boxID)
+{
+    selectedUnit = unitID;
+    selectedBox = boxID;
+}
+
+void Sorter::getSelectedUnitAndBox(int& unitID, int& boxid)
+{
+    unitID = selectedUnit;
+    boxid = selectedBox;
+}
+
+void Sorter::projectOnPrincipalComponents(SorterSpikePtr so)
+{
+    addTrainingSpike(so.get());
+
+    // 1. Check whether a new basis has been published
+    if (bPCAJobFinished)
+    {
+        bPCAComputed = true;
+
+        if (!bPCAFirstJobFinished)
+            bPCAFirstJobFinished = true;
+    }
+
+    // 2. If a basis is available, project spike onto PC axes
+    if (bPCAComputed)
+    {
+        LockFreeSnapshot<PCABasis>::ScopedRead basis(pcaBasis);
+
+        if (basis.get() != nullptr && basis->getDimension() == so->getDimension())
+        {
+            basis->project(so->getData(), so->pcProj);
+            so->basisVersion = basis->getVersion();
+
+            if (bStreamingEnabled && basis->getNumLocalChannels() == 0)
+                submitStreamingJob(basis->getVersion());
+        }
+
+        return;
+
+    }
+
+    // 3. Once the training sample is full, start a new PCA job on it (the job copies it when it runs)
+    const int numTrainingSpikes = trainingSet->getNumStored();
+
+    if ((numTrainingSpikes >= trainingSet->getCapacity() && !bPCAComputed && !bPCAJobSubmitted) || bRePCA)
+    {
+        if (numTrainingSpikes < 2)
+            return;
+
+        bPCAJobSubmitted = true;
+	    bPCAComputed = false;
+        bRePCA = false;
+
+        PCAJobPtr job = std::make_shared<PCAjob>(trainingSet, this, ++latestBasisVersion, numPCAComponents);
+
+        if (numLocalPCAChannels > 0)
+        {
+            SpikeChannelDescriptor layout = spikeChannel;
+            layout.numChannels = numChannels;
+            layout.numSamples = waveformLength;
+
+            job->setLocalChannels(layout, numLocalPCAChannels);
+        }
+
+        pcaScheduler->addPCAjob(job);
+    }
+
+}
+
+void Sorter::projectOnPrincipalComponents(const SorterSpikePtr* spikes, int numSpikes)
+{
+    // until a basis is in use, the single-spike path takes care of submitting PCA jobs
+    if (numSpikes == 1 || !bPCAComputed)
+    {
+        for (int i = 0; i < numSpikes; i++)
+            projectOnPrincipalComponents(spikes[i]);
+
+        return;
+    }
+
+    LockFreeSnapshot<PCABasis>::ScopedRead basis(pcaBasis);
+
+    if (basis.get() == nullptr)
+        return;
+
+    const int width = SimdKernels::projectionWidth;
+
+    if (batchWaveforms.size() < numSpikes)
+    {
+        batchWaveforms.resize(numSpikes);
+        batchProjections.allocate(size_t(numSpikes) * width);
+    }
+
+    int numProjected = 0;
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        addTrainingSpike(spikes[i].get());
+
+        if (spikes[i]->getDimension() == basis->getDimension())
+            batchWaveforms[numProjected++] = spikes[i]->getData();
+    }
+
+    basis->projectBatch(batchWaveforms.data(), numProjected, batchProjections);
+
+    if (bStreamingEnabled && basis->getNumLocalChannels() == 0)
+        submitStreamingJob(basis->getVersion());
+
+    numProjected = 0;
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        if (spikes[i]->getDimension() == basis->getDimension())
+        {
+            const float* proj = batchProjections + size_t(numProjected++) * width;
+
+            for (int j = 0; j < basis->getNumComponents(); j++)
+                spikes[i]->pcProj[j] = proj[j];
+
+            spikes[i]->basisVersion = basis->getVersion();
+        }
+    }
+}
+
+void Sorter::getPCArange(float& p1min,float& p2min, float& p3min,float& p1max,  float& p2max,float& p3max)
+{
+    p1min = pc1min;
+    p2min = pc2min;
+    p3min = pc3min;
+    p1max = pc1max;
+    p2max = pc2max;
+    p3max = pc3max;
+}
+
+void Sorter::setPCArange(float p1min,float p2min, float p3min, float p1max,  float p2max, float p3max)
+{
+    pc1min = p1min;
+    pc2min = p2min;
+    pc3min = p3min;
+    pc1max = p1max;
+    pc2max = p2max;
+    pc3max = p3max;
+}
+
+void Sorter::resetJobStatus()
+{
+    bPCAJobFinished = false;
+}
+
+bool Sorter::isPCAfinished()
+{
+    return bPCAJobFinished;
+}
+
+bool Sorter::firstJobFinished()
+{
+    return bPCAFirstJobFinished;
+}
+
+void Sorter::RePCA()
+{
+    if (bPCAComputed)
+    {
+        bPCAComputed = false;
+        bPCAJobSubmitted = false;
+        bRePCA = true;
+    }
+}
+
+void Sorter::setPCABasis(PCABasis* basis)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    if (basis->getVersion() != latestBasisVersion
+        || basis->getDimension() != numChannels * waveformLength)
+    {
+        delete basis; // superseded by a later request or a resize
+        return;
+    }
+
+    pc1min = basis->rangeMin[0];
+    pc2min = basis->rangeMin[1];
+    pc3min = basis->rangeMin[2];
+    pc1max = basis->rangeMax[0];
+    pc2max = basis->rangeMax[1];
+    pc3max = basis->rangeMax[2];
+
+    basis->updateProjectionMatrix();
+    pcaBasis.publish(basis);
+
+    // a new batch estimate restarts the streaming estimate
+    if (bStreamingEnabled)
+        seedStreamingPCA(basis);
+    else
+        streamingPCA.reset();
+
+    // units whose basis is unknown (e.g. loaded from older settings) adopt this one
+    const SorterUnits* currentUnits = units.get();
+
+    for (auto& unit : currentUnits->pcaUnits)
+    {
+        if (unit.basisVersion == 0)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+
+            for (auto& newUnit : newUnits->pcaUnits)
+            {
+                if (newUnit.basisVersion == 0)
+                    newUnit.basisVersion = basis->getVersion();
+            }
+
+            publishUnits(newUnits);
+            break;
+        }
+    }
+
+    bPCAJobFinished = true;
+}
+
+int Sorter::getPCABasisVersion()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const PCABasis* basis = pcaBasis.get();
+
+    return basis != nullptr ? basis->getVersion() : 0;
+}
+
+void Sorter::setNumComponents(int numComponents)
+{
+    numComponents = std::min(PCABasis::maxComponents, std::max(PCABasis::defaultComponents, numComponents));
+
+    if (numPCAComponents.exchange(numComponents) != numComponents)
+    {
+        numLocalPCAChannels = PCABasis::clampLocalChannels(numLocalPCAChannels, numChannels, numComponents);
+        RePCA();
+    }
+}
+
+int Sorter::getNumComponents() const
+{
+    return numPCAComponents;
+}
+
+void Sorter::setLocalChannels(int numLocalChannels)
+{
+    numLocalChannels = PCABasis::clampLocalChannels(numLocalChannels, numChannels, numPCAComponents);
+
+    if (numLocalPCAChannels.exchange(numLocalChannels) != numLocalChannels)
+        RePCA();
+}
+
+int Sorter::getLocalChannels() const
+{
+    return numLocalPCAChannels;
+}
+
+void Sorter::setTrainingSetSize(int numSpikes)
+{
+    numSpikes = std::min(int(maxTrainingSetSize), std::max(int(minTrainingSetSize), numSpikes));
+
+    // the sorting thread switches to the new sample with the next spike
+    if (trainingSetSize.exchange(numSpikes) != numSpikes)
+        delete pendingTrainingSet.exchange(new TrainingReservoir(spikeRing->getDimension(), numSpikes));
+}
+
+int Sorter::getTrainingSetSize() const
+{
+    return trainingSetSize;
+}
+
+void Sorter::addTrainingSpike(const SorterSpikeContainer* spike)
+{
+    // jobs still queued keep the previous sample alive
+    if (TrainingReservoir* newSet = pendingTrainingSet.exchange(nullptr))
+        trainingSet.reset(newSet);
+
+    if (spike->getDimension() == trainingSet->getDimension())
+        trainingSet->addSpike(spike->getData());
+}
+
+void Sorter::setStreamingPCA(bool enabled, float forgettingFactor_)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    forgettingFactor = std::min(1.0f, std::max(0.5f, forgettingFactor_));
+
+    if (enabled && !bStreamingEnabled && pcaBasis.get() != nullptr)
+        seedStreamingPCA(pcaBasis.get());
+    else if (!enabled)
+        streamingPCA.reset();
+    else if (streamingPCA != nullptr)
+        streamingPCA->setForgettingFactor(forgettingFactor);
+
+    bStreamingEnabled = enabled;
+}
+
+bool Sorter::isStreamingPCAEnabled() const
+{
+    return bStreamingEnabled;
+}
+
+float Sorter::getForgettingFactor() const
+{
+    return forgettingFactor;
+}
+
+void Sorter::seedStreamingPCA(const PCABasis* basis)
+{
+    // a channel-local basis is only refitted in batch
+    if (basis->getNumLocalChannels() > 0)
+    {
+        streamingPCA.reset();
+        return;
+    }
+
+    streamingPCA.reset(new IncrementalPCA(basis->getDimension(), basis->getNumComponents(), forgettingFactor));
+    streamingPCA->initialize(basis->getMean(), basis->getComponent(0), basis->eigenvalues,
+                             std::max(int64_t(1), basis->numTrainingSpikes));
+}
+
+void Sorter::submitStreamingJob(int basisVersion)
+{
+    // called from the sorting thread, once a basis is in use
+    const int64_t numSpikes = spikeRing->getNumSpikes();
+
+    if (basisVersion != streamingBasisVersion)
+    {
+        // only spikes that arrive after the basis was published are new to it
+        streamingBasisVersion = basisVersion;
+        nextStreamingSpike = numSpikes;
+        return;
+    }
+
+    if (bStreamingJobPending || numSpikes - nextStreamingSpike < streamingBatchSize)
+        return;
+
+    // spikes that were overwritten before we got to them are skipped
+    const int64_t firstSpike = std::max(nextStreamingSpike, spikeRing->getOldestSpike());
+
+    bStreamingJobPending = true;
+    nextStreamingSpike = numSpikes;
+
+    PCAJobPtr job = std::make_shared<IncrementalPCAjob>(*spikeRing, firstSpike, (int) (numSpikes - firstSpike),
+                                                        this, basisVersion);
+    pcaScheduler->addPCAjob(job);
+}
+
+void Sorter::updateStreamingPCA(const float* waveforms, int numWaveforms, int basisVersion)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    bStreamingJobPending = false;
+
+    const PCABasis* current = pcaBasis.get();
+
+    if (!bStreamingEnabled || streamingPCA == nullptr || current == nullptr
+        || current->getVersion() != basisVersion)
+        return;
+
+    const int dim = current->getDimension();
+
+    for (int i = 0; i < numWaveforms; i++)
+        streamingPCA->update(waveforms + size_t(i) * dim);
+
+    // a refined basis rotates the axes, which would move every polygon and
+    // ellipsoid drawn in this version over other spikes: hold it back
+    if (hasUnitsInBasis(*units.get(), current->getVersion()))
+        return;
+
+    PCABasis* basis = new PCABasis(dim, current->getVersion(), current->getRevision() + 1,
+                                   current->getNumComponents());
+
+    for (int i = 0; i < basis->getNumComponents(); i++)
+    {
+        streamingPCA->getComponent(i, basis->getComponent(i));
+        basis->eigenvalues[i] = streamingPCA->getEigenvalue(i);
+    }
+
+    streamingPCA->getMean(basis->getMean());
+    basis->numTrainingSpikes = streamingPCA->getNumSamples();
+
+    basis->updateProjectionMatrix();
+
+    // keep the previous ranges, widened to the batch as seen in the refined axes
+    for (int i = 0; i < basis->getNumComponents(); i++)
+    {
+        basis->rangeMin[i] = current->rangeMin[i];
+        basis->rangeMax[i] = current->rangeMax[i];
+    }
+
+    float proj[PCABasis::maxComponents];
+
+    for (int j = 0; j < numWaveforms; j++)
+    {
+        basis->project(waveforms + size_t(j) * dim, proj);
+
+        for (int i = 0; i < basis->getNumComponents(); i++)
+        {
+            basis->rangeMin[i] = std::min(basis->rangeMin[i], proj[i]);
+            basis->rangeMax[i] = std::max(basis->rangeMax[i], proj[i]);
+        }
+    }
+
+    pcaBasis.publish(basis);
+}
+
+bool Sorter::hasUnitsInBasis(const SorterUnits& currentUnits, int basisVersion)
+{
+    for (auto& unit : currentUnits.pcaUnits)
+    {
+        if (unit.basisVersion == basisVersion)
+            return true;
+    }
+
+    for (auto& unit : currentUnits.ellipsoidUnits)
+    {
+        if (unit.basisVersion == basisVersion)
+            return true;
+    }
+
+    return false;
+}
+
+bool Sorter::isStreamingPCAHeld()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const PCABasis* basis = pcaBasis.get();
+
+    return bStreamingEnabled && basis != nullptr && hasUnitsInBasis(*units.get(), basis->getVersion());
+}
+
+bool Sorter::requestClustering()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const PCABasis* basis = pcaBasis.get();
+
+    if (basis == nullptr || basis->getDimension() != spikeRing->getDimension())
+        return false;
+
+    const int64_t numSpikes = spikeRing->getNumSpikes();
+    const int64_t firstSpike = std::max(spikeRing->getOldestSpike(), numSpikes - spikeRing->getCapacity());
+
+    std::vector<float> waveform(basis->getDimension());
+    std::vector<float> x, y;
+
+    for (int64_t i = firstSpike; i < numSpikes; i++)
+    {
+        if (spikeRing->readSpike(i, waveform.data()))
+        {
+            float proj[PCABasis::maxComponents];
+            basis->project(waveform.data(), proj);
+
+            x.push_back(proj[0]);
+            y.push_back(proj[1]);
+        }
+    }
+
+    if (x.size() < ClusteringJob::minClusterSize)
+        return false;
+
+    pcaScheduler->addPCAjob(std::make_shared<ClusteringJob>(std::move(x), std::move(y), this, basis->getVersion()));
+
+    return true;
+}
+
+void Sorter::setClusteredUnits(const std::vector<cPolygon>& polygons, int basisVersion)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    if (pcaBasis.get() == nullptr || pcaBasis.get()->getVersion() != basisVersion)
+        return; // the projections no longer match the axes
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    newUnits->pcaUnits.clear();
+
+    for (auto& poly : polygons)
+    {
+        PCAUnit unit(poly, generateUnitId());
+        unit.updateColor();
+        unit.basisVersion = basisVersion;
+        newUnits->pcaUnits.push_back(unit);
+    }
+
+    publishUnits(newUnits);
+
+    bClusteringFinished = true;
+}
+
+bool Sorter::clusteringFinished()
+{
+    return bClusteringFinished.exchange(false);
+}
+
+bool Sorter::requestIsolationMetrics()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const PCABasis* basis = pcaBasis.get();
+
+    if (basis == nullptr || basis->getDimension() != spikeRing->getDimension())
+        return false;
+
+    const int64_t numSpikes = spikeRing->getNumSpikes();
+
+    if (isolationUnitsRevision == unitsRevision
+        && isolationBasisVersion == basis->getVersion()
+        && isolationBasisRevision == basis->getRevision()
+        && numSpikes - isolationNumSpikes < isolationRefreshSpikes)
+        return false;
+
+    isolationUnitsRevision = unitsRevision;
+    isolationBasisVersion = basis->getVersion();
+    isolationBasisRevision = basis->getRevision();
+    isolationNumSpikes = numSpikes;
+
+    // only units drawn or fitted in this basis can be evaluated in it
+    const SorterUnits* currentUnits = units.get();
+    const int numFeatures = std::min(basis->getNumComponents(), int(ClusterIsolation::maxDimension));
+
+    std::vector<const PCAUnit*> polygons;
+    std::vector<const EllipsoidUnit*> ellipsoids;
+    std::vector<int> unitIds;
+
+    for (auto& unit : currentUnits->pcaUnits)
+    {
+        if (unit.basisVersion == basis->getVersion())
+        {
+            polygons.push_back(&unit);
+            unitIds.push_back(unit.getUnitId());
+        }
+    }
+
+    for (auto& unit : currentUnits->ellipsoidUnits)
+    {
+        if (unit.basisVersion == basis->getVersion() && unit.getNumComponents() <= basis->getNumComponents())
+        {
+            ellipsoids.push_back(&unit);
+            unitIds.push_back(unit.getUnitId());
+        }
+    }
+
+    if (unitIds.empty())
+    {
+        isolation.clear();
+        return false;
+    }
+
+    const int64_t firstSpike = std::max(spikeRing->getOldestSpike(), numSpikes - spikeRing->getCapacity());
+
+    std::vector<float> waveform(basis->getDimension());
+    std::vector<float> features;
+    std::vector<int> labels;
+
+    for (int64_t i = firstSpike; i < numSpikes; i++)
+    {
+        if (!spikeRing->readSpike(i, waveform.data()))
+            continue;
+
+        float proj[PCABasis::maxComponents];
+        basis->project(waveform.data(), proj);
+
+        // same precedence as classifySpike() with PCA units first
+        int label = -1;
+
+        for (size_t u = 0; u < polygons.size() && label < 0; u++)
+        {
+            if (polygons[u]->isPointInsidePolygon(PointD(proj[0], proj[1])))
+                label = int(u);
+        }
+
+        for (size_t u = 0; u < ellipsoids.size() && label < 0; u++)
+        {
+            if (ellipsoids[u]->isPointInside(proj))
+                label = int(polygons.size() + u);
+        }
+
+        features.insert(features.end(), proj, proj + numFeatures);
+        labels.push_back(label);
+    }
+
+    if (labels.empty())
+        return false;
+
+    pcaScheduler->addPCAjob(std::make_shared<IsolationJob>(std::move(features), std::move(labels), std::move(unitIds),
+                                                           numFeatures, this, basis->getVersion()));
+
+    return true;
+}
+
+void Sorter::setIsolationMetrics(const std::vector<UnitIsolation>& metrics, int basisVersion)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    if (pcaBasis.get() == nullptr || pcaBasis.get()->getVersion() != basisVersion)
+        return; // the projections no longer match the units
+
+    isolation = metrics;
+}
+
+void Sorter::addPCAunit(PCAUnit unit)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    if (unit.basisVersion == 0 && pcaBasis.get() != nullptr)
+        unit.basisVersion = pcaBasis.get()->getVersion();
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    newUnits->pcaUnits.push_back(unit);
+    publishUnits(newUnits);
+}
+
+int Sorter::addTemplateUnit(int sourceUnitId, TemplateUnit::Metric metric)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+    const WaveformStats* source = nullptr;
+
+    for (auto& unit : currentUnits->boxUnits)
+    {
+        if (unit.getUnitId() == sourceUnitId)
+            source = unit.stats.get();
+    }
+
+    for (auto& unit : currentUnits->pcaUnits)
+    {
+        if (unit.getUnitId() == sourceUnitId)
+            source = unit.stats.get();
+    }
+
+    for (auto& unit : currentUnits->templateUnits)
+    {
+        if (unit.getUnitId() == sourceUnitId)
+            source = unit.stats.get();
+    }
+
+    const int channels = spikeChannel.numChannels > 0 ? spikeChannel.numChannels : numChannels;
+
+    TemplateUnit unit;
+
+    if (source == nullptr || !unit.setTemplate(*source, channels, metric))
+        return -1;
+
+    unit.unitId = Sorter::generateUnitId();
+    unit.updateColor();
+
+    SorterUnits* newUnits = new SorterUnits(*currentUnits);
+    newUnits->templateUnits.push_back(unit);
+    publishUnits(newUnits);
+
+    return unit.getUnitId();
+}
+
+bool Sorter::setTemplateThreshold(int unitId, float threshold)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->templateUnits.size(); k++)
+    {
+        if (currentUnits->templateUnits[k].getUnitId() == unitId)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->templateUnits[k].threshold = std::max(0.0f, threshold);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int Sorter::addEllipsoidUnit(int sourceUnitId)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+    const PCABasis* basis = pcaBasis.get();
+
+    if (basis == nullptr || basis->getDimension() != spikeRing->getDimension())
+        return -1;
+
+    const PCAUnit* source = nullptr;
+
+    for (auto& unit : currentUnits->pcaUnits)
+    {
+        if (unit.getUnitId() == sourceUnitId && unit.basisVersion == basis->getVersion())
+            source = &unit;
+    }
+
+    if (source == nullptr)
+        return -1;
+
+    const int n = basis->getNumComponents();
+    const int64_t numSpikes = spikeRing->getNumSpikes();
+    const int64_t firstSpike = std::max(spikeRing->getOldestSpike(), numSpikes - spikeRing->getCapacity());
+
+    std::vector<float> waveform(basis->getDimension());
+    std::vector<float> points;
+
+    for (int64_t i = firstSpike; i < numSpikes; i++)
+    {
+        if (spikeRing->readSpike(i, waveform.data()))
+        {
+            float proj[PCABasis::maxComponents];
+            basis->project(waveform.data(), proj);
+
+            if (source->isPointInsidePolygon(PointD(proj[0], proj[1])))
+                points.insert(points.end(), proj, proj + n);
+        }
+    }
+
+    EllipsoidUnit unit;
+
+    if (!unit.fit(points.data(), (int) points.size() / n, n))
+        return -1;
+
+    unit.unitId = Sorter::generateUnitId();
+    unit.basisVersion = basis->getVersion();
+    unit.updateColor();
+
+    SorterUnits* newUnits = new SorterUnits(*currentUnits);
+    newUnits->ellipsoidUnits.push_back(unit);
+    publishUnits(newUnits);
+
+    return unit.getUnitId();
+}
+
+bool Sorter::setEllipsoidRadius(int unitId, float radius)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->ellipsoidUnits.size(); k++)
+    {
+        if (currentUnits->ellipsoidUnits[k].getUnitId() == unitId)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->ellipsoidUnits[k].radius = std::max(0.0f, radius);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int Sorter::addBoxUnit(int channel)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const int unitId = generateUnitId();
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    BoxUnit unit(unitId);
+    newUnits->boxUnits.push_back(unit);
+    publishUnits(newUnits);
+
+    setSelectedUnitAndBox(unitId, 0);
+
+    return unitId;
+}
+
+int Sorter::addBoxUnit(int channel, Box B)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const int unitId = generateUnitId();
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    BoxUnit unit(B, unitId);
+    newUnits->boxUnits.push_back(unit);
+    publishUnits(newUnits);
+
+    setSelectedUnitAndBox(unitId, 0);
+
+    return unitId;
+}
+
+void Sorter::getUnitColor(int unitId, uint8_t& R, uint8_t& G, uint8_t& B)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+    
+    for (auto& unit : currentUnits->boxUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+            R = unit.colorRGB[0];
+            G = unit.colorRGB[1];
+            B = unit.colorRGB[2];
+            break;
+        }
+    }
+
+    for (auto& unit : currentUnits->pcaUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+            R = unit.colorRGB[0];
+            G = unit.colorRGB[1];
+            B = unit.colorRGB[2];
+            break;
+        }
+    }
+
+    for (auto& unit : currentUnits->templateUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+            R = unit.colorRGB[0];
+            G = unit.colorRGB[1];
+            B = unit.colorRGB[2];
+            break;
+        }
+    }
+
+    for (auto& unit : currentUnits->ellipsoidUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+            R = unit.colorRGB[0];
+            G = unit.colorRGB[1];
+            B = unit.colorRGB[2];
+            break;
+        }
+    }
+}
+
+
+int Sorter::generateUnitId()
+{
+
+    return nextUnitId++;
+
+}
+
+void Sorter::generateNewIds()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+
+    for (int k = 0; k < newUnits->boxUnits.size(); k++)
+    {
+        newUnits->boxUnits[k].unitId = generateUnitId();
+        newUnits->boxUnits[k].updateColor();
+    }
+    for (int k = 0; k < newUnits->pcaUnits.size(); k++)
+    {
+        newUnits->pcaUnits[k].unitId = generateUnitId();
+        newUnits->pcaUnits[k].updateColor();
+    }
+    for (int k = 0; k < newUnits->templateUnits.size(); k++)
+    {
+        newUnits->templateUnits[k].unitId = generateUnitId();
+        newUnits->templateUnits[k].updateColor();
+    }
+    for (int k = 0; k < newUnits->ellipsoidUnits.size(); k++)
+    {
+        newUnits->ellipsoidUnits[k].unitId = generateUnitId();
+        newUnits->ellipsoidUnits[k].updateColor();
+    }
+
+    publishUnits(newUnits);
+}
+
+void Sorter::removeAllUnits()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    publishUnits(new SorterUnits());
+}
+
+bool Sorter::removeUnit(int unitID)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    
+    std::cout << "Sorter::removeUnit() " << unitID << std::endl;
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->boxUnits.size(); k++)
+    {
+        if (currentUnits->boxUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->boxUnits.erase(newUnits->boxUnits.begin()+k);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    for (int k = 0; k < currentUnits->pcaUnits.size(); k++)
+    {
+        if (currentUnits->pcaUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->pcaUnits.erase(newUnits->pcaUnits.begin()+k);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    for (int k = 0; k < currentUnits->templateUnits.size(); k++)
+    {
+        if (currentUnits->templateUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->templateUnits.erase(newUnits->templateUnits.begin()+k);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    for (int k = 0; k < currentUnits->ellipsoidUnits.size(); k++)
+    {
+        if (currentUnits->ellipsoidUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->ellipsoidUnits.erase(newUnits->ellipsoidUnits.begin()+k);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    return false;
+
+}
+
+bool Sorter::addBoxToUnit(int channel, int unitID)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->boxUnits.size(); k++)
+    {
+        if (currentUnits->boxUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            BoxUnit& unit = newUnits->boxUnits[k];
+
+            Box B = unit.lstBoxes[unit.lstBoxes.size() - 1];
+            B.x += 100;
+            B.y -= 30;
+            B.channel = channel;
+            unit.addBox(B);
+            setSelectedUnitAndBox(unitID, (int) unit.lstBoxes.size() - 1);
+
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool Sorter::addBoxToUnit(int channel, int unitID, Box B)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->boxUnits.size(); k++)
+    {
+        if (currentUnits->boxUnits[k].getUnitId() == unitID)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            newUnits->boxUnits[k].addBox(B);
+            publishUnits(newUnits);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<BoxUnit> Sorter::getBoxUnits()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    std::vector<BoxUnit> unitsCopy = units.get()->boxUnits;
+    return unitsCopy;
+}
+
+
+std::vector<PCAUnit> Sorter::getPCAUnits()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    std::vector<PCAUnit> unitsCopy = units.get()->pcaUnits;
+    return unitsCopy;
+}
+
+std::vector<TemplateUnit> Sorter::getTemplateUnits()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    std::vector<TemplateUnit> unitsCopy = units.get()->templateUnits;
+    return unitsCopy;
+}
+
+std::vector<EllipsoidUnit> Sorter::getEllipsoidUnits()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+    std::vector<EllipsoidUnit> unitsCopy = units.get()->ellipsoidUnits;
+    return unitsCopy;
+}
+
+static void addUnitQuality(std::vector<UnitQuality>& quality, int unitId, const WaveformStats& stats,
+                           const UnitMetrics& metrics, int numChannels, double now,
+                           const std::vector<UnitIsolation>& isolation)
+{
+    UnitQuality unitQuality;
+    unitQuality.unitId = unitId;
+
+    if (!metrics.getQuality(unitQuality, now))
+        return;
+
+    unitQuality.snr = UnitMetrics::computeSNR(stats, numChannels);
+
+    for (auto& unitIsolation : isolation)
+    {
+        if (unitIsolation.unitId == unitId)
+        {
+            unitQuality.isolationDistance = unitIsolation.isolationDistance;
+            unitQuality.lRatio = unitIsolation.lRatio;
+        }
+    }
+
+    quality.push_back(unitQuality);
+}
+
+std::vector<UnitQuality> Sorter::getUnitQuality()
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+    const int channels = spikeChannel.numChannels > 0 ? spikeChannel.numChannels : numChannels;
+
+    // a unit that stopped firing should show a falling rate, so rates are
+    // measured up to the latest spike on the electrode, not the unit's own
+    double now = 0;
+    int64_t timestamp = 0;
+    const int64_t numSpikes = spikeRing->getNumSpikes();
+
+    if (numSpikes > 0 && spikeChannel.sampleRate > 0
+        && spikeRing->readSpike(numSpikes - 1, nullptr, nullptr, nullptr, nullptr, &timestamp))
+        now = timestamp / double(spikeChannel.sampleRate);
+
+    std::vector<UnitQuality> quality;
+
+    for (auto& unit : currentUnits->boxUnits)
+        addUnitQuality(quality, unit.getUnitId(), *unit.stats, *unit.metrics, channels, now, isolation);
+
+    for (auto& unit : currentUnits->pcaUnits)
+        addUnitQuality(quality, unit.getUnitId(), *unit.stats, *unit.metrics, channels, now, isolation);
+
+    for (auto& unit : currentUnits->templateUnits)
+        addUnitQuality(quality, unit.getUnitId(), *unit.stats, *unit.metrics, channels, now, isolation);
+
+    for (auto& unit : currentUnits->ellipsoidUnits)
+        addUnitQuality(quality, unit.getUnitId(), *unit.stats, *unit.metrics, channels, now, isolation);
+
+    return quality;
+}
+
+void Sorter::updatePCAUnits(std::vector<PCAUnit> _units)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    newUnits->pcaUnits = _units;
+    publishUnits(newUnits);
+}
+
+void Sorter::updateBoxUnits(std::vector<BoxUnit> _units)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    SorterUnits* newUnits = new SorterUnits(*units.get());
+    newUnits->boxUnits = _units;
+    publishUnits(newUnits);
+}
+
+
+bool Sorter::checkBoxUnits(const SorterSpikePtr& spike, const SorterUnits& currentUnits)
+{
+    for (auto& unit : currentUnits.boxUnits)
+    {
+        if (unit.isWaveFormInsideAllBoxes(spike))
+        {
+            spike->sortedId = unit.getUnitId();
+            spike->color[0] = unit.colorRGB[0];
+            spike->color[1] = unit.colorRGB[1];
+            spike->color[2] = unit.colorRGB[2];
+            unit.updateWaveform(spike);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Sorter::checkPCAUnits(const SorterSpikePtr& spike, const SorterUnits& currentUnits)
+{
+    const PCAUnitGrid* grid = currentUnits.pcaGrid.get();
+
+    // one lookup for all units drawn in the spike's basis
+    if (grid != nullptr && spike->basisVersion != 0 && spike->basisVersion == grid->getBasisVersion())
+    {
+        const int index = grid->findUnit(spike->pcProj[0], spike->pcProj[1], currentUnits.pcaUnits);
+
+        if (index == PCAUnitGrid::noUnit)
+            return false;
+
+        const PCAUnit& unit = currentUnits.pcaUnits[index];
+
+        spike->sortedId = unit.getUnitId();
+        spike->color[0] = unit.colorRGB[0];
+        spike->color[1] = unit.colorRGB[1];
+        spike->color[2] = unit.colorRGB[2];
+        unit.updateWaveform(spike);
+        return true;
+    }
+
+    for (auto& unit : currentUnits.pcaUnits)
+    {
+        // polygons drawn in another basis don't describe this projection
+        if (spike->basisVersion == 0 || unit.basisVersion != spike->basisVersion)
+            continue;
+
+        if (unit.isWaveFormInsidePolygon(spike))
+        {
+            spike->sortedId = unit.getUnitId();
+            spike->color[0] = unit.colorRGB[0];
+            spike->color[1] = unit.colorRGB[1];
+            spike->color[2] = unit.colorRGB[2];
+            unit.updateWaveform(spike);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Sorter::checkEllipsoidUnits(const SorterSpikePtr& spike, const SorterUnits& currentUnits)
+{
+    if (spike->basisVersion == 0)
+        return false;
+
+    for (auto& unit : currentUnits.ellipsoidUnits)
+    {
+        // ellipsoids fitted in another basis don't describe this projection
+        if (unit.basisVersion != spike->basisVersion)
+            continue;
+
+        if (unit.isWaveFormInside(spike))
+        {
+            spike->sortedId = unit.getUnitId();
+            spike->color[0] = unit.colorRGB[0];
+            spike->color[1] = unit.colorRGB[1];
+            spike->color[2] = unit.colorRGB[2];
+            unit.updateWaveform(spike);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Sorter::checkTemplateUnits(const SorterSpikePtr& spike, const SorterUnits& currentUnits)
+{
+    const TemplateBank* bank = currentUnits.templateBank.get();
+
+    if (bank == nullptr)
+        return false;
+
+    const int index = bank->findUnit(spike->getData(), spike->getDimension());
+
+    if (index == TemplateBank::noUnit)
+        return false;
+
+    const TemplateUnit& unit = currentUnits.templateUnits[index];
+
+    spike->sortedId = unit.getUnitId();
+    spike->color[0] = unit.colorRGB[0];
+    spike->color[1] = unit.colorRGB[1];
+    spike->color[2] = unit.colorRGB[2];
+    unit.updateWaveform(spike);
+    return true;
+}
+
+bool Sorter::sortSpike(SorterSpikePtr spike, bool PCAfirst)
+{
+    // never blocks: editors publish a new set of units instead of modifying this one
+    LockFreeSnapshot<SorterUnits>::ScopedRead currentUnits(units);
+
+    return classifySpike(spike, *currentUnits, PCAfirst);
+}
+
+int Sorter::sortBatch(const SorterSpikePtr* spikes, int numSpikes, bool PCAfirst)
+{
+    projectOnPrincipalComponents(spikes, numSpikes);
+
+    // the whole burst is classified against the same set of units
+    LockFreeSnapshot<SorterUnits>::ScopedRead currentUnits(units);
+
+    int numSorted = 0;
+
+    for (int i = 0; i < numSpikes; i++)
+    {
+        if (classifySpike(spikes[i], *currentUnits, PCAfirst))
+            numSorted++;
+    }
+
+    return numSorted;
+}
+
+bool Sorter::classifySpike(const SorterSpikePtr& spike, const SorterUnits& currentUnits, bool PCAfirst)
+{
+    if (PCAfirst)
+    {
+        if (checkPCAUnits(spike, currentUnits))
+            return true;
+
+        if (checkEllipsoidUnits(spike, currentUnits))
+            return true;
+
+        if (checkBoxUnits(spike, currentUnits))
+            return true;
+    }
+    else
+    {
+        if (checkBoxUnits(spike, currentUnits))
+            return true;
+
+        if (checkPCAUnits(spike, currentUnits))
+            return true;
+
+        if (checkEllipsoidUnits(spike, currentUnits))
+            return true;
+    }
+
+    return checkTemplateUnits(spike, currentUnits);
+}
+
+
+bool Sorter::removeBoxFromUnit(int unitId, int boxIndex)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const SorterUnits* currentUnits = units.get();
+
+    for (int k = 0; k < currentUnits->boxUnits.size(); k++)
+    {
+        if (currentUnits->boxUnits[k].getUnitId() == unitId)
+        {
+            SorterUnits* newUnits = new SorterUnits(*currentUnits);
+            bool s= newUnits->boxUnits[k].deleteBox(boxIndex);
+            publishUnits(newUnits);
+            setSelectedUnitAndBox(-1,-1);
+
+            return s;
+        }
+    }
+
+    return false;
+}
+
+std::vector<Box> Sorter::getUnitBoxes(int unitId)
+{
+    std::vector<Box> boxes;
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    for (auto& unit : units.get()->boxUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+
+            boxes = unit.lstBoxes;
+
+            return boxes;
+        }
+    }
+
+    return boxes;
+}
+
+
+int Sorter::getNumBoxes(int unitId)
+{
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    for (auto& unit : units.get()->boxUnits)
+    {
+        if (unit.getUnitId() == unitId)
+        {
+
+            int n = (int) unit.lstBoxes.size();
+            return n;
+        }
+    }
+
+    return -1;
+}
+
+SorterState Sorter::getState()
+{
+    SorterState state;
+
+    state.selectedUnit = selectedUnit;
+    state.selectedBox = selectedBox;
+
+    state.numChannels = numChannels;
+    state.waveformLength = waveformLength;
+
+    getPCArange(state.pcMin[0], state.pcMin[1], state.pcMin[2], state.pcMax[0], state.pcMax[1], state.pcMax[2]);
+
+    state.streaming = bStreamingEnabled;
+    state.forgettingFactor = forgettingFactor;
+    state.trainingSetSize = trainingSetSize;
+
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    const PCABasis* basis = pcaBasis.get();
+
+    state.numComponents = numPCAComponents;
+    state.numLocalChannels = numLocalPCAChannels;
+
+    if (basis != nullptr)
+    {
+        const int length = basis->getComponentLength();
+
+        state.basisVersion = basis->getVersion();
+        state.numTrainingSpikes = basis->numTrainingSpikes;
+        state.basisLocalChannels = basis->getNumLocalChannels();
+        state.peakSample = basis->getPeakSample();
+
+        state.numComponents = basis->getNumComponents();
+        state.components.assign(basis->getComponent(0),
+                                basis->getComponent(0) + size_t(basis->getNumStoredComponents()) * length);
+        state.mean.assign(basis->getMean(), basis->getMean() + length);
+
+        for (int i = 0; i < basis->getNumStoredComponents(); i++)
+            state.eigenvalues[i] = basis->eigenvalues[i];
+    }
+
+    state.boxUnits = units.get()->boxUnits;
+    state.pcaUnits = units.get()->pcaUnits;
+    state.templateUnits = units.get()->templateUnits;
+    state.ellipsoidUnits = units.get()->ellipsoidUnits;
+
+    return state;
+}
+
+void Sorter::setState(const SorterState& state)
+{
+    selectedUnit = state.selectedUnit;
+    selectedBox = state.selectedBox;
+
+    const std::lock_guard<std::mutex> myScopedLock(mut);
+
+    numChannels = state.numChannels;
+    waveformLength = state.waveformLength;
+
+    pc1min = state.pcMin[0];
+    pc2min = state.pcMin[1];
+    pc3min = state.pcMin[2];
+    pc1max = state.pcMax[0];
+    pc2max = state.pcMax[1];
+    pc3max = state.pcMax[2];
+
+    bStreamingEnabled = state.streaming;
+    forgettingFactor = std::min(1.0f, std::max(0.5f, state.forgettingFactor));
+    numPCAComponents = std::min(PCABasis::maxComponents, std::max(PCABasis::defaultComponents, state.numComponents));
+    numLocalPCAChannels = PCABasis::clampLocalChannels(state.numLocalChannels, numChannels, numPCAComponents);
+    setTrainingSetSize(state.trainingSetSize);
+
+    // versions are local to a session, so the saved basis gets a new one
+    int loadedBasisVersion = 0;
+
+    if (state.basisVersion > 0)
+    {
+        std::unique_ptr<PCABasis> basis;
+
+        if (state.basisLocalChannels > 0)
+        {
+            SpikeChannelDescriptor layout;
+            layout.numChannels = numChannels;
+            layout.numSamples = waveformLength;
+            layout.prePeakSamples = state.peakSample - 1;
+
+            basis.reset(new PCABasis(layout, state.basisLocalChannels, latestBasisVersion + 1, state.numComponents));
+        }
+        else
+        {
+            basis.reset(new PCABasis(waveformLength * numChannels, latestBasisVersion + 1, 0, state.numComponents));
+        }
+
+        const int length = basis->getComponentLength();
+        const size_t numValues = size_t(basis->getNumStoredComponents()) * length;
+
+        if (length > 0 && state.components.size() >= numValues)
+        {
+            latestBasisVersion++;
+
+            std::copy(state.components.begin(), state.components.begin() + numValues, basis->getComponent(0));
+
+            if (state.mean.size() >= size_t(length))
+                std::copy(state.mean.begin(), state.mean.begin() + length, basis->getMean());
+
+            basis->numTrainingSpikes = state.numTrainingSpikes;
+
+            for (int i = 0; i < basis->getNumStoredComponents(); i++)
+                basis->eigenvalues[i] = state.eigenvalues[i];
+
+            loadedBasisVersion = basis->getVersion();
+            basis->updateProjectionMatrix();
+            pcaBasis.publish(basis.get());
+            bPCAJobFinished = true;
+
+            if (bStreamingEnabled)
+                seedStreamingPCA(basis.get());
+
+            basis.release();
+        }
+    }
+
+    SorterUnits* newUnits = new SorterUnits();
+
+    for (PCAUnit pcaUnit : state.pcaUnits)
+    {
+        nextUnitId = std::max(pcaUnit.unitId + 1, nextUnitId.load());
+
+        // 0 (unknown) is adopted by the next basis; -1 marks a polygon drawn in an older basis
+        if (pcaUnit.basisVersion != 0)
+            pcaUnit.basisVersion = pcaUnit.basisVersion == state.basisVersion ? loadedBasisVersion : -1;
+
+        newUnits->pcaUnits.push_back(pcaUnit);
+    }
+
+    for (auto& boxUnit : state.boxUnits)
+    {
+        nextUnitId = std::max(boxUnit.unitId + 1, nextUnitId.load());
+
+        newUnits->boxUnits.push_back(boxUnit);
+    }
+
+    for (auto& templateUnit : state.templateUnits)
+    {
+        nextUnitId = std::max(templateUnit.unitId + 1, nextUnitId.load());
+
+        newUnits->templateUnits.push_back(templateUnit);
+    }
+
+    for (EllipsoidUnit ellipsoidUnit : state.ellipsoidUnits)
+    {
+        nextUnitId = std::max(ellipsoidUnit.unitId + 1, nextUnitId.load());
+
+        // ellipsoids are always fitted in a known basis, so only the saved one still applies
+        ellipsoidUnit.basisVersion = ellipsoidUnit.basisVersion == state.basisVersion ? loadedBasisVersion : -1;
+
+        newUnits->ellipsoidUnits.push_back(ellipsoidUnit);
+    }
+
+    publishUnits(newUnits);
+}
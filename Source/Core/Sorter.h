@@ -0,0 +1,523 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SORTER_H
+#define __SORTER_H
+
+#include "Containers.h"
+#include "SpikeRing.h"
+#include "TrainingReservoir.h"
+#include "PCABasis.h"
+#include "LockFreeSnapshot.h"
+#include "IncrementalPCA.h"
+#include "BoxUnit.h"
+#include "PCAUnit.h"
+#include "PCAUnitGrid.h"
+#include "TemplateUnit.h"
+#include "EllipsoidUnit.h"
+#include "ClusterIsolation.h"
+
+#include <algorithm>    // std::sort
+#include <list>
+#include <queue>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class PCAJobScheduler;
+
+/**
+    Immutable set of units for one electrode
+
+    Editors copy the current set, modify the copy and publish it as a whole,
+    so the sorting thread always classifies against a consistent set.
+*/
+class SorterUnits
+{
+public:
+
+    std::vector<BoxUnit> boxUnits;
+    std::vector<PCAUnit> pcaUnits;
+
+    /** Rasterized pcaUnits (rebuilt by the Sorter whenever it publishes a set) */
+    std::shared_ptr<const PCAUnitGrid> pcaGrid;
+
+    std::vector<TemplateUnit> templateUnits;
+
+    /** Packed templateUnits (rebuilt by the Sorter whenever it publishes a set) */
+    std::shared_ptr<const TemplateBank> templateBank;
+
+    std::vector<EllipsoidUnit> ellipsoidUnits;
+};
+
+/**
+    Plain-data copy of a Sorter's settings and units
+
+    This is what the host saves with its configuration. PCA units record
+    the version of the basis their polygon was drawn in: basisVersion if it
+    is the basis below, 0 if unknown, or anything else for an older basis.
+*/
+struct SorterState
+{
+    int selectedUnit = -1;
+    int selectedBox = -1;
+
+    int numChannels = 0;
+    int waveformLength = 0;
+
+    float pcMin[3] = { -5, -5, -5 };
+    float pcMax[3] = { 5, 5, 5 };
+
+    bool streaming = false;
+    float forgettingFactor = 0.999f;
+
+    /** Number of spikes in the PCA training sample */
+    int trainingSetSize = TrainingReservoir::defaultCapacity;
+
+    /** Version of the saved basis (0 if there is none) */
+    int basisVersion = 0;
+
+    /** Channels per spike used by new PCA jobs (0 for the whole waveform) */
+    int numLocalChannels = 0;
+
+    /**
+        The basis: numComponents x dimension values, the training mean and the eigenvalues
+
+        A channel-local basis (basisLocalChannels > 0) stores fewer components,
+        of waveformLength values each, and ranks channels at peakSample.
+    */
+    int basisLocalChannels = 0;
+    int peakSample = 0;
+    int numComponents = PCABasis::defaultComponents;
+    std::vector<float> components;
+    std::vector<float> mean;
+    float eigenvalues[PCABasis::maxComponents] = { };
+    int64_t numTrainingSpikes = 0;
+
+    std::vector<BoxUnit> boxUnits;
+    std::vector<PCAUnit> pcaUnits;
+    std::vector<TemplateUnit> templateUnits;
+    std::vector<EllipsoidUnit> ellipsoidUnits;
+
+    /** Rasterized pcaUnits (rebuilt by the Sorter whenever it publishes a set) */
+    std::shared_ptr<const PCAUnitGrid> pcaGrid;
+};
+
+/** 
+    Sorts spikes from a single electrode (any number of channels)
+
+    Each Sorter can have an arbitrary number of Box units, PCA Units,
+    Ellipsoid units and Template units. Ellipsoid units are tested right
+    after the PCA polygons; template units are tested last, so a spike
+    inside a drawn unit keeps that unit.
+
+    Per-spike cost for N channels of S samples: the projection and the
+    template distances are O(N*S) (vectorized), while box, polygon and
+    ellipsoid tests do not depend on N. Fitting the basis is O(M*(N*S)^2)
+    for M training spikes, and runs on the PCA worker threads.
+
+    The "sorting thread" below is whichever thread sorts this electrode's
+    spikes: the processing thread, or, with parallel sorting, the
+    SortingPool worker (or the processing thread, past the deadline) that
+    runs the block's SortTask. Only one of them runs at a time, and
+    SortingPool::waitForAll orders their accesses from one block to the next.
+*/
+class Sorter
+{
+public:
+
+    /** Constructor (the ring holds the electrode's recent spikes, and sets the waveform shape) */
+    Sorter(SpikeRing* spikeRing, PCAJobScheduler* pcaScheduler);
+
+    /** Destructor */
+    ~Sorter();
+
+    /** Sets the size of the waveform (in samples) and re-set PCA calculation */
+    void resizeWaveform(int numSamples);
+
+    /** Sets the layout and sample rate of incoming spikes, which box units are compiled for */
+    void setChannel(const SpikeChannelDescriptor& channel);
+
+    /** Tests whether a candidate spike belongs to one of the defined units*/
+    bool sortSpike(SorterSpikePtr so, bool PCAfirst);
+
+    /**
+        Projects and sorts a burst of spikes from this electrode (sorting thread only)
+
+        Same result as projectOnPrincipalComponents + sortSpike for each
+        spike, but the projection runs as one batch and every spike is
+        tested against the same set of units. Returns the number of spikes
+        assigned to a unit.
+    */
+    int sortBatch(const SorterSpikePtr* spikes, int numSpikes, bool PCAfirst);
+
+    /** Projects a spike waveform into PC space */
+	void projectOnPrincipalComponents(SorterSpikePtr so);
+
+    /** Projects a burst of spikes into PC space at once (sorting thread only) */
+    void projectOnPrincipalComponents(const SorterSpikePtr* spikes, int numSpikes);
+
+    /** Gets the RGB color values for a unit */
+    void getUnitColor(int unitId, uint8_t& R, uint8_t& G, uint8_t& B);
+	
+    /** Triggers re-calculation of PCs */
+    void RePCA();
+
+    /** Takes ownership of a finished PC basis and publishes it, unless a newer one was requested since */
+    void setPCABasis(PCABasis* basis);
+
+    /** Returns the version of the current PC basis (0 if none) */
+    int getPCABasisVersion();
+
+    /**
+        Sets the number of principal components computed by the next PCA jobs
+
+        Clamped to PCABasis::defaultComponents .. PCABasis::maxComponents.
+        The display keeps showing the first components; the others are used
+        by ellipsoid units. A change triggers a new PCA.
+    */
+    void setNumComponents(int numComponents);
+
+    /** Returns the number of principal components requested for the basis */
+    int getNumComponents() const;
+
+    /**
+        Makes the next PCA jobs compute a channel-local basis (see PCABasis)
+
+        Each spike is then projected only on numLocalChannels channels
+        around its peak channel, so that fitting and projection stay cheap
+        on wide electrode groups. 0 fits the basis to the whole waveform.
+        Clamped by PCABasis::clampLocalChannels (again when the number of
+        components changes); a change triggers a new PCA. A local basis is
+        not refined by streaming PCA.
+    */
+    void setLocalChannels(int numLocalChannels);
+
+    /** Returns the number of channels each spike is projected on, as clamped (0 for the whole waveform) */
+    int getLocalChannels() const;
+
+    /**
+        Sets the number of spikes the basis is fitted to
+
+        Spikes are sampled uniformly from the whole recording (see
+        TrainingReservoir). The first basis is computed once that many
+        spikes have arrived; Re-PCA refits the basis to the current sample.
+        A new size starts a new sample. Clamped to minTrainingSetSize ..
+        maxTrainingSetSize.
+    */
+    void setTrainingSetSize(int numSpikes);
+
+    /** Returns the number of spikes the basis is fitted to */
+    int getTrainingSetSize() const;
+
+    static const int minTrainingSetSize = 100;
+    static const int maxTrainingSetSize = 50000;
+
+    /**
+        Turns streaming PCA on or off
+
+        In streaming mode, the basis keeps following the incoming spikes
+        (see IncrementalPCA); forgettingFactor sets how quickly old spikes
+        are forgotten. Refinements keep the basis version, so they are only
+        published while no PCA or ellipsoid unit is defined in that version:
+        rotating the axes under a polygon or ellipsoid would make it select
+        other spikes. While such units exist the estimate keeps learning but
+        the basis is held (see isStreamingPCAHeld()); it moves again once
+        they are deleted, or a Re-PCA gives them a new version to be drawn in.
+    */
+    void setStreamingPCA(bool enabled, float forgettingFactor);
+
+    /** Returns true if the basis is updated from incoming spikes */
+    bool isStreamingPCAEnabled() const;
+
+    /** Returns true if streaming PCA is on but held back by units drawn in the current basis */
+    bool isStreamingPCAHeld();
+
+    /** Returns the forgetting factor used in streaming mode */
+    float getForgettingFactor() const;
+
+    /** Refines the current basis with a batch of waveforms (called from a PCA worker thread) */
+    void updateStreamingPCA(const float* waveforms, int numWaveforms, int basisVersion);
+
+    /**
+        Clusters the spikes held in the ring on a PCA worker thread
+
+        The spikes are projected in the current basis right away; the
+        clusters replace all PCA units when the job is done (see
+        ClusteringJob). Returns false if there is no basis yet or too few
+        spikes.
+    */
+    bool requestClustering();
+
+    /** Replaces the PCA units with clustered polygons (called from a PCA worker thread) */
+    void setClusteredUnits(const std::vector<cPolygon>& polygons, int basisVersion);
+
+    /** Returns true once after clustering has replaced the PCA units (to refresh the display) */
+    bool clusteringFinished();
+
+    /**
+        Evaluates the isolation of the PCA and ellipsoid units on a PCA worker thread
+
+        The spikes held in the ring are projected and assigned to a unit
+        right away (see requestClustering); the metrics replace the previous
+        ones when the job is done (see IsolationJob and getUnitQuality).
+        Nothing is queued unless the units or the basis changed, or
+        isolationRefreshSpikes spikes arrived, since the last request, so
+        this can be called at every display refresh. Returns true if a job
+        was queued.
+    */
+    bool requestIsolationMetrics();
+
+    /** Replaces the isolation metrics of the units (called from a PCA worker thread) */
+    void setIsolationMetrics(const std::vector<UnitIsolation>& metrics, int basisVersion);
+
+    /** New spikes after which requestIsolationMetrics() evaluates unchanged units again */
+    static const int isolationRefreshSpikes = 150;
+
+    /** Adds a new PCA unit (drawn in the current PC basis, unless the unit records another one) */
+    void addPCAunit(PCAUnit unit);
+
+    /**
+        Adds a template unit seeded from the mean waveform of an existing unit
+
+        Returns the ID of the new unit, or -1 if the source unit is unknown
+        or has not collected enough spikes yet.
+    */
+    int addTemplateUnit(int sourceUnitId, TemplateUnit::Metric metric);
+
+    /** Changes the distance threshold of a template unit (see TemplateUnit::threshold) */
+    bool setTemplateThreshold(int unitId, float threshold);
+
+    /**
+        Adds an ellipsoid unit fitted to the spikes inside a PCA unit
+
+        The spikes held in the ring are projected on every component of the
+        current basis, and the ellipsoid is fitted to those whose first two
+        projections are inside the polygon. Returns the ID of the new unit,
+        or -1 if the source is not a PCA unit drawn in the current basis or
+        holds too few spikes.
+    */
+    int addEllipsoidUnit(int sourceUnitId);
+
+    /** Changes the Mahalanobis radius of an ellipsoid unit */
+    bool setEllipsoidRadius(int unitId, float radius);
+
+    /** Adds a new unit with a single box at some default location */
+    int addBoxUnit(int channel);
+
+    /** Adds a new unit with a custom box */
+    int addBoxUnit(int channel, Box B);
+
+    /** Adds a new box to a unit at a default location */
+    bool addBoxToUnit(int channel, int unitId);
+
+    /** Adds a new custom box to a unit */
+    bool addBoxToUnit(int channel, int unitId, Box B);
+
+    /** Removes a box from a unit based on index */
+    bool removeBoxFromUnit(int unitId, int boxIndex);
+
+    /** Returns the number of boxes for a given unit*/
+    int getNumBoxes(int unitId);
+
+    /** Removes a unit by ID */
+    bool removeUnit(int unitId);
+
+    /** Removes all units from this sorter */
+    void removeAllUnits();
+
+    /** Copies the range values for the PC axes */
+    void getPCArange(float& p1min, float& p2min, float& p3min, float& p1max, float& p2max, float& p3max);
+
+    /** Sets the range values for the PC axes */
+    void setPCArange(float p1min, float p2min, float p3min, float p1max, float p2max, float p3max);
+
+    /** Sets bPCAJobFinished to false */
+    void resetJobStatus();
+
+    /** Returns true if calculation is finished*/
+    bool isPCAfinished();
+
+    /** Returns true if calculation is finished*/
+    bool firstJobFinished();
+
+    /** Returns a vector of all boxes for a BoxUnit */
+    std::vector<Box> getUnitBoxes(int unitId);
+
+    /** Returns a vector of all BoxUnits */
+    std::vector<BoxUnit> getBoxUnits();
+
+    /** Returns a vector of all PCAUnits */
+    std::vector<PCAUnit> getPCAUnits();
+
+    /** Returns a vector of all TemplateUnits */
+    std::vector<TemplateUnit> getTemplateUnits();
+
+    /** Returns a vector of all EllipsoidUnits */
+    std::vector<EllipsoidUnit> getEllipsoidUnits();
+
+    /**
+        Returns the live quality figures of every unit
+
+        Rates are relative to the latest spike on the electrode; isolation
+        figures are the latest computed by requestIsolationMetrics().
+    */
+    std::vector<UnitQuality> getUnitQuality();
+
+    /** Sets the BoxUnits for this Sorter */
+    void updateBoxUnits(std::vector<BoxUnit> _units);
+
+    /** Sets the PCAUnits for this Sorter */
+    void updatePCAUnits(std::vector<PCAUnit> _units);
+
+    /** Generates the next global unit ID (across all Sorters) */
+    static int generateUnitId();
+
+    /** Re-generates IDs for all units */
+    void generateNewIds();
+
+    /** Selects a box for a particular unit */
+    void setSelectedUnitAndBox(int unitId, int boxId);
+
+    /** Returns the selected unit and box*/
+    void getSelectedUnitAndBox(int& unitId, int& boxId);
+
+    /** Returns a copy of the sorting parameters for this electrode (for saving) */
+    SorterState getState();
+
+    /** Restores sorting parameters saved with getState() (replaces all units) */
+    void setState(const SorterState& state);
+
+private:
+
+    /** Tests whether a candidate spike belongs to one of the available BoxUnits*/
+    bool checkBoxUnits(const SorterSpikePtr& so, const SorterUnits& currentUnits);
+
+    /** Tests whether a candidate spike belongs to one of the available PCAUnits*/
+    bool checkPCAUnits(const SorterSpikePtr& so, const SorterUnits& currentUnits);
+
+    /** Tests whether a candidate spike belongs to one of the available EllipsoidUnits*/
+    bool checkEllipsoidUnits(const SorterSpikePtr& so, const SorterUnits& currentUnits);
+
+    /** Tests whether a candidate spike belongs to one of the available TemplateUnits*/
+    bool checkTemplateUnits(const SorterSpikePtr& so, const SorterUnits& currentUnits);
+
+    /** Tests a spike against one set of units (see sortSpike) */
+    bool classifySpike(const SorterSpikePtr& so, const SorterUnits& currentUnits, bool PCAfirst);
+
+    /** Compiles the units of a new unit set and makes it current (caller holds mut) */
+    void publishUnits(SorterUnits* newUnits);
+
+    /** Returns true if a PCA or ellipsoid unit is defined in a basis version */
+    static bool hasUnitsInBasis(const SorterUnits& currentUnits, int basisVersion);
+
+    /** Restarts the streaming estimate from a basis (caller holds mut) */
+    void seedStreamingPCA(const PCABasis* basis);
+
+    /** Hands the spikes that arrived since the last streaming update to the PCA workers */
+    void submitStreamingJob(int basisVersion);
+
+    /** Offers a spike to the training sample, switching to a new sample if one was requested (sorting thread only) */
+    void addTrainingSpike(const SorterSpikeContainer* spike);
+
+    /** Serializes editors of the unit set and PC basis (never taken by the sorting thread) */
+    std::mutex mut;
+
+    PCAJobScheduler* pcaScheduler;
+
+    SpikeRing* spikeRing;
+
+    /** Shared by all Sorters (and used by PCA workers, for clustered units) */
+    static std::atomic<int> nextUnitId;
+
+    int numChannels, waveformLength;
+
+    /** Electrode that box units are compiled for (guarded by mut) */
+    SpikeChannelDescriptor spikeChannel;
+    int selectedUnit, selectedBox;
+    
+    std::atomic<float> pc1min, pc2min, pc3min, pc1max, pc2max, pc3max;
+    
+    /** Training sample for full PCA jobs (written by the sorting thread, shared with queued jobs) */
+    std::shared_ptr<TrainingReservoir> trainingSet;
+
+    /** Sample of a new size, waiting to replace trainingSet (set by setTrainingSetSize) */
+    std::atomic<TrainingReservoir*> pendingTrainingSet;
+    
+    bool bPCAJobSubmitted,bPCAComputed, bRePCA, bPCAFirstJobFinished;
+    std::atomic<bool> bPCAJobFinished;
+
+    /** Set when clustered units were published, cleared by clusteringFinished() */
+    std::atomic<bool> bClusteringFinished;
+
+    /** Incremented whenever a new set of units is published (guarded by mut) */
+    int64_t unitsRevision;
+
+    /** Units, basis and spike count the latest isolation job was requested for (guarded by mut) */
+    int64_t isolationUnitsRevision;
+    int isolationBasisVersion, isolationBasisRevision;
+    int64_t isolationNumSpikes;
+
+    /** Latest isolation metrics (guarded by mut) */
+    std::vector<UnitIsolation> isolation;
+
+    LockFreeSnapshot<SorterUnits> units;
+
+    /** Basis used for projection; jobs fill a private basis and swap it in when done */
+    LockFreeSnapshot<PCABasis> pcaBasis;
+
+    /** Version of the most recently requested basis (older results are discarded) */
+    std::atomic<int> latestBasisVersion;
+
+    /** Number of components computed by new PCA jobs */
+    std::atomic<int> numPCAComponents;
+
+    /** Channels per spike used by new PCA jobs (0 for the whole waveform) */
+    std::atomic<int> numLocalPCAChannels;
+
+    /** Capacity of the latest requested training sample */
+    std::atomic<int> trainingSetSize;
+
+    /** Streaming estimate that refines the current basis (guarded by mut) */
+    std::unique_ptr<IncrementalPCA> streamingPCA;
+
+    std::atomic<bool> bStreamingEnabled, bStreamingJobPending;
+    std::atomic<float> forgettingFactor;
+
+    /** Number of new spikes handed to each streaming update */
+    int streamingBatchSize;
+
+    /** First spike not yet seen by the streaming estimate, and the basis it refines (sorting thread only) */
+    int64_t nextStreamingSpike;
+    int streamingBasisVersion;
+
+    /** Scratch space for batch projection (sorting thread only) */
+    std::vector<const float*> batchWaveforms;
+    AlignedHeapBlock<float> batchProjections;
+
+};
+
+
+#endif // __SPIKESORTBOXES_H
@@ -0,0 +1,266 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SortingPool.h"
+#include "Sorter.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+static double microsecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+SortingPool::SortingPool(int numWorkers_)
+    : numWorkers(numWorkers_),
+      running(false),
+      shouldExit(false),
+      deadlineMs(1.0),
+      numTasks(0),
+      numFallbacks(0),
+      numMissedDeadlines(0),
+      numWaits(0),
+      totalWaitUs(0),
+      maxWaitUs(0)
+{
+    // leave one core to the processing thread
+    if (numWorkers <= 0)
+        numWorkers = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+}
+
+SortingPool::~SortingPool()
+{
+    shouldExit = true;
+
+    for (auto& worker : workers)
+    {
+        {
+            std::lock_guard<std::mutex> critical(worker->lock);
+        }
+
+        worker->taskAvailable.notify_all();
+    }
+
+    for (auto& worker : workers)
+        worker->thread.join();
+}
+
+void SortingPool::start()
+{
+    if (running)
+        return;
+
+    for (int i = 0; i < numWorkers; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        Worker* worker = workers[i].get();
+        worker->thread = std::thread(&SortingPool::run, this, worker);
+
+#ifdef __linux__
+        // core 0 is most likely to be busy with the processing thread and the GUI
+        const int numCores = int(std::thread::hardware_concurrency());
+
+        if (numCores > 1)
+        {
+            cpu_set_t cores;
+            CPU_ZERO(&cores);
+            CPU_SET(1 + i % (numCores - 1), &cores);
+            pthread_setaffinity_np(worker->thread.native_handle(), sizeof(cpu_set_t), &cores);
+        }
+#endif
+    }
+
+    running = true;
+}
+
+bool SortingPool::isRunning() const
+{
+    return running;
+}
+
+int SortingPool::getNumWorkers() const
+{
+    return numWorkers;
+}
+
+void SortingPool::setDeadline(double milliseconds)
+{
+    deadlineMs = std::max(0.0, milliseconds);
+}
+
+double SortingPool::getDeadline() const
+{
+    return deadlineMs;
+}
+
+bool SortingPool::runTask(SortTask* task)
+{
+    int expected = SortTask::QUEUED;
+
+    if (!task->state.compare_exchange_strong(expected, SortTask::RUNNING, std::memory_order_acquire))
+        return false;
+
+    task->sorter->sortBatch(task->spikes, task->numSpikes, true);
+    task->state.store(SortTask::DONE, std::memory_order_release);
+
+    return true;
+}
+
+void SortingPool::submit(SortTask* task, int shard)
+{
+    // publishes the task's fields to whoever claims it
+    task->state.store(SortTask::QUEUED, std::memory_order_release);
+
+    submitted.push_back(task);
+    numTasks.fetch_add(1, std::memory_order_relaxed);
+
+    Worker* worker = workers[shard % numWorkers].get();
+
+    if (!worker->tasks.push(task))
+    {
+        // the worker is far behind: sort it now
+        runTask(task);
+        numFallbacks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // pairs with the fence in run(): either the worker sees the task, or we see that it sleeps
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (worker->isSleeping.load(std::memory_order_relaxed))
+    {
+        {
+            std::lock_guard<std::mutex> critical(worker->lock);
+        }
+
+        worker->taskAvailable.notify_one();
+    }
+}
+
+bool SortingPool::waitForAll()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::duration<double, std::milli>(deadlineMs.load());
+
+    bool metDeadline = true;
+    size_t firstPending = 0;
+
+    for (;;)
+    {
+        while (firstPending < submitted.size()
+               && submitted[firstPending]->state.load(std::memory_order_acquire) == SortTask::DONE)
+            firstPending++;
+
+        if (firstPending == submitted.size())
+            break;
+
+        if (metDeadline && std::chrono::steady_clock::now() >= deadline)
+        {
+            metDeadline = false;
+
+            // take over everything the workers haven't started; running tasks are waited for
+            for (size_t i = firstPending; i < submitted.size(); i++)
+            {
+                if (runTask(submitted[i]))
+                    numFallbacks.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            continue;
+        }
+
+        std::this_thread::yield();
+    }
+
+    submitted.clear();
+
+    const double waitUs = microsecondsSince(start);
+
+    if (!metDeadline)
+        numMissedDeadlines.fetch_add(1, std::memory_order_relaxed);
+
+    numWaits.fetch_add(1, std::memory_order_relaxed);
+    totalWaitUs.store(totalWaitUs.load(std::memory_order_relaxed) + waitUs, std::memory_order_relaxed);
+
+    if (waitUs > maxWaitUs.load(std::memory_order_relaxed))
+        maxWaitUs.store(waitUs, std::memory_order_relaxed);
+
+    return metDeadline;
+}
+
+void SortingPool::run(Worker* worker)
+{
+    // spin this many times without work before going to sleep
+    const int spinLimit = 2000;
+    int numIdleSpins = 0;
+
+    while (!shouldExit)
+    {
+        SortTask* task;
+
+        if (worker->tasks.pop(task))
+        {
+            runTask(task);
+            numIdleSpins = 0;
+            continue;
+        }
+
+        if (++numIdleSpins < spinLimit)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> critical(worker->lock);
+
+        worker->isSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // the timeout only guards against a missed notification
+        worker->taskAvailable.wait_for(critical, std::chrono::milliseconds(10),
+                                       [worker, this] { return !worker->tasks.isEmpty() || shouldExit; });
+
+        worker->isSleeping.store(false, std::memory_order_relaxed);
+        numIdleSpins = 0;
+    }
+}
+
+SortingStats SortingPool::getStats() const
+{
+    SortingStats stats;
+
+    stats.numTasks = numTasks;
+    stats.numFallbacks = numFallbacks;
+    stats.numMissedDeadlines = numMissedDeadlines;
+    stats.meanWaitUs = numWaits > 0 ? totalWaitUs / double(numWaits) : 0.0;
+    stats.maxWaitUs = maxWaitUs;
+
+    return stats;
+}
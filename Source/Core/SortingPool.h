@@ -0,0 +1,182 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SORTINGPOOL_H
+#define __SORTINGPOOL_H
+
+#include "Containers.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Sorter;
+
+/**
+    One electrode's burst of spikes, handed to a SortingPool
+
+    Owned by the caller and reused for every burst; the fields must only be
+    changed while the task is DONE. Whoever moves it from QUEUED to RUNNING
+    (a worker, or the processing thread after the deadline) runs
+    Sorter::sortBatch on it.
+*/
+struct SortTask
+{
+    enum State
+    {
+        DONE = 0,
+        QUEUED,
+        RUNNING
+    };
+
+    Sorter* sorter = nullptr;
+    const SorterSpikePtr* spikes = nullptr;
+    int numSpikes = 0;
+
+    std::atomic<int> state { DONE };
+};
+
+/** Metrics for a SortingPool */
+struct SortingStats
+{
+    /** Bursts handed to the pool, and those the processing thread had to sort itself */
+    int64_t numTasks;
+    int64_t numFallbacks;
+
+    /** Blocks in which the deadline was missed */
+    int64_t numMissedDeadlines;
+
+    /** Time the processing thread spent waiting for the workers (microseconds) */
+    double meanWaitUs;
+    double maxWaitUs;
+};
+
+/**
+
+    Sorts electrodes in parallel on a pool of worker threads
+
+    Each electrode is assigned to a shard (one per worker), so its Sorter
+    and its spikes stay in one core's caches. For each block, the
+    processing thread submits one SortTask per electrode, which goes
+    through the worker's single-producer, single-consumer queue, then waits
+    for all of them in waitForAll(). Tasks that no worker has started when
+    the deadline passes are sorted by the processing thread itself, so the
+    sorted IDs are always available when waitForAll() returns.
+
+    The deadline is soft: tasks a worker is already running are still
+    waited for, however long they take, because the block can't be passed
+    on before its spikes are sorted. It bounds the wait caused by workers
+    that are busy or asleep, not the time a single electrode takes.
+
+    Workers are pinned to a core where the platform allows it (Linux).
+    Idle workers spin briefly and then sleep until the next task.
+
+*/
+class SortingPool
+{
+public:
+
+    /** Constructor (numWorkers <= 0 sizes the pool to the machine) */
+    SortingPool(int numWorkers = 0);
+
+    /** Destructor (stops the workers) */
+    ~SortingPool();
+
+    /** Starts the worker threads (does nothing if they are running) */
+    void start();
+
+    /** Returns true once the workers are running */
+    bool isRunning() const;
+
+    /** Returns the number of worker threads */
+    int getNumWorkers() const;
+
+    /** Sets how long waitForAll() waits before sorting unstarted tasks itself (ms; a soft deadline, see above) */
+    void setDeadline(double milliseconds);
+
+    /** Returns the deadline (ms) */
+    double getDeadline() const;
+
+    /** Queues a task on the worker for a shard (processing thread only) */
+    void submit(SortTask* task, int shard);
+
+    /**
+        Waits until every submitted task is sorted; returns false if the deadline was missed (processing thread only)
+
+        Past the deadline, tasks still queued are sorted on the calling
+        thread, and running ones are waited for without a time limit.
+    */
+    bool waitForAll();
+
+    /** Returns the current metrics */
+    SortingStats getStats() const;
+
+    SortingPool(const SortingPool&) = delete;
+    SortingPool& operator=(const SortingPool&) = delete;
+
+private:
+
+    /** Queue and wake-up state for one worker thread */
+    struct Worker
+    {
+        Worker() : tasks(queueCapacity), isSleeping(false) { }
+
+        SpscQueue<SortTask*> tasks;
+
+        std::mutex lock;
+        std::condition_variable taskAvailable;
+        std::atomic<bool> isSleeping;
+
+        std::thread thread;
+    };
+
+    /** Sorts tasks from one worker's queue until the pool shuts down */
+    void run(Worker* worker);
+
+    /** Sorts a task if nobody else has started it; returns true if it did */
+    static bool runTask(SortTask* task);
+
+    /** Most tasks a worker can have queued (one per electrode per block) */
+    static const int queueCapacity = 1024;
+
+    int numWorkers;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running;
+    std::atomic<bool> shouldExit;
+
+    std::atomic<double> deadlineMs;
+
+    /** Tasks submitted since the last waitForAll() (processing thread only) */
+    std::vector<SortTask*> submitted;
+
+    std::atomic<int64_t> numTasks, numFallbacks, numMissedDeadlines, numWaits;
+    std::atomic<double> totalWaitUs, maxWaitUs;
+};
+
+#endif // __SORTINGPOOL_H
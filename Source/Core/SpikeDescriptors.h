@@ -0,0 +1,83 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SPIKEDESCRIPTORS_H
+#define __SPIKEDESCRIPTORS_H
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+    Plain-data description of the spike channel (electrode) a spike came from
+
+    Filled in by the host from its own channel objects, so that the sorting
+    core does not depend on them.
+*/
+struct SpikeChannelDescriptor
+{
+    /** Number of channels per spike */
+    int numChannels = 0;
+
+    /** Number of samples per channel */
+    int numSamples = 0;
+
+    /** Number of samples before the peak */
+    int prePeakSamples = 0;
+
+    /** Sample rate of the waveforms (Hz) */
+    float sampleRate = 0;
+
+    /** Number of values per waveform (channels x samples) */
+    int getDimension() const { return numChannels * numSamples; }
+
+    /** Converts a sample bin to microseconds from the first sample */
+    float timeBinToMicroseconds(int bin) const
+    {
+        float spikeTimeSpan = 1.0f / sampleRate * numSamples * 1e6;
+        return float(bin) / (numSamples - 1) * spikeTimeSpan;
+    }
+
+    /** Converts microseconds from the first sample to a time bin (rounded down, within the waveform) */
+    int microSecondsToTimeBin(float t) const
+    {
+        float spikeTimeSpan = (1.0f / sampleRate * numSamples) * 1e6;
+        return int(std::min(float(numSamples - 1), std::max(0.0f, t / spikeTimeSpan * (numSamples - 1))));
+    }
+};
+
+/**
+    Plain-data view of one incoming spike
+
+    The waveform (numChannels x numSamples values, channel-major) is only
+    read while the spike is handed to the core; it is copied if kept.
+*/
+struct SpikeDescriptor
+{
+    const SpikeChannelDescriptor* channel = nullptr;
+    const float* waveform = nullptr;
+    int64_t timestamp = 0;
+    uint16_t sortedId = 0;
+};
+
+#endif // __SPIKEDESCRIPTORS_H
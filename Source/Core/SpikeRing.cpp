@@ -0,0 +1,175 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+SpikeRing::SpikeRing(int numChannels_, int numSamples_, int capacity_)
+    : numChannels(numChannels_),
+      numSamples(numSamples_),
+      dim(numChannels_ * numSamples_),
+      stride((numChannels_ * numSamples_ + 15) & ~15), // keep every waveform on a cache line
+      capacity(capacity_),
+      numSpikes(0)
+{
+    waveforms.allocate(size_t(stride) * capacity);
+
+    for (int i = 0; i < 3; i++)
+        pcProj[i].allocate(capacity);
+
+    timestamps.allocate(capacity);
+    sortedIds.allocate(capacity);
+    colors.allocate(size_t(capacity) * 3);
+
+    sequence.reset(new std::atomic<uint32_t>[capacity]);
+
+    for (int i = 0; i < capacity; i++)
+        sequence[i].store(0, std::memory_order_relaxed);
+}
+
+void SpikeRing::addSpike(const SorterSpikeContainer* spike)
+{
+    const SpikeChannelDescriptor& chan = spike->getChannel();
+
+    if (chan.numChannels != numChannels || chan.numSamples != numSamples)
+    {
+        assert(false); // waveform shape changed without rebuilding the ring
+        return;
+    }
+
+    const int64_t index = numSpikes.load(std::memory_order_relaxed);
+    const int slot = int(index % capacity);
+
+    // odd sequence number marks the slot as being written
+    const uint32_t seq = sequence[slot].load(std::memory_order_relaxed);
+    sequence[slot].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(waveforms + int64_t(slot) * stride, spike->getData(), dim * sizeof(float));
+
+    for (int i = 0; i < 3; i++)
+        pcProj[i][slot] = spike->pcProj[i];
+
+    timestamps[slot] = spike->getTimestamp();
+    sortedIds[slot] = spike->sortedId;
+
+    for (int i = 0; i < 3; i++)
+        colors[slot * 3 + i] = spike->color[i];
+
+    sequence[slot].store(seq + 2, std::memory_order_release);
+    numSpikes.store(index + 1, std::memory_order_release);
+}
+
+void SpikeRing::copyWaveforms(int64_t firstSpike, int count, float* dest) const
+{
+    assert(firstSpike >= getOldestSpike() && firstSpike + count <= getNumSpikes());
+
+    for (int n = 0; n < count; n++)
+    {
+        const int slot = int((firstSpike + n) % capacity);
+        memcpy(dest + int64_t(n) * dim, waveforms + int64_t(slot) * stride, dim * sizeof(float));
+    }
+}
+
+bool SpikeRing::readSpike(int64_t spikeIndex,
+                          float* waveform,
+                          float* proj,
+                          uint8_t* color,
+                          uint16_t* sortedId,
+                          int64_t* timestamp) const
+{
+    if (spikeIndex < getOldestSpike() || spikeIndex >= getNumSpikes())
+        return false;
+
+    const int slot = int(spikeIndex % capacity);
+
+    const uint32_t seqBefore = sequence[slot].load(std::memory_order_acquire);
+
+    if (seqBefore & 1)
+        return false; // writer is in the middle of this slot
+
+    if (waveform != nullptr)
+        memcpy(waveform, waveforms + int64_t(slot) * stride, dim * sizeof(float));
+
+    if (proj != nullptr)
+    {
+        for (int i = 0; i < 3; i++)
+            proj[i] = pcProj[i][slot];
+    }
+
+    if (color != nullptr)
+    {
+        for (int i = 0; i < 3; i++)
+            color[i] = colors[slot * 3 + i];
+    }
+
+    if (sortedId != nullptr)
+        *sortedId = sortedIds[slot];
+
+    if (timestamp != nullptr)
+        *timestamp = timestamps[slot];
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // slot was rewritten while copying, or now belongs to a newer spike
+    return sequence[slot].load(std::memory_order_relaxed) == seqBefore
+        && spikeIndex >= getOldestSpike();
+}
+
+bool SpikeRing::readChannel(int64_t spikeIndex, int channel, float* samples, uint8_t* color) const
+{
+    if (channel < 0 || channel >= numChannels || spikeIndex < getOldestSpike() || spikeIndex >= getNumSpikes())
+        return false;
+
+    const int slot = int(spikeIndex % capacity);
+
+    const uint32_t seqBefore = sequence[slot].load(std::memory_order_acquire);
+
+    if (seqBefore & 1)
+        return false; // writer is in the middle of this slot
+
+    memcpy(samples, waveforms + int64_t(slot) * stride + channel * numSamples, numSamples * sizeof(float));
+
+    if (color != nullptr)
+    {
+        for (int i = 0; i < 3; i++)
+            color[i] = colors[slot * 3 + i];
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return sequence[slot].load(std::memory_order_relaxed) == seqBefore
+        && spikeIndex >= getOldestSpike();
+}
+
+int64_t SpikeRing::getNumSpikes() const
+{
+    return numSpikes.load(std::memory_order_acquire);
+}
+
+int64_t SpikeRing::getOldestSpike() const
+{
+    return std::max(int64_t(0), getNumSpikes() - capacity);
+}
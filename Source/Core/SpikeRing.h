@@ -0,0 +1,118 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKERING_H
+#define __SPIKERING_H
+
+#include "Containers.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+
+    Ring buffer holding the most recent spikes for one electrode
+
+    Waveforms, timestamps, sorted IDs, colors and PC projections are
+    stored as separate contiguous arrays, with each waveform starting
+    on a cache line. The Sorter reads its PCA training set from here,
+    and the waveform and projection axes draw from the same storage.
+
+    There is a single writer (the processing thread). Other threads read
+    through readSpike(), which uses a per-slot sequence counter and
+    reports a spike as unavailable if it was overwritten during the copy.
+
+*/
+class SpikeRing
+{
+public:
+
+    /** Constructor */
+    SpikeRing(int numChannels, int numSamples, int capacity = 600);
+
+    /** Destructor */
+    ~SpikeRing() { }
+
+    /** Appends a sorted spike, overwriting the oldest one if the ring is full (processing thread only) */
+    void addSpike(const SorterSpikeContainer* spike);
+
+    /** Copies the waveforms of numSpikes consecutive spikes into a (numSpikes x dim) matrix (processing thread only) */
+    void copyWaveforms(int64_t firstSpike, int numSpikes, float* dest) const;
+
+    /** Copies the requested fields of one spike; any pointer may be null.
+        Returns false if the spike is no longer (or not yet) in the ring. */
+    bool readSpike(int64_t spikeIndex,
+                   float* waveform,
+                   float* pcProj = nullptr,
+                   uint8_t* color = nullptr,
+                   uint16_t* sortedId = nullptr,
+                   int64_t* timestamp = nullptr) const;
+
+    /** Copies the numSamples values of one channel of a spike (and its color, if not null).
+        Same rules as readSpike(); reading one channel keeps the cost of drawing
+        every channel of an electrode linear in the number of channels. */
+    bool readChannel(int64_t spikeIndex, int channel, float* samples, uint8_t* color = nullptr) const;
+
+    /** Returns the total number of spikes added since the ring was created */
+    int64_t getNumSpikes() const;
+
+    /** Returns the index of the oldest spike still held in the ring */
+    int64_t getOldestSpike() const;
+
+    /** Returns the maximum number of spikes held at once */
+    int getCapacity() const { return capacity; }
+
+    /** Returns the number of channels per spike */
+    int getNumChannels() const { return numChannels; }
+
+    /** Returns the number of samples per channel */
+    int getNumSamples() const { return numSamples; }
+
+    /** Returns the number of values per waveform (channels x samples) */
+    int getDimension() const { return dim; }
+
+    SpikeRing(const SpikeRing&) = delete;
+    SpikeRing& operator=(const SpikeRing&) = delete;
+
+private:
+
+    const int numChannels;
+    const int numSamples;
+    const int dim;
+    const int stride;
+    const int capacity;
+
+    AlignedHeapBlock<float> waveforms;
+    AlignedHeapBlock<float> pcProj[3];
+    AlignedHeapBlock<int64_t> timestamps;
+    AlignedHeapBlock<uint16_t> sortedIds;
+    AlignedHeapBlock<uint8_t> colors;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> sequence;
+
+    std::atomic<int64_t> numSpikes;
+
+};
+
+#endif // __SPIKERING_H
@@ -0,0 +1,106 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SPSCQUEUE_H
+#define __SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+
+    Bounded lock-free queue between exactly one producer thread and one
+    consumer thread
+
+    The capacity is rounded up to a power of two. push() fails instead of
+    blocking when the queue is full.
+
+*/
+template <typename ElementType>
+class SpscQueue
+{
+public:
+
+    /** Constructor */
+    SpscQueue(size_t capacity)
+        : head(0), tail(0)
+    {
+        size_t size = 1;
+
+        while (size < capacity)
+            size *= 2;
+
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /** Adds an element at the back (producer side); returns false if the queue is full */
+    bool push(const ElementType& element)
+    {
+        const size_t currentTail = tail.load(std::memory_order_relaxed);
+
+        if (currentTail - head.load(std::memory_order_acquire) > mask)
+            return false;
+
+        slots[currentTail & mask] = element;
+        tail.store(currentTail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /** Removes the element at the front (consumer side); returns false if the queue is empty */
+    bool pop(ElementType& element)
+    {
+        const size_t currentHead = head.load(std::memory_order_relaxed);
+
+        if (currentHead == tail.load(std::memory_order_acquire))
+            return false;
+
+        element = slots[currentHead & mask];
+        head.store(currentHead + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /** Returns true if there is nothing to pop (exact on the consumer side only) */
+    bool isEmpty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+
+    std::vector<ElementType> slots;
+    size_t mask;
+
+    /** Next element to pop and next free slot, on separate cache lines */
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif // __SPSCQUEUE_H
@@ -0,0 +1,180 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "TemplateUnit.h"
+#include "SimdKernels.h"
+
+TemplateUnit::TemplateUnit()
+    : numChannels(0), numSamples(0), metric(WHITENED), threshold(defaultThreshold)
+{
+}
+
+TemplateUnit::TemplateUnit(int id)
+    : SortedUnit(id), numChannels(0), numSamples(0), metric(WHITENED), threshold(defaultThreshold)
+{
+}
+
+bool TemplateUnit::setTemplate(const WaveformStats& source, int numChannels_, Metric metric_)
+{
+    std::vector<float> mean, var;
+
+    if (numChannels_ <= 0 || !source.getMeanAndVariance(mean, var) || mean.size() % numChannels_ != 0)
+        return false;
+
+    numChannels = numChannels_;
+    numSamples = (int) mean.size() / numChannels;
+    waveform = mean;
+    variance = var;
+    metric = metric_;
+
+    double meanVariance = 0;
+
+    for (auto& v : variance)
+    {
+        v = std::max(v, minimumVariance);
+        meanVariance += v;
+    }
+
+    meanVariance /= variance.size();
+
+    if (metric == WHITENED)
+        threshold = defaultThreshold;
+    else
+        threshold = defaultThreshold * float(std::sqrt(meanVariance));
+
+    return true;
+}
+
+int TemplateUnit::getDimension() const
+{
+    return (int) waveform.size();
+}
+
+std::vector<float> TemplateUnit::getWeights() const
+{
+    std::vector<float> weights(waveform.size(), 1.0f);
+
+    if (metric == WHITENED)
+    {
+        for (int k = 0; k < (int) weights.size(); k++)
+            weights[k] = 1.0f / std::max(variance[k], minimumVariance);
+    }
+
+    return weights;
+}
+
+float TemplateUnit::getDistance(const float* data) const
+{
+    const std::vector<float> weights = getWeights();
+
+    double sum = 0;
+
+    for (int k = 0; k < (int) waveform.size(); k++)
+    {
+        const double d = data[k] - waveform[k];
+        sum += weights[k] * d * d;
+    }
+
+    return float(std::sqrt(sum / std::max(size_t(1), waveform.size())));
+}
+
+bool TemplateUnit::isWaveFormInside(SorterSpikePtr so) const
+{
+    if (waveform.size() == 0 || so->getDimension() != getDimension())
+        return false;
+
+    return getDistance(so->getData()) <= threshold;
+}
+
+TemplateBank::TemplateBank(const std::vector<TemplateUnit>& units)
+    : dimension(0), stride(0), numTemplates(0)
+{
+    for (int i = 0; i < (int) units.size(); i++)
+    {
+        if (units[i].getDimension() == 0)
+            continue;
+
+        if (dimension == 0)
+            dimension = units[i].getDimension();
+
+        if (units[i].getDimension() == dimension)
+            unitIndices.push_back(i);
+    }
+
+    numTemplates = (int) unitIndices.size();
+    stride = SimdKernels::padDimension(dimension);
+
+    // zeroed, so the padding never adds to a distance
+    templates.allocate(size_t(numTemplates) * stride);
+    weights.allocate(size_t(numTemplates) * stride);
+
+    for (int t = 0; t < numTemplates; t++)
+    {
+        const TemplateUnit& unit = units[unitIndices[t]];
+        const std::vector<float> unitWeights = unit.getWeights();
+
+        std::copy(unit.waveform.begin(), unit.waveform.end(), templates.getData() + size_t(t) * stride);
+        std::copy(unitWeights.begin(), unitWeights.end(), weights.getData() + size_t(t) * stride);
+
+        limits.push_back(unit.threshold * unit.threshold * dimension);
+    }
+}
+
+int TemplateBank::findUnit(const float* waveform, int dim) const
+{
+    if (dim != dimension || numTemplates == 0)
+        return noUnit;
+
+    // distances are computed in chunks, so nothing is allocated per spike
+    const int chunkSize = 32;
+    float distances[chunkSize];
+
+    int best = noUnit;
+    float bestRatio = 1.0f;
+
+    for (int t0 = 0; t0 < numTemplates; t0 += chunkSize)
+    {
+        const int n = std::min(chunkSize, numTemplates - t0);
+
+        SimdKernels::templateDistances(waveform, dimension, templates.getData() + size_t(t0) * stride,
+                                       weights.getData() + size_t(t0) * stride, stride, n, distances);
+
+        for (int t = 0; t < n; t++)
+        {
+            const float ratio = distances[t] / limits[t0 + t];
+
+            // ties go to the first unit
+            if (ratio < bestRatio || (best == noUnit && ratio <= bestRatio))
+            {
+                bestRatio = ratio;
+                best = unitIndices[t0 + t];
+            }
+        }
+    }
+
+    return best;
+}
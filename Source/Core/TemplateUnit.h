@@ -0,0 +1,143 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __TEMPLATE_UNIT_H
+#define __TEMPLATE_UNIT_H
+
+#include "Containers.h"
+#include "SortedUnit.h"
+
+#include <memory>
+#include <vector>
+
+/**
+    A unit defined by a mean waveform across all channels of an electrode
+
+    A spike belongs to the unit if the root mean square of its difference
+    to the template, over all samples, is below a threshold. With the
+    EUCLIDEAN metric the threshold is in microvolts; with WHITENED each
+    sample is divided by the unit's standard deviation at that sample
+    (a diagonal whitening), so the threshold is in standard deviations.
+
+    Templates are seeded from the WaveformStats of an existing unit.
+*/
+class TemplateUnit : public SortedUnit
+{
+public:
+
+    enum Metric
+    {
+        EUCLIDEAN = 0,
+        WHITENED
+    };
+
+    /** Default constructor */
+    TemplateUnit();
+
+    /** Constructor based on unit ID */
+    TemplateUnit(int id);
+
+    /**
+        Copies the mean and variance accumulated by another unit
+
+        The threshold is set to defaultThreshold standard deviations.
+        Returns false (and leaves the template unchanged) if the stats hold
+        fewer than two spikes.
+    */
+    bool setTemplate(const WaveformStats& source, int numChannels, Metric metric);
+
+    /** Returns the number of waveform values (channels x samples) of the template */
+    int getDimension() const;
+
+    /** Returns the weight of each sample in the distance (1, or the inverse variance) */
+    std::vector<float> getWeights() const;
+
+    /** Returns the RMS distance of a waveform to the template (in the units of the threshold) */
+    float getDistance(const float* waveform) const;
+
+    /** Returns true if the spike is within the threshold (see TemplateBank for the fast test) */
+    bool isWaveFormInside(SorterSpikePtr so) const;
+
+    /** Default threshold, in standard deviations */
+    static constexpr float defaultThreshold = 2.0f;
+
+    /** Variance floor (microvolts^2), so that flat samples don't dominate a whitened distance */
+    static constexpr float minimumVariance = 1.0f;
+
+    /** Shape of the template */
+    int numChannels, numSamples;
+
+    /** Mean waveform (microvolts), one channel after the other */
+    std::vector<float> waveform;
+
+    /** Variance of each sample (microvolts^2) */
+    std::vector<float> variance;
+
+    Metric metric;
+
+    /** Largest RMS distance of a spike in this unit */
+    float threshold;
+};
+
+/**
+    The template units of an electrode, packed for SimdKernels::templateDistances
+
+    Built whenever the units are edited. Templates and weights are stored
+    as zero-padded aligned rows, so a spike is compared with every template
+    in one pass over its waveform. Units whose template doesn't match the
+    dimension of the first unit are left out.
+*/
+class TemplateBank
+{
+public:
+
+    /** Constructor */
+    TemplateBank(const std::vector<TemplateUnit>& units);
+
+    /** Returns the waveform dimension of the packed templates */
+    int getDimension() const { return dimension; }
+
+    /**
+        Returns the index of the unit closest to a waveform, relative to its threshold, or noUnit
+
+        Units outside their threshold are never returned.
+    */
+    int findUnit(const float* waveform, int dim) const;
+
+    static const int noUnit = -1;
+
+private:
+
+    int dimension, stride, numTemplates;
+
+    AlignedHeapBlock<float> templates, weights;
+
+    /** threshold^2 x dimension, the largest sum returned by the kernel for each template */
+    std::vector<float> limits;
+
+    /** Index of each packed template in the unit vector */
+    std::vector<int> unitIndices;
+};
+
+#endif // __TEMPLATE_UNIT_H
@@ -0,0 +1,130 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "TrainingReservoir.h"
+
+#include <algorithm>
+#include <cstring>
+
+TrainingReservoir::TrainingReservoir(int dimension, int capacity_)
+    : dim(dimension),
+      stride((dimension + 15) & ~15), // keep every waveform on a cache line
+      capacity(capacity_),
+      numStored(0),
+      numSeen(0),
+      rngState(0x9E3779B97F4A7C15ULL)
+{
+    waveforms.allocate(size_t(stride) * capacity);
+
+    sequence.reset(new std::atomic<uint32_t>[capacity]);
+
+    for (int i = 0; i < capacity; i++)
+        sequence[i].store(0, std::memory_order_relaxed);
+}
+
+uint64_t TrainingReservoir::nextRandom(uint64_t n)
+{
+    // xorshift64*
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+
+    return (rngState * 0x2545F4914F6CDD1DULL) % n;
+}
+
+void TrainingReservoir::addSpike(const float* waveform)
+{
+    const int64_t seen = numSeen.load(std::memory_order_relaxed) + 1;
+    const int stored = numStored.load(std::memory_order_relaxed);
+
+    int slot;
+
+    if (stored < capacity)
+    {
+        slot = stored;
+    }
+    else
+    {
+        const uint64_t r = nextRandom(uint64_t(seen));
+
+        if (r >= uint64_t(capacity))
+        {
+            numSeen.store(seen, std::memory_order_release);
+            return;
+        }
+
+        slot = int(r);
+    }
+
+    // odd sequence number marks the slot as being written
+    const uint32_t seq = sequence[slot].load(std::memory_order_relaxed);
+    sequence[slot].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(waveforms + int64_t(slot) * stride, waveform, dim * sizeof(float));
+
+    sequence[slot].store(seq + 2, std::memory_order_release);
+
+    if (stored < capacity)
+        numStored.store(stored + 1, std::memory_order_release);
+
+    numSeen.store(seen, std::memory_order_release);
+}
+
+int TrainingReservoir::copyWaveforms(float* dest, int maxRows) const
+{
+    const int stored = std::min(getNumStored(), maxRows);
+
+    int numCopied = 0;
+
+    for (int slot = 0; slot < stored; slot++)
+    {
+        const uint32_t seqBefore = sequence[slot].load(std::memory_order_acquire);
+
+        if (seqBefore & 1)
+            continue; // writer is in the middle of this slot
+
+        float* row = dest + int64_t(numCopied) * dim;
+
+        memcpy(row, waveforms + int64_t(slot) * stride, dim * sizeof(float));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // replaced while copying (the next slot overwrites this row)
+        if (sequence[slot].load(std::memory_order_relaxed) == seqBefore)
+            numCopied++;
+    }
+
+    return numCopied;
+}
+
+int TrainingReservoir::getNumStored() const
+{
+    return numStored.load(std::memory_order_acquire);
+}
+
+int64_t TrainingReservoir::getNumSeen() const
+{
+    return numSeen.load(std::memory_order_acquire);
+}
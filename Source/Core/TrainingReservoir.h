@@ -0,0 +1,112 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __TRAININGRESERVOIR_H
+#define __TRAININGRESERVOIR_H
+
+#include "Containers.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+
+    Uniform random sample of the spikes seen by one electrode, used to fit its PC basis
+
+    Every spike is offered to the reservoir (Algorithm R): the first
+    capacity spikes are kept, then spike n replaces a random slot with
+    probability capacity / n. The sample therefore covers the whole
+    recording evenly instead of the first few hundred spikes, which may
+    come from a burst or from artifacts at startup.
+
+    Waveforms live in one arena, one cache-aligned row per slot, so a PCA
+    job copies the whole sample in a single sweep. There is a single
+    writer (the Sorter's sorting thread); copyWaveforms() may be called from any
+    thread and uses a per-slot sequence counter, like SpikeRing, to skip
+    slots that were replaced during the copy. The random seed is fixed, so
+    the same spikes always give the same sample.
+
+*/
+class TrainingReservoir
+{
+public:
+
+    /** Constructor */
+    TrainingReservoir(int dimension, int capacity);
+
+    /** Destructor */
+    ~TrainingReservoir() { }
+
+    /** Offers a waveform of getDimension() values to the sample (sorting thread only, see Sorter) */
+    void addSpike(const float* waveform);
+
+    /**
+        Copies up to maxRows sampled waveforms into a (maxRows x dimension) matrix
+
+        May be called from any thread. The sample keeps growing until it is
+        full, so getNumStored() read before the call is only a lower bound:
+        rows past maxRows are left out, as are slots rewritten during the
+        copy. Returns the number of waveforms copied.
+    */
+    int copyWaveforms(float* dest, int maxRows) const;
+
+    /** Returns the number of waveforms held (up to the capacity) */
+    int getNumStored() const;
+
+    /** Returns the number of spikes offered since the reservoir was created */
+    int64_t getNumSeen() const;
+
+    /** Returns the maximum number of waveforms held */
+    int getCapacity() const { return capacity; }
+
+    /** Returns the number of values per waveform */
+    int getDimension() const { return dim; }
+
+    /** Size of the training sample unless configured otherwise */
+    static const int defaultCapacity = 200;
+
+    TrainingReservoir(const TrainingReservoir&) = delete;
+    TrainingReservoir& operator=(const TrainingReservoir&) = delete;
+
+private:
+
+    /** Returns a uniform random integer in [0, n) */
+    uint64_t nextRandom(uint64_t n);
+
+    const int dim;
+    const int stride;
+    const int capacity;
+
+    AlignedHeapBlock<float> waveforms;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> sequence;
+
+    std::atomic<int> numStored;
+    std::atomic<int64_t> numSeen;
+
+    uint64_t rngState;
+};
+
+#endif // __TRAININGRESERVOIR_H
@@ -0,0 +1,188 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#include "UnitMetrics.h"
+#include "WaveformStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+UnitMetrics::UnitMetrics()
+    : sequence(0),
+      resetRequested(false),
+      numSpikes(0),
+      numIntervals(0),
+      numViolations(0),
+      lastTime(0)
+{
+    memset(recentTimes, 0, sizeof(recentTimes));
+    memset(histogram, 0, sizeof(histogram));
+}
+
+void UnitMetrics::reset()
+{
+    resetRequested = true;
+}
+
+int UnitMetrics::getBin(double interval)
+{
+    if (interval <= 0)
+        return 0;
+
+    const int bin = int(std::floor((std::log10(interval) - minLogInterval) * binsPerDecade));
+
+    return std::min(numBins - 1, std::max(0, bin));
+}
+
+double UnitMetrics::getBinEdge(int bin)
+{
+    return std::pow(10.0, minLogInterval + double(bin) / binsPerDecade);
+}
+
+void UnitMetrics::addSpike(double time)
+{
+    // odd sequence number: readers retry
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (resetRequested.exchange(false, std::memory_order_relaxed))
+    {
+        numSpikes = 0;
+        numIntervals = 0;
+        numViolations = 0;
+        memset(histogram, 0, sizeof(histogram));
+    }
+
+    // an earlier time means the acquisition restarted: no interval across it
+    if (numSpikes > 0 && time >= lastTime)
+    {
+        const double interval = time - lastTime;
+
+        histogram[getBin(interval)]++;
+        numIntervals++;
+
+        if (interval < refractoryPeriod)
+            numViolations++;
+    }
+
+    recentTimes[numSpikes & (numRecentSpikes - 1)] = time;
+    lastTime = time;
+    numSpikes++;
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool UnitMetrics::getQuality(UnitQuality& quality, double now) const
+{
+    quality.isiHistogram.resize(numBins);
+
+    for (int attempt = 0; attempt < maxReadAttempts; attempt++)
+    {
+        const uint32_t seqBefore = sequence.load(std::memory_order_acquire);
+
+        if (seqBefore & 1)
+        {
+            std::this_thread::yield(); // writer is in the middle of an update
+            continue;
+        }
+
+        const int64_t spikes = numSpikes;
+        const int64_t intervals = numIntervals;
+        const int64_t violations = numViolations;
+
+        std::copy(histogram, histogram + numBins, quality.isiHistogram.begin());
+
+        // count the recent spikes inside the window, newest first
+        const int numStored = int(std::min(spikes, int64_t(numRecentSpikes)));
+        const double windowStart = now - rateWindow;
+
+        int numInWindow = 0;
+        double oldestInWindow = now;
+
+        for (int i = 0; i < numStored; i++)
+        {
+            const double t = recentTimes[(spikes - 1 - i) & (numRecentSpikes - 1)];
+
+            if (t <= windowStart || t > now)
+                break;
+
+            numInWindow++;
+            oldestInWindow = t;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) != seqBefore)
+            continue;
+
+        quality.numSpikes = spikes;
+        quality.isiViolations = intervals > 0 ? float(double(violations) / double(intervals)) : 0.0f;
+
+        // the buffer may hold less than a window of a fast unit
+        if (numInWindow == numRecentSpikes && now > oldestInWindow)
+            quality.firingRate = float((numInWindow - 1) / (now - oldestInWindow));
+        else
+            quality.firingRate = float(numInWindow / rateWindow);
+
+        return true;
+    }
+
+    return false;
+}
+
+float UnitMetrics::computeSNR(const WaveformStats& stats, int numChannels)
+{
+    std::vector<float> mean, variance;
+
+    if (numChannels <= 0 || !stats.getMeanAndVariance(mean, variance) || mean.size() % numChannels != 0)
+        return 0;
+
+    const size_t numSamples = mean.size() / numChannels;
+
+    // peak-to-peak of the mean on each channel, over the average deviation around it
+    float best = 0;
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        const size_t first = channel * numSamples;
+
+        float minimum = mean[first], maximum = mean[first];
+        double noise = 0;
+
+        for (size_t k = first; k < first + numSamples; k++)
+        {
+            minimum = std::min(minimum, mean[k]);
+            maximum = std::max(maximum, mean[k]);
+            noise += std::sqrt(std::max(0.0f, variance[k]));
+        }
+
+        noise /= numSamples;
+
+        if (noise > 0)
+            best = std::max(best, float((maximum - minimum) / noise));
+    }
+
+    return best;
+}
@@ -0,0 +1,141 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __UNITMETRICS_H
+#define __UNITMETRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class WaveformStats;
+
+/** Live sort-quality figures of one unit (see Sorter::getUnitQuality) */
+struct UnitQuality
+{
+    int unitId = 0;
+
+    /** Spikes assigned to the unit */
+    int64_t numSpikes = 0;
+
+    /** Firing rate over the last UnitMetrics::rateWindow seconds (Hz) */
+    float firingRate = 0;
+
+    /** Fraction of inter-spike intervals shorter than UnitMetrics::refractoryPeriod */
+    float isiViolations = 0;
+
+    /** Peak-to-peak amplitude of the mean waveform over the noise, on the strongest channel (0 until two spikes were seen) */
+    float snr = 0;
+
+    /** Isolation distance and L-ratio in PC space (negative if unknown; see ClusterIsolation) */
+    float isolationDistance = -1;
+    float lRatio = -1;
+
+    /** Inter-spike interval counts in logarithmic bins (see UnitMetrics::getBinEdge) */
+    std::vector<uint32_t> isiHistogram;
+};
+
+/**
+
+    Spike-train statistics of one unit, updated with every spike it is assigned
+
+    Each spike costs O(1): its time goes into a small ring buffer (for
+    the firing rate), and the interval to the previous spike into a
+    histogram with a fixed number of logarithmic bins and a refractory
+    violation counter.
+
+    Like WaveformStats, only the thread sorting the electrode adds spikes,
+    and other threads copy the figures without a lock (a sequence number
+    tells them to retry if an update was running).
+
+*/
+class UnitMetrics
+{
+public:
+
+    /** Constructor */
+    UnitMetrics();
+
+    /** Adds a spike time (seconds; writer thread only) */
+    void addSpike(double time);
+
+    /** Clears all figures (applied by the writer with the next spike) */
+    void reset();
+
+    /**
+        Copies the figures into quality (any thread)
+
+        now is the time of the latest spike on the electrode (seconds), so
+        that a unit that stopped firing shows a falling rate. The SNR is
+        left unchanged. Returns false if the writer kept changing the
+        figures.
+    */
+    bool getQuality(UnitQuality& quality, double now) const;
+
+    /** Computes the SNR of a unit from its waveform statistics (0 until two spikes were seen) */
+    static float computeSNR(const WaveformStats& stats, int numChannels);
+
+    /** Returns the lower edge of a histogram bin (seconds); bin 0 also counts shorter intervals */
+    static double getBinEdge(int bin);
+
+    /** Intervals shorter than this count as refractory violations (seconds) */
+    static constexpr double refractoryPeriod = 0.0015;
+
+    /** Window of the firing rate (seconds) */
+    static constexpr double rateWindow = 2.0;
+
+    /** Histogram range: from 10^minLogInterval s, binsPerDecade bins per decade; the last bin also counts longer intervals */
+    static const int minLogInterval = -4;
+    static const int binsPerDecade = 10;
+    static const int numBins = 60;
+
+    /** Recent spike times kept for the firing rate (a power of two) */
+    static const int numRecentSpikes = 256;
+
+    UnitMetrics(const UnitMetrics&) = delete;
+    UnitMetrics& operator=(const UnitMetrics&) = delete;
+
+private:
+
+    /** Returns the histogram bin of an interval */
+    static int getBin(double interval);
+
+    /** Odd while the writer is changing the figures */
+    std::atomic<uint32_t> sequence;
+
+    std::atomic<bool> resetRequested;
+
+    int64_t numSpikes;
+    int64_t numIntervals;
+    int64_t numViolations;
+    double lastTime;
+
+    /** Times of the latest spikes (the newest at (numSpikes - 1) % numRecentSpikes) */
+    double recentTimes[numRecentSpikes];
+
+    uint32_t histogram[numBins];
+
+    /** Readers give up after this many changed copies */
+    static const int maxReadAttempts = 64;
+};
+
+#endif // __UNITMETRICS_H
@@ -0,0 +1,295 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "WaveformStats.h"
+#include "SimdKernels.h"
+
+// Running variance (Welford), with k the number of spikes so far:
+// Mk = Mk-1 + (xk - Mk-1) / k
+// Sk = Sk-1 + (xk - Mk-1) * (xk - Mk)
+// For 2 <= k <= n, the kth estimate of the variance is s2 = Sk / (k - 1).
+
+WaveformStats::WaveformStats()
+    : lastSpikeTime(0),
+      newData(false),
+      sequence(0),
+      count(0),
+      layoutChannels(0),
+      layoutSamples(0),
+      resetRequested(false),
+      block(nullptr)
+{
+}
+
+WaveformStats::~WaveformStats()
+{
+}
+
+void WaveformStats::reset()
+{
+    resetRequested = true;
+}
+
+void WaveformStats::resizeWaveform(int newlength)
+{
+    reset(); // the next spike brings the new layout
+}
+
+void WaveformStats::restart(int numChannels, int numSamples)
+{
+    const int stride = SimdKernels::padDimension(numChannels * numSamples);
+
+    Block* current = block.load(std::memory_order_relaxed);
+
+    if (current == nullptr || current->stride < stride)
+    {
+        blocks.emplace_back(new Block(stride));
+        block.store(blocks.back().get(), std::memory_order_relaxed);
+    }
+    else
+    {
+        memset(current->values.getData(), 0, size_t(2) * current->stride * sizeof(float));
+    }
+
+    layoutChannels.store(numChannels, std::memory_order_relaxed);
+    layoutSamples.store(numSamples, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+}
+
+void WaveformStats::update(SorterSpikePtr so)
+{
+    lastSpikeTime = so->getTimestamp() / so->getChannel().sampleRate;
+
+    update(so->getData(), so->getChannel().numChannels, so->getChannel().numSamples);
+}
+
+void WaveformStats::update(const float* waveform, int numChannels, int numSamples)
+{
+    const int dim = numChannels * numSamples;
+
+    if (waveform == nullptr || dim <= 0)
+        return;
+
+    // odd sequence number: readers retry
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (resetRequested.exchange(false, std::memory_order_relaxed)
+        || numChannels != layoutChannels.load(std::memory_order_relaxed)
+        || numSamples != layoutSamples.load(std::memory_order_relaxed))
+    {
+        restart(numChannels, numSamples);
+    }
+
+    Block* current = block.load(std::memory_order_relaxed);
+
+    const int64_t numSpikes = count.load(std::memory_order_relaxed) + 1;
+
+    // from zeroed storage, the first step sets the mean to the waveform and M2 to 0
+    SimdKernels::welfordUpdate(waveform, dim, 1.0f / float(numSpikes),
+                               current->values.getData(), current->values.getData() + current->stride);
+
+    count.store(numSpikes, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+
+    newData = true;
+}
+
+bool WaveformStats::merge(const WaveformStats& other)
+{
+    std::vector<float> otherMean, otherM2;
+    int64_t otherCount;
+    int numChannels, numSamples;
+
+    if (&other == this || !other.read(-1, &otherMean, &otherM2, otherCount, numChannels, numSamples))
+        return false;
+
+    if (otherCount == 0)
+        return true;
+
+    const bool sameLayout = numChannels == layoutChannels.load(std::memory_order_relaxed)
+                            && numSamples == layoutSamples.load(std::memory_order_relaxed);
+
+    const bool restartNeeded = resetRequested.load(std::memory_order_relaxed)
+                               || count.load(std::memory_order_relaxed) == 0;
+
+    if (!sameLayout && !restartNeeded)
+        return false;
+
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (resetRequested.exchange(false, std::memory_order_relaxed) || !sameLayout)
+        restart(numChannels, numSamples);
+
+    Block* current = block.load(std::memory_order_relaxed);
+    float* mean = current->values.getData();
+    float* m2 = mean + current->stride;
+
+    // pairwise combination: the mean moves by nB / n of the difference, M2 gains nA * nB / n of its square
+    const int64_t thisCount = count.load(std::memory_order_relaxed);
+    const int64_t numSpikes = thisCount + otherCount;
+
+    const float otherWeight = float(double(otherCount) / double(numSpikes));
+    const float crossWeight = float(double(thisCount) * double(otherCount) / double(numSpikes));
+
+    const int dim = numChannels * numSamples;
+
+    for (int k = 0; k < dim; k++)
+    {
+        const float delta = otherMean[k] - mean[k];
+
+        mean[k] += delta * otherWeight;
+        m2[k] += otherM2[k] + delta * delta * crossWeight;
+    }
+
+    count.store(numSpikes, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+
+    newData = true;
+
+    return true;
+}
+
+bool WaveformStats::read(int channel, std::vector<float>* mean, std::vector<float>* m2,
+                         int64_t& numSpikes, int& numChannels, int& numSamples) const
+{
+    for (int attempt = 0; attempt < maxReadAttempts; attempt++)
+    {
+        const uint32_t seqBefore = sequence.load(std::memory_order_acquire);
+
+        if (seqBefore & 1)
+        {
+            std::this_thread::yield(); // writer is in the middle of an update
+            continue;
+        }
+
+        const Block* current = block.load(std::memory_order_relaxed);
+
+        numSpikes = count.load(std::memory_order_relaxed);
+        numChannels = layoutChannels.load(std::memory_order_relaxed);
+        numSamples = layoutSamples.load(std::memory_order_relaxed);
+
+        int first = 0;
+        int length = 0;
+
+        if (current != nullptr && numSpikes > 0)
+        {
+            if (channel < 0)
+            {
+                length = numChannels * numSamples;
+            }
+            else if (channel < numChannels)
+            {
+                first = channel * numSamples;
+                length = numSamples;
+            }
+
+            // a layout read during a reallocation must not run past the block it was read with
+            length = std::max(0, std::min(length, current->stride - first));
+        }
+
+        const float* meanValues = current != nullptr ? current->values.getData() + first : nullptr;
+        const float* m2Values = current != nullptr ? current->values.getData() + current->stride + first : nullptr;
+
+        if (mean != nullptr)
+            mean->assign(meanValues, meanValues + length);
+
+        if (m2 != nullptr)
+            m2->assign(m2Values, m2Values + length);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) == seqBefore)
+            return true;
+    }
+
+    return false;
+}
+
+int64_t WaveformStats::getNumSpikes() const
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+bool WaveformStats::getMean(int channel, std::vector<float>& mean) const
+{
+    int64_t numSpikes;
+    int numChannels, numSamples;
+
+    if (!read(channel, &mean, nullptr, numSpikes, numChannels, numSamples) || mean.empty())
+    {
+        mean.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool WaveformStats::getStandardDeviation(int channel, std::vector<float>& deviation) const
+{
+    int64_t numSpikes;
+    int numChannels, numSamples;
+
+    if (!read(channel, nullptr, &deviation, numSpikes, numChannels, numSamples) || deviation.empty() || numSpikes < 2)
+    {
+        deviation.clear();
+        return false;
+    }
+
+    for (auto& d : deviation)
+        d = std::sqrt(std::max(0.0f, d / float(numSpikes - 1)));
+
+    return true;
+}
+
+bool WaveformStats::getMeanAndVariance(std::vector<float>& mean, std::vector<float>& variance) const
+{
+    int64_t numSpikes;
+    int numChannels, numSamples;
+
+    if (!read(-1, &mean, &variance, numSpikes, numChannels, numSamples) || mean.empty() || numSpikes < 2)
+    {
+        mean.clear();
+        variance.clear();
+        return false;
+    }
+
+    for (auto& v : variance)
+        v = std::max(0.0f, v / float(numSpikes - 1));
+
+    return true;
+}
+
+bool WaveformStats::queryNewData()
+{
+    return newData.exchange(false);
+}
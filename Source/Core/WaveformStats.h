@@ -0,0 +1,145 @@
+/*
+------------------------------------------------------------------
+
+This file is part of the Open Ephys GUI
+Copyright (C) 2013 Open Ephys
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __WAVEFORMSTATS_H
+#define __WAVEFORMSTATS_H
+
+#include "Containers.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** 
+
+    Online mean and variance of the waveforms assigned to a unit
+
+    Templates are seeded from these statistics (see TemplateUnit), and the
+    display can show them. The mean and the sum of squared deviations (M2)
+    of all channels are kept in one aligned block, and each spike is added
+    with a single vectorized Welford step (SimdKernels::welfordUpdate).
+
+    Only one thread adds spikes at a time (the one sorting the electrode).
+    Any other thread can copy the statistics without a lock: the writer
+    bumps a sequence number around each update, and readers retry if it
+    changed while they were copying. Partial statistics (e.g. gathered on
+    several threads) can be combined with merge().
+
+*/
+class WaveformStats
+{
+public:
+
+    /** Construtor */
+    WaveformStats();
+
+    /** Destructor */
+    ~WaveformStats();
+
+    /** Sets length of waveform (the statistics restart with the next spike) */
+    void resizeWaveform(int newlength);
+    
+    /** Resets stats to default value (applied by the writer with the next spike) */
+    void reset();
+
+    /** Adds a spike (writer thread only; never waits) */
+    void update(SorterSpikePtr so);
+
+    /** Adds a waveform of numChannels x numSamples values, channel after channel (writer thread only) */
+    void update(const float* waveform, int numChannels, int numSamples);
+
+    /**
+        Adds the spikes summarized by another set of statistics (writer thread only)
+
+        Uses the pairwise update of Chan et al., so partial statistics
+        combine to the same result as adding every spike here. Returns
+        false if the other statistics have a different waveform layout.
+    */
+    bool merge(const WaveformStats& other);
+
+    /** Returns the number of spikes added since the last reset */
+    int64_t getNumSpikes() const;
+
+    /** Copies the mean of one channel (any thread); returns false if there are no spikes */
+    bool getMean(int channel, std::vector<float>& mean) const;
+
+    /** Copies the standard deviation of one channel (any thread); returns false until two spikes were seen */
+    bool getStandardDeviation(int channel, std::vector<float>& deviation) const;
+
+    /**
+        Copies the mean and variance of every channel, one channel after the other
+
+        Safe to call while the writer updates the stats. Returns false (and
+        leaves the vectors empty) until two spikes were seen.
+    */
+    bool getMeanAndVariance(std::vector<float>& mean, std::vector<float>& variance) const;
+
+    /** Returns true once after each new spike */
+    bool queryNewData();
+
+    double lastSpikeTime;
+    std::atomic<bool> newData;
+
+    WaveformStats(const WaveformStats&) = delete;
+    WaveformStats& operator=(const WaveformStats&) = delete;
+
+private:
+
+    /** Storage for the mean (first stride values) and M2 (next stride values) */
+    struct Block
+    {
+        Block(int stride_) : stride(stride_), values(size_t(2) * stride_) { }
+
+        int stride;
+        AlignedHeapBlock<float> values;
+    };
+
+    /**
+        Consistent copy of the mean and M2 of one channel, or of all channels if channel < 0
+
+        Nothing is copied if the channel is out of range. Returns false if
+        the writer kept changing the statistics.
+    */
+    bool read(int channel, std::vector<float>* mean, std::vector<float>* m2,
+              int64_t& numSpikes, int& numChannels, int& numSamples) const;
+
+    /** Clears the statistics for a waveform layout (writer, inside an update) */
+    void restart(int numChannels, int numSamples);
+
+    /** Odd while the writer is changing the statistics */
+    std::atomic<uint32_t> sequence;
+
+    std::atomic<int64_t> count;
+    std::atomic<int> layoutChannels, layoutSamples;
+
+    std::atomic<bool> resetRequested;
+
+    /** Current storage; earlier blocks are kept, since a reader may still be copying them */
+    std::atomic<Block*> block;
+    std::vector<std::unique_ptr<Block>> blocks;
+
+    /** Readers give up after this many changed copies */
+    static const int maxReadAttempts = 64;
+};
+
+
+#endif // __WAVEFORMSTATS_H
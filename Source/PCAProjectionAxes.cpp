@@ -33,7 +33,8 @@ PCAProjectionAxes::PCAProjectionAxes(Electrode* electrode_) :
     rangeX(250),
     rangeY(250),
     rangeZ(250),
-    spikesReceivedSinceLastRedraw(0)
+    firstVisibleSpike(0),
+    lastDrawnSpike(0)
 {
     projectionImage = Image(Image::RGB, imageDim, imageDim, true);
     bufferSize = 600;
@@ -83,6 +84,11 @@ void PCAProjectionAxes::updateUnits(std::vector<PCAUnit> _units)
     units = _units;
 }
 
+void PCAProjectionAxes::updateEllipsoidUnits(std::vector<EllipsoidUnit> _units)
+{
+    ellipsoidUnits = _units;
+}
+
 void PCAProjectionAxes::drawUnit(Graphics& g, PCAUnit unit)
 {
     float w = getWidth();
@@ -136,10 +142,46 @@ void PCAProjectionAxes::drawUnit(Graphics& g, PCAUnit unit)
     }
 }
 
-void PCAProjectionAxes::paint(Graphics& g)
+void PCAProjectionAxes::drawEllipsoidUnit(Graphics& g, const EllipsoidUnit& unit)
 {
+    float w = getWidth();
+    float h = getHeight();
 
-    spikesReceivedSinceLastRedraw = 0;
+    int selectedUnitId, selectedBoxId;
+
+    electrode->sorter->getSelectedUnitAndBox(selectedUnitId, selectedBoxId);
+
+    const std::vector<PointD> contour = unit.getContour();
+
+    if (contour.size() < 3)
+        return;
+
+    g.setColour(Colour(unit.colorRGB[0], unit.colorRGB[1], unit.colorRGB[2]));
+
+    float thickness = unit.getUnitId() == selectedUnitId ? 3 : 1;
+
+    for (int k = 0; k < contour.size(); k++)
+    {
+        const PointD& p1 = contour[k];
+        const PointD& p2 = contour[(k + 1) % contour.size()];
+
+        // convert projection coordinates to screen coordinates.
+        float x1 = (p1.X - pcaMin[0]) / (pcaMax[0] - pcaMin[0]) * w;
+        float y1 = (p1.Y - pcaMin[1]) / (pcaMax[1] - pcaMin[1]) * h;
+        float x2 = (p2.X - pcaMin[0]) / (pcaMax[0] - pcaMin[0]) * w;
+        float y2 = (p2.Y - pcaMin[1]) / (pcaMax[1] - pcaMin[1]) * h;
+
+        g.drawLine(x1, y1, x2, y2, thickness);
+    }
+
+    float cx = (unit.center[0] - pcaMin[0]) / (pcaMax[0] - pcaMin[0]) * w;
+    float cy = (unit.center[1] - pcaMin[1]) / (pcaMax[1] - pcaMin[1]) * h;
+
+    g.drawText(String(unit.unitId), cx - 10, cy - 10, 20, 15, juce::Justification::centred, false);
+}
+
+void PCAProjectionAxes::paint(Graphics& g)
+{
 
     g.drawImage(projectionImage,
         0, 0, getWidth(), getHeight(),
@@ -151,6 +193,9 @@ void PCAProjectionAxes::paint(Graphics& g)
         drawUnit(g, units[k]);
     }
 
+    for (auto& unit : ellipsoidUnits)
+        drawEllipsoidUnit(g, unit);
+
     if (inPolygonDrawingMode)
     {
         setMouseCursor(MouseCursor::CrosshairCursor);
@@ -179,34 +224,50 @@ void PCAProjectionAxes::paint(Graphics& g)
         }
     }
 
-    if (redrawSpikes)
+    if (redrawSpikes || electrode->spikeRing->getNumSpikes() != lastDrawnSpike)
     {
         projectionImage.clear(juce::Rectangle<int>(0, 0, projectionImage.getWidth(), projectionImage.getHeight()),
             Colours::black);
         positions.clear();
-        bool subsample = false;
-        int dk = (subsample) ? 5 : 1;
 
-        for (int k = 0; k < bufferSize; k += dk)
-        {
-            drawProjectedSpike(spikeBuffer[k]);
-        }
+        drawBufferedSpikes(false);
+
         redrawSpikes = false;
     }
 
 }
 
 
-void PCAProjectionAxes::drawProjectedSpike(SorterSpikePtr s)
+void PCAProjectionAxes::drawBufferedSpikes(bool subsample)
+{
+    const int64 numSpikes = electrode->spikeRing->getNumSpikes();
+    const int64 firstSpike = jmax(firstVisibleSpike, numSpikes - bufferSize);
+
+    int dk = (subsample) ? 5 : 1;
+
+    float proj[3];
+    uint8 color[3];
+
+    for (int64 k = firstSpike; k < numSpikes; k += dk)
+    {
+        if (electrode->spikeRing->readSpike(k, nullptr, proj, color))
+            drawProjectedSpike(proj, color);
+    }
+
+    lastDrawnSpike = numSpikes;
+}
+
+
+void PCAProjectionAxes::drawProjectedSpike(const float* pcProj, const uint8* color)
 {
-    if (s != nullptr && rangeSet)
+    if (rangeSet)
     {
         Graphics g(projectionImage);
         
-        g.setColour(Colour(s->color[0], s->color[1], s->color[2]));
-        float x = (s->pcProj[0] - pcaMin[0]) / (pcaMax[0] - pcaMin[0]) * rangeX;
-        float y = (s->pcProj[1] - pcaMin[1]) / (pcaMax[1] - pcaMin[1]) * rangeY;
-        float z = (s->pcProj[2] - pcaMin[2]) / (pcaMax[2] - pcaMin[2]) * rangeZ;
+        g.setColour(Colour(color[0], color[1], color[2]));
+        float x = (pcProj[0] - pcaMin[0]) / (pcaMax[0] - pcaMin[0]) * rangeX;
+        float y = (pcProj[1] - pcaMin[1]) / (pcaMax[1] - pcaMin[1]) * rangeY;
+        float z = (pcProj[2] - pcaMin[2]) / (pcaMax[2] - pcaMin[2]) * rangeZ;
             
         //g.fillEllipse(x, y, 2, 2);
         positions.add(x / rangeX, y / rangeY, z / rangeZ);
@@ -226,12 +287,7 @@ void PCAProjectionAxes::redraw(bool subsample)
     projectionImage.clear(juce::Rectangle<int>(0, 0, projectionImage.getWidth(), projectionImage.getHeight()),
         Colours::black);
     
-    int dk = (subsample) ? 5 : 1;
-
-    for (int k = 0; k < bufferSize; k += dk)
-    {
-        drawProjectedSpike(spikeBuffer[k]);
-    }
+    drawBufferedSpikes(subsample);
 
 }
 
@@ -250,33 +306,12 @@ void PCAProjectionAxes::setPCARange(float p1min, float p2min, float p3min, float
 
 }
 
-bool PCAProjectionAxes::updateSpikeData(SorterSpikePtr s)
-{
-
-    if (spikesReceivedSinceLastRedraw < bufferSize)
-    {
-
-        spikeIndex++;
-        spikeIndex %= bufferSize;
-
-        spikeBuffer.set(spikeIndex, s);
-
-        spikesReceivedSinceLastRedraw++;
-        //drawProjectedSpike(newSpike);
-        redrawSpikes = true;
-
-    }
-    return true;
-}
-
-
 void PCAProjectionAxes::clear()
 {
     projectionImage.clear(juce::Rectangle<int>(0, 0, projectionImage.getWidth(), projectionImage.getHeight()),
         Colours::black);
 
-    spikeBuffer.clear();
-    spikeIndex = 0;
+    firstVisibleSpike = electrode->spikeRing->getNumSpikes();
 
     redrawSpikes = true;
 }
@@ -29,6 +29,7 @@
 #include "Containers.h"
 #include "SpikeSorterCanvas.h"
 #include "PCAUnit.h"
+#include "EllipsoidUnit.h"
 
 class Electrode;
 class SpikeSorterCanvas;
@@ -47,16 +48,13 @@ public:
     /** Sets range for PCA*/
     void setPCARange(float p1min, float p2min, float p3min, float p1max, float p2max, float p3max);
 
-    /** Adds a new spike object*/
-	bool updateSpikeData(SorterSpikePtr s);
-
     /** Renders the PCA projections */
     void paint(Graphics& g);
 
     /** Turns polygon drawing mode on or off*/
     void setPolygonDrawingMode(bool on);
 
-    /** Clears the axes*/
+    /** Hides all spikes received so far */
     void clear();
 
     /** Functions For OpenGL*/
@@ -77,9 +75,13 @@ public:
 
     void updateUnits(std::vector<PCAUnit> _units);
 
+    /** Sets the ellipsoid units, drawn as their outline in the PC1/PC2 plane */
+    void updateEllipsoidUnits(std::vector<EllipsoidUnit> _units);
+
     void buttonClicked(Button* button);
 
     void drawUnit(Graphics& g, PCAUnit unit);
+    void drawEllipsoidUnit(Graphics& g, const EllipsoidUnit& unit);
     void rangeDown();
     void rangeUp();
 
@@ -89,7 +91,10 @@ public:
 private:
     float prevx,prevy;
     bool inPolygonDrawingMode;
-	void drawProjectedSpike(SorterSpikePtr s);
+	void drawProjectedSpike(const float* pcProj, const uint8* color);
+
+    /** Draws the most recent spikes held in the electrode's SpikeRing */
+    void drawBufferedSpikes(bool subsample);
 
     bool rangeSet;
     
@@ -97,9 +102,9 @@ private:
 	void updateRange(SorterSpikePtr s);
     ScopedPointer<UtilityButton> rangeDownButton, rangeUpButton;
 
-    SorterSpikeArray spikeBuffer;
     int bufferSize;
-    int spikeIndex;
+    int64 firstVisibleSpike;
+    int64 lastDrawnSpike;
     bool updateProcessor;
 	void calcWaveformPeakIdx(SorterSpikePtr, int, int, int*, int*);
 
@@ -119,12 +124,11 @@ private:
     int rangeY;
     int rangeZ;
 
-    int spikesReceivedSinceLastRedraw;
-
     float pcaMin[3],pcaMax[3];
     std::list<PointD> drawnPolygon;
 
     std::vector<PCAUnit> units;
+    std::vector<EllipsoidUnit> ellipsoidUnits;
     int isOverUnit;
     PCAUnit drawnUnit;
 
@@ -36,33 +36,21 @@ SpikePlot::SpikePlot(Electrode* electrode_) :
 
     font = Font("Default", 15, Font::plain);
 
-    switch (electrode->numChannels)
-    {
-    case 1:
-        nWaveAx = 1;
-        nProjAx = 1;
-        minWidth = 600;
-        aspectRatio = 0.5f;
-        break;
-    case 2:
-        nWaveAx = 2;
-        nProjAx = 1;
-        minWidth = 300;
-        aspectRatio = 0.5f;
-        break;
-    case 4:
-        nWaveAx = 4;
-        nProjAx = 1;
-        minWidth = 400;
-        aspectRatio = 0.5f;
-        break;
-    default: // unsupported number of axes provided
-        std::cout << "SpikePlot as UNKNOWN, defaulting to SINGLE_PLOT" << std::endl;
-        nWaveAx = 1;
-        nProjAx = 0;
-    }
+    // one waveform axis per channel, in a near-square grid (1x1, 2x1, 2x2, 3x3, ... 6x6 for 32 channels)
+    nWaveAx = jmax(1, electrode->numChannels);
+    nProjAx = 1;
+
+    nWaveCols = 1;
+
+    while (nWaveCols * nWaveCols < nWaveAx)
+        nWaveCols++;
 
-    std::vector<float> scales = { 250, 250, 250, 250 }; // processor->getElectrodeVoltageScales(electrodeID);
+    nWaveRows = (nWaveAx + nWaveCols - 1) / nWaveCols;
+
+    minWidth = nWaveAx == 1 ? 600 : 100 * nWaveCols * 2;
+    aspectRatio = 0.5f;
+
+    std::vector<float> scales(nWaveAx, 250); // processor->getElectrodeVoltageScales(electrodeID);
     initAxes(scales);
 
     for (int i = 0; i < electrode->numChannels; i++)
@@ -153,6 +141,7 @@ void SpikePlot::updateUnits()
     }
     
     pAxes[0]->updateUnits(pcaUnits);
+    pAxes[0]->updateEllipsoidUnits(electrode->sorter->getEllipsoidUnits());
 
     int selectedUnitID, selectedBoxID;
     electrode->sorter->getSelectedUnitAndBox(selectedUnitID, selectedBoxID);
@@ -165,22 +154,6 @@ void SpikePlot::setPCARange(float p1min, float p2min, float p3min, float p1max,
     pAxes[0]->setPCARange(p1min, p2min, p3min, p1max, p2max, p3max);
 }
 
-void SpikePlot::processSpikeObject(SorterSpikePtr s)
-{
-    const ScopedLock myScopedLock(mut);
-
-    if (nWaveAx > 0)
-    {
-        for (int i = 0; i < nWaveAx; i++)
-        {
-            wAxes[i]->updateSpikeData(s);
-        }
-
-        pAxes[0]->updateSpikeData(s);
-
-    }
-}
-
 void SpikePlot::initAxes(std::vector<float> scales)
 {
     const ScopedLock myScopedLock(mut);
@@ -213,36 +186,9 @@ void SpikePlot::resized()
     float width = (float)getWidth() - 10;
     float height = (float)getHeight() - 50;
 
-    float axesWidth = 0;
-    float axesHeight = 0;
-
-    // to compute the axes positions we need to know how many columns of proj and wave axes should exist
-    // using these two values we can calculate the positions of all of the sub axes
-    int nProjCols = 0;
-    int nWaveCols = 0;
-
-    switch (electrode->numChannels)
-    {
-    case 1:
-        nProjCols = 1;
-        nWaveCols = 1;
-        axesWidth = width / 2;
-        axesHeight = height;
-        break;
-
-    case 2:
-        nProjCols = 1;
-        nWaveCols = 2;
-        axesWidth = width / 2;
-        axesHeight = height;
-        break;
-    case 4:
-        nProjCols = 1;
-        nWaveCols = 2;
-        axesWidth = width / 2;
-        axesHeight = height / 2;
-        break;
-    }
+    // waveform axes fill the left half in a grid, the projection axes the right half
+    float axesWidth = width / 2;
+    float axesHeight = height / nWaveRows;
 
     for (int i = 0; i < nWaveAx; i++)
     {
@@ -342,36 +288,19 @@ void SpikePlot::setLimitsOnAxes()
 
 void SpikePlot::initLimits()
 {
-    
-    for (int i = 0; i < electrode->numChannels; i++)
-    {
-        limits[i][0] = 1209;
-        limits[i][1] = 11059;
-    }
-
+    limits.assign(nWaveAx, std::make_pair(1209.0, 11059.0));
 }
 
 void SpikePlot::getBestDimensions(int* w, int* h)
 {
-    switch (electrode->numChannels)
-    {
-    case 4:
-        *w = 4;
-        *h = 2;
-        break;
-    case 2:
-        *w = 2;
-        *h = 1;
-        break;
-    case 1:
-        *w = 1;
-        *h = 1;
-        break;
-    default:
-        *w = 1;
-        *h = 1;
-        break;
-    }
+    // waveform grid plus the projection axes, which take as much width as the grid
+    *w = nWaveAx == 1 ? 1 : 2 * nWaveCols;
+    *h = nWaveRows;
+}
+
+int SpikePlot::getDesiredHeight() const
+{
+    return jmax(int(defaultHeight), 50 + nWaveRows * minRowHeight);
 }
 
 void SpikePlot::clear()
@@ -399,7 +328,7 @@ float SpikePlot::getDisplayThresholdForChannel(int i)
 }
 
 
-Array<float> SpikePlot::getDisplayThresholds()
+const Array<float>& SpikePlot::getDisplayThresholds()
 {
     return thresholds;
 }
@@ -31,6 +31,7 @@
 #include "BoxUnit.h"
 #include "PCAUnit.h"
 
+#include <utility>
 #include <vector>
 
 class SpikeSorter;
@@ -39,8 +40,13 @@ class Electrode;
 class PCAProjectionAxes;
 class WaveformAxes;
 
-#define MAX_N_CHAN 4
+/**
+    Waveform axes (one per channel, in a grid) and PC projection axes for one electrode
 
+    Electrodes can have any number of channels: the waveform axes are laid
+    out in a near-square grid, and the plot grows taller (inside the
+    canvas viewport) once the rows would get shorter than minRowHeight.
+*/
 class SpikePlot : public Component, 
                   public Button::Listener
 {
@@ -79,9 +85,6 @@ public:
     /** Sets axes limits*/
     void modifyRange(std::vector<float> values);
     
-    /** Handle an incoming spike object*/
-	void processSpikeObject(SorterSpikePtr s);
-
     /** Gets the ID of the currently selected unit and box */
     void getSelectedUnitAndBox(int& unitID, int& boxID);
 
@@ -94,6 +97,15 @@ public:
     /** Gets the desired aspect ratio for the plot */
     void getBestDimensions(int*, int*);
 
+    /** Returns the height needed to show every waveform axis at a readable size */
+    int getDesiredHeight() const;
+
+    /** Smallest height of a row of waveform axes */
+    static const int minRowHeight = 120;
+
+    /** Height of the plot for electrodes with up to four channels */
+    static const int defaultHeight = 430;
+
     /** Clears the waveform and PCA axes*/
     void clear();
 
@@ -104,7 +116,7 @@ public:
     float getDisplayThresholdForChannel(int);
 
     /** Returns the threshold levels for all channels*/
-    Array<float> getDisplayThresholds();
+    const Array<float>& getDisplayThresholds();
 
     /** Sets the threshold level for displaying spikes*/
     void setDisplayThresholdForChannel(int channelNum, float thres);
@@ -122,9 +134,13 @@ private:
     int nWaveAx;
     int nProjAx;
 
+    /** Grid of waveform axes */
+    int nWaveCols, nWaveRows;
+
     bool limitsChanged;
 
-    double limits[MAX_N_CHAN][2];
+    /** Lower and upper limit of each channel */
+    std::vector<std::pair<double, double>> limits;
 
     std::vector<BoxUnit> boxUnits;
     std::vector<PCAUnit> pcaUnits;
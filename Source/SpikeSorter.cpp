@@ -28,9 +28,10 @@
 #include <stdio.h>
 
 
-Electrode::Electrode(SpikeChannel* channel, PCAComputingThread* computingThread_)
-    : computingThread(computingThread_),
-      isActive(true)
+Electrode::Electrode(SpikeChannel* channel, PCAJobScheduler* pcaScheduler_)
+    : shard(0),
+      isActive(true),
+      pcaScheduler(pcaScheduler_)
 {
 
     name = channel->getName();
@@ -42,8 +43,18 @@ Electrode::Electrode(SpikeChannel* channel, PCAComputingThread* computingThread_
 
     numChannels = channel->getNumChannels();
     numSamples = channel->getPrePeakSamples() + channel->getPostPeakSamples();
+
+    channelInfo.numChannels = numChannels;
+    channelInfo.numSamples = numSamples;
+    channelInfo.prePeakSamples = channel->getPrePeakSamples();
+    channelInfo.sampleRate = channel->getSampleRate();
+
+    spikePool = std::make_unique<SorterSpikePool>(numChannels * numSamples);
+
+    spikeRing = std::make_unique<SpikeRing>(numChannels, numSamples);
     
-    sorter = std::make_unique<Sorter>(this, computingThread);
+    sorter = std::make_unique<Sorter>(spikeRing.get(), pcaScheduler);
+    sorter->setChannel(channelInfo);
 
     plot = std::make_unique<SpikePlot>(this);
 
@@ -66,10 +77,382 @@ void Electrode::updateSettings(SpikeChannel* channel)
 {
     name = channel->getName();
 
+    channelInfo.sampleRate = channel->getSampleRate();
+    sorter->setChannel(channelInfo);
+
     plot->setName(name);
 }
 
-SpikeSorter::SpikeSorter() : GenericProcessor("Spike Sorter")
+void Electrode::saveCustomParametersToXml(XmlElement* xml)
+{
+    const SorterState state = sorter->getState();
+
+    xml->setAttribute("name", name);
+    xml->setAttribute("stream_name", streamName);
+    xml->setAttribute("source_node_id", sourceNodeId);
+
+    xml->setAttribute("selectedUnit", state.selectedUnit);
+    xml->setAttribute("selectedBox", state.selectedBox);
+
+    XmlElement* pcaNode = xml->createNewChildElement("PCA");
+    pcaNode->setAttribute("numChannels", state.numChannels);
+    pcaNode->setAttribute("waveformLength", state.waveformLength);
+    pcaNode->setAttribute("pc1min", state.pcMin[0]);
+    pcaNode->setAttribute("pc2min", state.pcMin[1]);
+    pcaNode->setAttribute("pc3min", state.pcMin[2]);
+    pcaNode->setAttribute("pc1max", state.pcMax[0]);
+    pcaNode->setAttribute("pc2max", state.pcMax[1]);
+    pcaNode->setAttribute("pc3max", state.pcMax[2]);
+    pcaNode->setAttribute("streaming", state.streaming);
+    pcaNode->setAttribute("forgettingFactor", state.forgettingFactor);
+    pcaNode->setAttribute("numComponents", state.numComponents);
+    pcaNode->setAttribute("trainingSetSize", state.trainingSetSize);
+    pcaNode->setAttribute("localChannels", state.numLocalChannels);
+
+    if (state.basisVersion > 0)
+    {
+        // a channel-local basis stores fewer, shorter components
+        const int dim = (int) state.mean.size();
+        const int numStored = dim > 0 ? (int) (state.components.size() / dim) : 0;
+
+        pcaNode->setAttribute("basisVersion", state.basisVersion);
+        pcaNode->setAttribute("numTrainingSpikes", String(state.numTrainingSpikes));
+        pcaNode->setAttribute("basisLocalChannels", state.basisLocalChannels);
+        pcaNode->setAttribute("peakSample", state.peakSample);
+
+        for (int i = 0; i < numStored; i++)
+            pcaNode->setAttribute("ev" + String(i + 1), state.eigenvalues[i]);
+
+        for (int k = 0; k < dim; k++)
+        {
+            XmlElement* dimNode = pcaNode->createNewChildElement("PCA_DIM");
+
+            for (int i = 0; i < numStored; i++)
+                dimNode->setAttribute("pc" + String(i + 1), state.components[i * dim + k]);
+
+            dimNode->setAttribute("mean", state.mean[k]);
+        }
+    }
+
+    for (auto& unit : state.pcaUnits)
+    {
+        XmlElement* PcaUnitNode = pcaNode->createNewChildElement("UNIT");
+
+        PcaUnitNode->setAttribute("UnitID", unit.unitId);
+        PcaUnitNode->setAttribute("ColorR", unit.colorRGB[0]);
+        PcaUnitNode->setAttribute("ColorG", unit.colorRGB[1]);
+        PcaUnitNode->setAttribute("ColorB", unit.colorRGB[2]);
+        PcaUnitNode->setAttribute("BasisVersion", unit.basisVersion);
+        PcaUnitNode->setAttribute("PolygonNumPoints", (int) unit.poly.pts.size());
+        PcaUnitNode->setAttribute("PolygonOffsetX", (int) unit.poly.offset.X);
+        PcaUnitNode->setAttribute("PolygonOffsetY", (int) unit.poly.offset.Y);
+
+        for (auto& point : unit.poly.pts)
+        {
+            XmlElement* PolygonNode = PcaUnitNode->createNewChildElement("POLYGON_POINT");
+            PolygonNode->setAttribute("pointX", point.X);
+            PolygonNode->setAttribute("pointY", point.Y);
+        }
+    }
+
+    XmlElement* boxNode = xml->createNewChildElement("BOXES");
+
+    for (auto& unit : state.boxUnits)
+    {
+        XmlElement* boxUnitNode = boxNode->createNewChildElement("UNIT");
+
+        boxUnitNode->setAttribute("UnitID", unit.unitId);
+        boxUnitNode->setAttribute("ColorR", unit.colorRGB[0]);
+        boxUnitNode->setAttribute("ColorG", unit.colorRGB[1]);
+        boxUnitNode->setAttribute("ColorB", unit.colorRGB[2]);
+
+        for (auto box : unit.lstBoxes)
+        {
+            XmlElement* boxNode = boxUnitNode->createNewChildElement("BOX");
+            boxNode->setAttribute("ch", (int) box.channel);
+            boxNode->setAttribute("x", (int) box.x);
+            boxNode->setAttribute("y", (int) box.y);
+            boxNode->setAttribute("w", (int) box.w);
+            boxNode->setAttribute("h", (int) box.h);
+        }
+    }
+
+    XmlElement* templateNode = xml->createNewChildElement("TEMPLATES");
+
+    for (auto& unit : state.templateUnits)
+    {
+        XmlElement* templateUnitNode = templateNode->createNewChildElement("UNIT");
+
+        templateUnitNode->setAttribute("UnitID", unit.unitId);
+        templateUnitNode->setAttribute("ColorR", unit.colorRGB[0]);
+        templateUnitNode->setAttribute("ColorG", unit.colorRGB[1]);
+        templateUnitNode->setAttribute("ColorB", unit.colorRGB[2]);
+        templateUnitNode->setAttribute("Metric", unit.metric == TemplateUnit::WHITENED ? "whitened" : "euclidean");
+        templateUnitNode->setAttribute("Threshold", unit.threshold);
+        templateUnitNode->setAttribute("NumChannels", unit.numChannels);
+
+        for (int k = 0; k < unit.getDimension(); k++)
+        {
+            XmlElement* sampleNode = templateUnitNode->createNewChildElement("SAMPLE");
+            sampleNode->setAttribute("mean", unit.waveform[k]);
+            sampleNode->setAttribute("variance", unit.variance[k]);
+        }
+    }
+
+    XmlElement* ellipsoidNode = xml->createNewChildElement("ELLIPSOIDS");
+
+    for (auto& unit : state.ellipsoidUnits)
+    {
+        XmlElement* ellipsoidUnitNode = ellipsoidNode->createNewChildElement("UNIT");
+
+        ellipsoidUnitNode->setAttribute("UnitID", unit.unitId);
+        ellipsoidUnitNode->setAttribute("ColorR", unit.colorRGB[0]);
+        ellipsoidUnitNode->setAttribute("ColorG", unit.colorRGB[1]);
+        ellipsoidUnitNode->setAttribute("ColorB", unit.colorRGB[2]);
+        ellipsoidUnitNode->setAttribute("BasisVersion", unit.basisVersion);
+        ellipsoidUnitNode->setAttribute("NumComponents", unit.numComponents);
+        ellipsoidUnitNode->setAttribute("Radius", unit.radius);
+
+        // one row of the Cholesky factor per component
+        for (int i = 0, k = 0; i < unit.numComponents; i++)
+        {
+            XmlElement* componentNode = ellipsoidUnitNode->createNewChildElement("COMPONENT");
+            componentNode->setAttribute("center", unit.center[i]);
+
+            for (int j = 0; j <= i; j++)
+                componentNode->setAttribute("l" + String(j + 1), unit.cholesky[k++]);
+        }
+    }
+}
+
+void Electrode::loadCustomParametersFromXml(XmlElement* xml)
+{
+    // start from the current settings, so anything missing from the file is left as is
+    SorterState state = sorter->getState();
+
+    state.basisVersion = 0;
+    state.components.clear();
+    state.mean.clear();
+    state.pcaUnits.clear();
+    state.boxUnits.clear();
+    state.templateUnits.clear();
+    state.ellipsoidUnits.clear();
+
+    state.selectedUnit = xml->getIntAttribute("selectedUnit", 0);
+    state.selectedBox = xml->getIntAttribute("selectedBox", 0);
+
+    forEachXmlChildElement(*xml, sorterNode)
+    {
+        if (sorterNode->hasTagName("PCA"))
+        {
+
+            state.numChannels = sorterNode->getIntAttribute("numChannels");
+            state.waveformLength = sorterNode->getIntAttribute("waveformLength");
+
+            state.pcMin[0] = sorterNode->getDoubleAttribute("pc1min");
+            state.pcMin[1] = sorterNode->getDoubleAttribute("pc2min");
+            state.pcMin[2] = sorterNode->getDoubleAttribute("pc3min");
+            state.pcMax[0] = sorterNode->getDoubleAttribute("pc1max");
+            state.pcMax[1] = sorterNode->getDoubleAttribute("pc2max");
+            state.pcMax[2] = sorterNode->getDoubleAttribute("pc3max");
+
+            state.streaming = sorterNode->getBoolAttribute("streaming", false);
+            state.forgettingFactor = sorterNode->getDoubleAttribute("forgettingFactor", 0.999);
+            state.numComponents = jlimit(PCABasis::defaultComponents, PCABasis::maxComponents,
+                                         sorterNode->getIntAttribute("numComponents", PCABasis::defaultComponents));
+            state.trainingSetSize = sorterNode->getIntAttribute("trainingSetSize", TrainingReservoir::defaultCapacity);
+            state.numLocalChannels = sorterNode->getIntAttribute("localChannels", 0);
+
+            state.basisVersion = sorterNode->getIntAttribute("basisVersion", 0);
+
+            if (state.basisVersion > 0)
+            {
+                state.basisLocalChannels = sorterNode->getIntAttribute("basisLocalChannels", 0);
+                state.peakSample = sorterNode->getIntAttribute("peakSample", 0);
+
+                // missing components (a local basis stores fewer) read as zero and are not used
+                const int dim = state.basisLocalChannels > 0 ? state.waveformLength
+                                                             : state.numChannels * state.waveformLength;
+
+                state.components.resize(size_t(state.numComponents) * dim);
+                state.mean.resize(dim);
+
+                int dimcounter = 0;
+
+                forEachXmlChildElement(*sorterNode, dimNode)
+                {
+                    if (dimNode->hasTagName("PCA_DIM") && dimcounter < dim)
+                    {
+                        for (int i = 0; i < state.numComponents; i++)
+                            state.components[i * dim + dimcounter] = dimNode->getDoubleAttribute("pc" + String(i + 1));
+
+                        state.mean[dimcounter] = dimNode->getDoubleAttribute("mean", 0.0);
+                        dimcounter++;
+                    }
+                }
+
+                state.numTrainingSpikes = sorterNode->getStringAttribute("numTrainingSpikes", "0").getLargeIntValue();
+
+                for (int i = 0; i < state.numComponents; i++)
+                    state.eigenvalues[i] = sorterNode->getDoubleAttribute("ev" + String(i + 1), 0.0);
+            }
+
+            forEachXmlChildElement(*sorterNode, unitNode)
+            {
+                if (unitNode->hasTagName("UNIT"))
+                {
+
+                    std::cout << " Found a PCA unit " << std::endl;
+
+                    PCAUnit pcaUnit;
+
+                    pcaUnit.unitId = unitNode->getIntAttribute("UnitID");
+
+                    pcaUnit.colorRGB[0] = unitNode->getIntAttribute("ColorR");
+                    pcaUnit.colorRGB[1] = unitNode->getIntAttribute("ColorG");
+                    pcaUnit.colorRGB[2] = unitNode->getIntAttribute("ColorB");
+
+                    pcaUnit.basisVersion = unitNode->getIntAttribute("BasisVersion", 0);
+
+                    int numPolygonPoints = unitNode->getIntAttribute("PolygonNumPoints");
+                    pcaUnit.poly.pts.resize(numPolygonPoints);
+                    pcaUnit.poly.offset.X = unitNode->getDoubleAttribute("PolygonOffsetX");
+                    pcaUnit.poly.offset.Y = unitNode->getDoubleAttribute("PolygonOffsetY");
+                    
+                    int pointCounter = 0;
+                    forEachXmlChildElement(*unitNode, polygonPoint)
+                    {
+                        if (polygonPoint->hasTagName("POLYGON_POINT") && pointCounter < numPolygonPoints)
+                        {
+                            pcaUnit.poly.pts[pointCounter].X = polygonPoint->getDoubleAttribute("pointX");
+                            pcaUnit.poly.pts[pointCounter].Y = polygonPoint->getDoubleAttribute("pointY");
+                            pointCounter++;
+                        }
+                    }
+
+                    state.pcaUnits.push_back(pcaUnit);
+                }
+            }
+        }
+        else if (sorterNode->hasTagName("BOXES"))
+        {
+            forEachXmlChildElement(*sorterNode, unitNode)
+            {
+                if (unitNode->hasTagName("UNIT"))
+                {
+
+                    std::cout << " Found a box unit " << std::endl;
+
+                    BoxUnit boxUnit;
+                    boxUnit.unitId = unitNode->getIntAttribute("UnitID");
+
+                    boxUnit.colorRGB[0] = unitNode->getIntAttribute("ColorR");
+                    boxUnit.colorRGB[1] = unitNode->getIntAttribute("ColorG");
+                    boxUnit.colorRGB[2] = unitNode->getIntAttribute("ColorB");
+
+                    forEachXmlChildElement(*unitNode, boxNode)
+                    {
+                        if (boxNode->hasTagName("BOX"))
+                        {
+                            Box box;
+                            
+                            box.channel = boxNode->getIntAttribute("ch");
+                            box.x = boxNode->getDoubleAttribute("x");
+                            box.y = boxNode->getDoubleAttribute("y");
+                            box.w = boxNode->getDoubleAttribute("w");
+                            box.h = boxNode->getDoubleAttribute("h");
+                            
+                            boxUnit.lstBoxes.push_back(box);
+                        }
+                    }
+
+                    state.boxUnits.push_back(boxUnit);
+                }
+            }
+        }
+        else if (sorterNode->hasTagName("TEMPLATES"))
+        {
+            forEachXmlChildElement(*sorterNode, unitNode)
+            {
+                if (unitNode->hasTagName("UNIT"))
+                {
+                    TemplateUnit templateUnit;
+                    templateUnit.unitId = unitNode->getIntAttribute("UnitID");
+
+                    templateUnit.colorRGB[0] = unitNode->getIntAttribute("ColorR");
+                    templateUnit.colorRGB[1] = unitNode->getIntAttribute("ColorG");
+                    templateUnit.colorRGB[2] = unitNode->getIntAttribute("ColorB");
+
+                    templateUnit.metric = unitNode->getStringAttribute("Metric", "whitened") == "euclidean"
+                                              ? TemplateUnit::EUCLIDEAN : TemplateUnit::WHITENED;
+                    templateUnit.threshold = unitNode->getDoubleAttribute("Threshold", TemplateUnit::defaultThreshold);
+                    templateUnit.numChannels = unitNode->getIntAttribute("NumChannels", 1);
+
+                    forEachXmlChildElement(*unitNode, sampleNode)
+                    {
+                        if (sampleNode->hasTagName("SAMPLE"))
+                        {
+                            templateUnit.waveform.push_back(sampleNode->getDoubleAttribute("mean"));
+                            templateUnit.variance.push_back(sampleNode->getDoubleAttribute("variance", 1.0));
+                        }
+                    }
+
+                    if (templateUnit.numChannels > 0 && templateUnit.getDimension() > 0
+                        && templateUnit.getDimension() % templateUnit.numChannels == 0)
+                    {
+                        templateUnit.numSamples = templateUnit.getDimension() / templateUnit.numChannels;
+                        state.templateUnits.push_back(templateUnit);
+                    }
+                }
+            }
+        }
+        else if (sorterNode->hasTagName("ELLIPSOIDS"))
+        {
+            forEachXmlChildElement(*sorterNode, unitNode)
+            {
+                if (unitNode->hasTagName("UNIT"))
+                {
+                    EllipsoidUnit ellipsoidUnit;
+                    ellipsoidUnit.unitId = unitNode->getIntAttribute("UnitID");
+
+                    ellipsoidUnit.colorRGB[0] = unitNode->getIntAttribute("ColorR");
+                    ellipsoidUnit.colorRGB[1] = unitNode->getIntAttribute("ColorG");
+                    ellipsoidUnit.colorRGB[2] = unitNode->getIntAttribute("ColorB");
+
+                    ellipsoidUnit.basisVersion = unitNode->getIntAttribute("BasisVersion", 0);
+                    ellipsoidUnit.numComponents = unitNode->getIntAttribute("NumComponents", 0);
+                    ellipsoidUnit.radius = unitNode->getDoubleAttribute("Radius",
+                                                                        EllipsoidUnit::defaultRadius(ellipsoidUnit.numComponents));
+
+                    int row = 0;
+
+                    forEachXmlChildElement(*unitNode, componentNode)
+                    {
+                        if (componentNode->hasTagName("COMPONENT") && row < ellipsoidUnit.numComponents)
+                        {
+                            ellipsoidUnit.center.push_back(componentNode->getDoubleAttribute("center"));
+
+                            for (int j = 0; j <= row; j++)
+                                ellipsoidUnit.cholesky.push_back(componentNode->getDoubleAttribute("l" + String(j + 1)));
+
+                            row++;
+                        }
+                    }
+
+                    // a truncated or singular factor leaves the unit out
+                    if (ellipsoidUnit.updateWhitening())
+                        state.ellipsoidUnits.push_back(ellipsoidUnit);
+                }
+            }
+        }
+    }
+
+    sorter->setState(state);
+
+    plot->updateUnits();
+}
+
+SpikeSorter::SpikeSorter() : GenericProcessor("Spike Sorter"), numDroppedSpikes(0), parallelSorting(false)
 {
 
 }
@@ -87,6 +470,8 @@ bool SpikeSorter::startAcquisition()
     SpikeSorterEditor* editor = (SpikeSorterEditor*) getEditor();
     
     editor->enable();
+
+    numDroppedSpikes = 0;
     
     return true;
 }
@@ -98,6 +483,30 @@ bool SpikeSorter::stopAcquisition()
     SpikeSorterEditor* editor = (SpikeSorterEditor*) getEditor();
     
     editor->disable();
+
+    for (auto electrode : electrodes)
+    {
+        LOGD(electrode->name, ": ", electrode->spikePool->getNumSlots(), " spike slots, ",
+             electrode->spikePool->getNumPoolAllocations(), " spike pool allocations");
+    }
+
+    if (numDroppedSpikes > 0)
+        LOGD("Dropped ", numDroppedSpikes, " spikes from channels without an electrode");
+
+    if (parallelSorting)
+    {
+        const SortingStats sortingStats = sortingPool.getStats();
+
+        LOGD("Parallel sorting: ", sortingStats.numTasks, " bursts, ", sortingStats.numFallbacks, " sorted on the processing thread, ",
+             sortingStats.numMissedDeadlines, " missed deadlines, mean wait ", sortingStats.meanWaitUs, " us, max wait ",
+             sortingStats.maxWaitUs, " us");
+    }
+
+    const PCAJobStats stats = pcaScheduler.getStats();
+
+    LOGD("PCA jobs: ", stats.numCompleted, " done, ", stats.numCoalesced, " coalesced, max queue depth ",
+         stats.maxQueueDepth, ", mean wait ", stats.meanWaitMs, " ms, mean latency ", stats.meanLatencyMs,
+         " ms, max latency ", stats.maxLatencyMs, " ms");
     
     return true;
 }
@@ -112,30 +521,38 @@ void SpikeSorter::updateSettings()
         electrode->reset();
     }
 
+    electrodeTable.assign(spikeChannels.size(), nullptr);
+
     for (auto spikeChannel : spikeChannels)
     {
         if (spikeChannel->isValid())
         {
 
-            bool foundMatch = false;
+            Electrode* match = nullptr;
 
             for (auto electrode : electrodes)
             {
                 if (electrode->matchesChannel(spikeChannel))
                 {
                     electrode->updateSettings(spikeChannel);
-                    foundMatch = true;
-                    electrodeMap[spikeChannel] = electrode;
+                    match = electrode;
                     break;
                 }
             }
 
-            if (!foundMatch)
+            if (match == nullptr)
             {
-                Electrode* e = new Electrode(spikeChannel, &computingThread);
-                electrodes.add(e);
-                electrodeMap[spikeChannel] = e;
+                match = new Electrode(spikeChannel, &pcaScheduler);
+                match->shard = electrodes.size();
+                electrodes.add(match);
             }
+
+            const int channelIndex = spikeChannel->getGlobalIndex();
+
+            if (channelIndex >= electrodeTable.size())
+                electrodeTable.resize(channelIndex + 1, nullptr);
+
+            electrodeTable[channelIndex] = match;
             
         }
     }
@@ -158,22 +575,74 @@ Array<Electrode*> SpikeSorter::getElectrodesForStream(uint16 streamId)
 void SpikeSorter::handleSpike(SpikePtr newSpike)
 {
 
-    const SpikeChannel* channelInfo = newSpike->getChannelInfo();
+    const int channelIndex = newSpike->getChannelInfo()->getGlobalIndex();
 
-    SorterSpikePtr sorterSpike = new SorterSpikeContainer(channelInfo, 
-                                                          newSpike->getSortedId(),
-                                                          newSpike->getSampleNumber(),
-                                                          newSpike->getDataPointer());
+    Electrode* electrode = channelIndex >= 0 && channelIndex < electrodeTable.size() ? electrodeTable[channelIndex] : nullptr;
 
-    
+    // e.g. an invalid spike channel
+    if (electrode == nullptr)
+    {
+        numDroppedSpikes++;
+        return;
+    }
+
+    SpikeDescriptor spike;
+    spike.channel = &electrode->channelInfo;
+    spike.waveform = newSpike->getDataPointer();
+    spike.timestamp = newSpike->getSampleNumber();
+    spike.sortedId = newSpike->getSortedId();
+
+    SorterSpikePtr sorterSpike = electrode->spikePool->getNextSpike(spike);
+
+    const Array<float>& thresholds = electrode->plot->getDisplayThresholds();
+
+    if (sorterSpike->checkThresholds(thresholds.getRawDataPointer(), thresholds.size()))
+    {
+        if (electrode->pendingSpikes.empty())
+            electrodesWithSpikes.add(electrode);
 
-    Electrode* electrode = electrodeMap[channelInfo];
+        electrode->pendingSpikes.push_back(sorterSpike);
+        electrode->pendingEvents.add(newSpike);
+    }
+
+}
+
+void SpikeSorter::sortPendingSpikes()
+{
+    // a single electrode isn't worth the handoff
+    if (parallelSorting && sortingPool.isRunning() && electrodesWithSpikes.size() > 1)
+    {
+        for (auto electrode : electrodesWithSpikes)
+        {
+            electrode->sortTask.sorter = electrode->sorter.get();
+            electrode->sortTask.spikes = electrode->pendingSpikes.data();
+            electrode->sortTask.numSpikes = (int) electrode->pendingSpikes.size();
+
+            sortingPool.submit(&electrode->sortTask, electrode->shard);
+        }
+
+        // the IDs must be set before the events leave this processor
+        sortingPool.waitForAll();
+    }
+    else
+    {
+        for (auto electrode : electrodesWithSpikes)
+            electrode->sorter->sortBatch(electrode->pendingSpikes.data(), (int) electrode->pendingSpikes.size(), true);
+    }
 
-    if (sorterSpike->checkThresholds(electrode->plot->getDisplayThresholds()))
+    for (auto electrode : electrodesWithSpikes)
     {
-        electrode->sorter->projectOnPrincipalComponents(sorterSpike);
+        const int numSpikes = (int) electrode->pendingSpikes.size();
+
+        for (int i = 0; i < numSpikes; i++)
+        {
+            const SorterSpikePtr& sorterSpike = electrode->pendingSpikes[i];
+
+            electrode->spikeRing->addSpike(sorterSpike.get());
 
-        electrode->sorter->sortSpike(sorterSpike, true);
+            if (sorterSpike->sortedId > 0)
+                electrode->pendingEvents[i]->setSortedId(sorterSpike->sortedId);
+        }
 
         if (electrode->plot->isVisible())
         {
@@ -184,15 +653,14 @@ void SpikeSorter::handleSpike(SpikePtr newSpike)
                 electrode->sorter->getPCArange(p1min, p2min, p3min, p1max, p2max, p3max);
                 electrode->plot->setPCARange(p1min, p2min, p3min, p1max, p2max, p3max);
             }
-
-            electrode->plot->processSpikeObject(sorterSpike);
         }
 
-        if (sorterSpike->sortedId > 0)
-            newSpike->setSortedId(sorterSpike->sortedId);
+        // keeps the capacity, so the next bursts don't allocate
+        electrode->pendingSpikes.clear();
+        electrode->pendingEvents.clearQuick();
     }
 
-    
+    electrodesWithSpikes.clearQuick();
 }
 
 void SpikeSorter::process(AudioBuffer<float>& buffer)
@@ -200,6 +668,45 @@ void SpikeSorter::process(AudioBuffer<float>& buffer)
 
     checkForEvents(true);
 
+    sortPendingSpikes();
+
+}
+
+void SpikeSorter::setParallelSorting(bool enabled)
+{
+    // threads are started here rather than on the processing thread
+    if (enabled)
+        sortingPool.start();
+
+    parallelSorting = enabled;
+}
+
+bool SpikeSorter::isParallelSortingEnabled() const
+{
+    return parallelSorting;
+}
+
+void SpikeSorter::setSortingDeadline(double milliseconds)
+{
+    sortingPool.setDeadline(milliseconds);
+}
+
+int SpikeSorter::clusterAllElectrodes()
+{
+    const ScopedLock myScopedLock(mut);
+
+    int numJobs = 0;
+
+    // jobs from all electrodes are spread over the PCA workers
+    for (auto electrode : electrodes)
+    {
+        if (electrode->sorter->requestClustering())
+            numJobs++;
+    }
+
+    LOGD("Clustering ", numJobs, " electrodes");
+
+    return numJobs;
 }
 
 Electrode* SpikeSorter::findMatchingElectrode(String name, String stream_name, int stream_source)
@@ -224,13 +731,17 @@ Electrode* SpikeSorter::findMatchingElectrode(String name, String stream_name, i
 
 void SpikeSorter::saveCustomParametersToXml(XmlElement* parentElement)
 {
+
+    XmlElement* sortingNode = parentElement->createNewChildElement("PARALLEL_SORTING");
+    sortingNode->setAttribute("enabled", isParallelSortingEnabled());
+    sortingNode->setAttribute("deadline_ms", sortingPool.getDeadline());
     
     for (auto electrode : electrodes)
     {
         
         XmlElement* electrodeNode = parentElement->createNewChildElement("ELECTRODE");
 
-        electrode->sorter->saveCustomParametersToXml(electrodeNode);
+        electrode->saveCustomParametersToXml(electrodeNode);
 
     }
 
@@ -242,6 +753,12 @@ void SpikeSorter::loadCustomParametersFromXml(XmlElement* xml)
     for (auto* paramsXml : xml->getChildIterator())
     {
 
+        if (paramsXml->hasTagName("PARALLEL_SORTING"))
+        {
+            setSortingDeadline(paramsXml->getDoubleAttribute("deadline_ms", sortingPool.getDeadline()));
+            setParallelSorting(paramsXml->getBoolAttribute("enabled", false));
+        }
+
         if (paramsXml->hasTagName("ELECTRODE"))
         {
             String name = paramsXml->getStringAttribute("name", "");
@@ -251,7 +768,7 @@ void SpikeSorter::loadCustomParametersFromXml(XmlElement* xml)
             Electrode* electrode = findMatchingElectrode(name, stream_name, stream_source);
 
             if (electrode != nullptr)
-                electrode->sorter->loadCustomParametersFromXml(paramsXml);
+                electrode->loadCustomParametersFromXml(paramsXml);
 
         }
     }
@@ -26,9 +26,11 @@
 
 #include <ProcessorHeaders.h>
 
-#include "PCAComputingThread.h"
+#include "PCAJobScheduler.h"
+#include "SortingPool.h"
 #include "Sorter.h"
 #include "SpikePlot.h"
+#include "SpikeRing.h"
 
 #include <algorithm>    // Needed for std::sort
 #include <queue>
@@ -37,12 +39,12 @@
 #include <math.h>
 
 
-class Electrode
+class alignas(64) Electrode
 {
 public:
 
     /** Constructor */
-    Electrode(SpikeChannel* channel, PCAComputingThread* computingThread);
+    Electrode(SpikeChannel* channel, PCAJobScheduler* pcaScheduler);
 
     /** Destructor */
     ~Electrode() { }
@@ -56,6 +58,37 @@ public:
     /** Sets 'isActive' to false */
     void reset() { isActive = false; }
 
+    /** Saves sorting parameters for this electrode */
+    void saveCustomParametersToXml(XmlElement* electrodeNode);
+
+    /** Loads sorting parameters for this electrode */
+    void loadCustomParametersFromXml(XmlElement* electrodeNode);
+
+    // members used for every spike come first, so handleSpike touches as few cache lines as possible
+
+    /** Shape and sample rate of this electrode's spikes, as seen by the sorting core */
+    SpikeChannelDescriptor channelInfo;
+
+    std::unique_ptr<SorterSpikePool> spikePool;
+    std::unique_ptr<SpikePlot> plot;
+
+    /** Spikes received during the current process() call that passed the thresholds */
+    std::vector<SorterSpikePtr> pendingSpikes;
+
+    /** The events these spikes came from (their sorted IDs are written back once sorted) */
+    Array<SpikePtr> pendingEvents;
+
+    std::unique_ptr<Sorter> sorter;
+    std::unique_ptr<SpikeRing> spikeRing;
+
+    /** Hands pendingSpikes to the sorting workers in parallel mode */
+    SortTask sortTask;
+
+    /** Sorting worker this electrode is assigned to (modulo the number of workers) */
+    int shard;
+
+    bool isActive;
+
     String name;
     String streamName;
     int sourceNodeId;
@@ -65,12 +98,7 @@ public:
     int numSamples;
     uint16 streamId;
 
-    bool isActive;
-  
-    std::unique_ptr<SpikePlot> plot;
-    std::unique_ptr<Sorter> sorter;
-
-    PCAComputingThread* computingThread;
+    PCAJobScheduler* pcaScheduler;
 
 };
 
@@ -85,10 +113,10 @@ public:
     /** Destructor */
     ~SpikeSorter() { }
 
-    /** Calls checkForEvents(true) */
+    /** Calls checkForEvents(true), then sorts the spikes it delivered */
     void process(AudioBuffer<float>& buffer) override;
 
-    /** Handles incoming spikes */
+    /** Queues an incoming spike on its electrode */
     void handleSpike(SpikePtr spike) override;
 
     /** Called whenever the signal chain is altered. */
@@ -114,15 +142,46 @@ public:
 
     /** Loads all custom parameters*/
     void loadCustomParametersFromXml(XmlElement* xml) override;
+
+    /** Sorts electrodes on a pool of worker threads instead of the processing thread */
+    void setParallelSorting(bool enabled);
+
+    /** Returns true if electrodes are sorted on worker threads */
+    bool isParallelSortingEnabled() const;
+
+    /**
+        Sets how long the processing thread waits for the workers before sorting the remaining electrodes itself (ms)
+
+        A soft deadline: electrodes a worker has already started are still waited for (see SortingPool).
+    */
+    void setSortingDeadline(double milliseconds);
+
+    /** Starts automatic clustering on every electrode with a PC basis; returns the number of jobs queued */
+    int clusterAllElectrodes();
    
 private:
 
+    /** Sorts the spikes queued by handleSpike, one burst per electrode */
+    void sortPendingSpikes();
+
     CriticalSection mut;
 
     OwnedArray<Electrode> electrodes;
-    std::map<const SpikeChannel*, Electrode*> electrodeMap;
+
+    /** Electrode for each spike channel, indexed by the channel's global index (nullptr if none) */
+    std::vector<Electrode*> electrodeTable;
+
+    /** Spikes from channels without an electrode since acquisition started */
+    int64 numDroppedSpikes;
+
+    /** Electrodes with queued spikes, in order of their first spike */
+    Array<Electrode*> electrodesWithSpikes;
     
-    PCAComputingThread computingThread;
+    PCAJobScheduler pcaScheduler;
+
+    /** Workers for parallel sorting (started when the mode is first enabled) */
+    SortingPool sortingPool;
+    std::atomic<bool> parallelSorting;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorter);
 
@@ -33,6 +33,7 @@ SpikeSorterCanvas::SpikeSorterCanvas(SpikeSorter* n) :
     processor(n), newSpike(false)
 {
     electrode = nullptr;
+    trackDriftHeld = false;
     viewport = new Viewport();
     spikeDisplay = new SpikeDisplay();
 
@@ -52,6 +53,18 @@ SpikeSorterCanvas::SpikeSorterCanvas(SpikeSorter* n) :
     addPolygonUnitButton->addListener(this);
     addAndMakeVisible(addPolygonUnitButton);
 
+    addTemplateUnitButton = new UtilityButton("New Template Unit", Font("Small Text", 13, Font::plain));
+    addTemplateUnitButton->setRadius(3.0f);
+    addTemplateUnitButton->addListener(this);
+    addTemplateUnitButton->setTooltip("Adds a unit matching the mean waveform of the selected unit");
+    addAndMakeVisible(addTemplateUnitButton);
+
+    addEllipsoidUnitButton = new UtilityButton("New Ellipsoid Unit", Font("Small Text", 13, Font::plain));
+    addEllipsoidUnitButton->setRadius(3.0f);
+    addEllipsoidUnitButton->addListener(this);
+    addEllipsoidUnitButton->setTooltip("Fits an ellipsoid over all principal components to the spikes inside the selected polygon");
+    addAndMakeVisible(addEllipsoidUnitButton);
+
     addBoxButton = new UtilityButton("Add Box", Font("Small Text", 13, Font::plain));
     addBoxButton->setRadius(3.0f);
     addBoxButton->addListener(this);
@@ -67,6 +80,36 @@ SpikeSorterCanvas::SpikeSorterCanvas(SpikeSorter* n) :
     rePCAButton->addListener(this);
     addAndMakeVisible(rePCAButton);
 
+    numComponentsButton = new UtilityButton("3 PCs", Font("Small Text", 13, Font::plain));
+    numComponentsButton->setRadius(3.0f);
+    numComponentsButton->addListener(this);
+    numComponentsButton->setTooltip("Number of principal components computed for ellipsoid units (click to change)");
+    addAndMakeVisible(numComponentsButton);
+
+    localChannelsButton = new UtilityButton("All Channels", Font("Small Text", 13, Font::plain));
+    localChannelsButton->setRadius(3.0f);
+    localChannelsButton->addListener(this);
+    localChannelsButton->setTooltip("Channels each spike is projected on: all, or only the ones around its peak channel (click to change)");
+    addAndMakeVisible(localChannelsButton);
+
+    trackDriftButton = new UtilityButton("Track Drift", Font("Small Text", 13, Font::plain));
+    trackDriftButton->setRadius(3.0f);
+    trackDriftButton->setClickingTogglesState(true);
+    trackDriftButton->addListener(this);
+    addAndMakeVisible(trackDriftButton);
+
+    autoClusterButton = new UtilityButton("Auto-Cluster", Font("Small Text", 13, Font::plain));
+    autoClusterButton->setRadius(3.0f);
+    autoClusterButton->addListener(this);
+    autoClusterButton->setTooltip("Replaces the polygon units of this electrode with automatically found clusters");
+    addAndMakeVisible(autoClusterButton);
+
+    clusterAllButton = new UtilityButton("Cluster All", Font("Small Text", 13, Font::plain));
+    clusterAllButton->setRadius(3.0f);
+    clusterAllButton->addListener(this);
+    clusterAllButton->setTooltip("Replaces the polygon units of every electrode with automatically found clusters");
+    addAndMakeVisible(clusterAllButton);
+
     newIDbuttons = new UtilityButton("New IDs", Font("Small Text", 13, Font::plain));
     newIDbuttons->setRadius(3.0f);
     newIDbuttons->addListener(this);
@@ -112,14 +155,23 @@ void SpikeSorterCanvas::resized()
     addUnitButton->setBounds(8, 120, 115, 20);
     addBoxButton->setBounds(8, 150, 115, 20);
     
-    addPolygonUnitButton->setBounds(8, 190, 115, 20);
-    
-    delUnitButton->setBounds(8, 230, 115, 20);
+    addPolygonUnitButton->setBounds(8, 180, 115, 20);
+    addTemplateUnitButton->setBounds(8, 205, 115, 20);
+    addEllipsoidUnitButton->setBounds(8, 230, 115, 20);
+
+    delUnitButton->setBounds(8, 255, 115, 20);
+
+    rePCAButton->setBounds(5, 295, 115, 20);
+    numComponentsButton->setBounds(5, 320, 115, 20);
+    localChannelsButton->setBounds(5, 345, 115, 20);
 
-    rePCAButton->setBounds(5, 270, 115, 20);
+    trackDriftButton->setBounds(5, 375, 115, 20);
 
-    newIDbuttons->setBounds(5, 300, 115, 20);
-    deleteAllUnits->setBounds(5, 350, 115, 20);
+    autoClusterButton->setBounds(5, 405, 115, 20);
+    clusterAllButton->setBounds(5, 430, 115, 20);
+
+    newIDbuttons->setBounds(5, 465, 115, 20);
+    deleteAllUnits->setBounds(5, 515, 115, 20);
 
 }
 
@@ -127,11 +179,80 @@ void SpikeSorterCanvas::paint(Graphics& g)
 {
 
     g.fillAll(Colours::darkgrey);
+
+    // one line of rate, one of refractory violations and SNR, and one of isolation (units in PC space) per unit
+    g.setFont(Font("Small Text", 11, Font::plain));
+
+    int y = qualityTop;
+
+    for (auto& quality : unitQuality)
+    {
+        const int numLines = quality.lRatio >= 0 ? 3 : 2;
+
+        if (y + numLines * qualityLineHeight > getHeight())
+            break;
+
+        g.setColour(Colours::whitesmoke);
+        g.drawText("Unit " + String(quality.unitId) + ": " + String(quality.firingRate, 1) + " Hz",
+                   8, y, 120, qualityLineHeight, Justification::left, false);
+
+        // more than 1% of intervals inside the refractory period suggests a mixed unit
+        g.setColour(quality.isiViolations > 0.01f ? Colours::red : Colours::lightgrey);
+        g.drawText("ISI " + String(quality.isiViolations * 100.0f, 1) + "%  SNR " + String(quality.snr, 1),
+                   16, y + qualityLineHeight, 112, qualityLineHeight, Justification::left, false);
+
+        if (quality.lRatio >= 0)
+        {
+            const String distance = quality.isolationDistance >= 0 ? String(quality.isolationDistance, 1) : String("-");
+
+            g.setColour(Colours::lightgrey);
+            g.drawText("L " + String(quality.lRatio, 3) + "  ID " + distance,
+                       16, y + 2 * qualityLineHeight, 112, qualityLineHeight, Justification::left, false);
+        }
+
+        y += numLines * qualityLineHeight + 4;
+    }
 }
 
 void SpikeSorterCanvas::refresh()
 {
+    // clustering finishes on a PCA worker thread
+    if (electrode != nullptr && electrode->sorter->clusteringFinished())
+        electrode->plot->updateUnits();
+
     spikeDisplay->refresh();
+
+    updateUnitQuality();
+    updateTrackDriftLabel();
+}
+
+void SpikeSorterCanvas::updateTrackDriftLabel()
+{
+    // streaming refinements wait while units are drawn in the current basis
+    const bool held = electrode != nullptr && electrode->sorter->isStreamingPCAHeld();
+
+    if (held != trackDriftHeld)
+    {
+        trackDriftHeld = held;
+        trackDriftButton->setLabel(held ? "Drift: Held" : "Track Drift");
+    }
+}
+
+void SpikeSorterCanvas::updateUnitQuality()
+{
+    if (electrode != nullptr)
+    {
+        // results arrive at a later refresh; nothing is queued while the units are unchanged
+        electrode->sorter->requestIsolationMetrics();
+        unitQuality = electrode->sorter->getUnitQuality();
+    }
+    else
+    {
+        unitQuality.clear();
+    }
+
+    // only the panel below the buttons changes
+    repaint(0, qualityTop, 130, getHeight() - qualityTop);
 }
 
 
@@ -142,14 +263,30 @@ void SpikeSorterCanvas::setActiveElectrode(Electrode* electrode_)
     if (electrode != nullptr)
     {
         spikeDisplay->setSpikePlot(electrode->plot.get());
+        electrode->pcaScheduler->setPrioritySorter(electrode->sorter.get());
+        trackDriftButton->setToggleState(electrode->sorter->isStreamingPCAEnabled(), dontSendNotification);
+        numComponentsButton->setLabel(String(electrode->sorter->getNumComponents()) + " PCs");
+        updateLocalChannelsLabel();
     }
     else {
         spikeDisplay->setSpikePlot(nullptr);
     }
 
+    updateUnitQuality();
+
     
 }
 
+void SpikeSorterCanvas::updateLocalChannelsLabel()
+{
+    const int numLocalChannels = electrode->sorter->getLocalChannels();
+
+    if (numLocalChannels == 0)
+        localChannelsButton->setLabel("All Channels");
+    else
+        localChannelsButton->setLabel("Peak " + String(numLocalChannels) + " Ch");
+}
+
 void SpikeSorterCanvas::removeUnitOrBox()
 {
     int unitID, boxID;
@@ -293,6 +430,36 @@ void SpikeSorterCanvas::buttonClicked(Button* button)
         }
 
     }
+    else if (button == addTemplateUnitButton)
+    {
+        electrode->plot->getSelectedUnitAndBox(unitID, boxID);
+
+        if (unitID > 0)
+        {
+            int newUnitID = electrode->sorter->addTemplateUnit(unitID, TemplateUnit::WHITENED);
+
+            if (newUnitID > 0)
+            {
+                electrode->plot->updateUnits();
+                electrode->plot->setSelectedUnitAndBox(newUnitID, -1);
+            }
+        }
+    }
+    else if (button == addEllipsoidUnitButton)
+    {
+        electrode->plot->getSelectedUnitAndBox(unitID, boxID);
+
+        if (unitID > 0)
+        {
+            int newUnitID = electrode->sorter->addEllipsoidUnit(unitID);
+
+            if (newUnitID > 0)
+            {
+                electrode->plot->updateUnits();
+                electrode->plot->setSelectedUnitAndBox(newUnitID, -1);
+            }
+        }
+    }
     else if (button == delUnitButton)
     {
         //std::cout << "Delete button pressed" << std::endl;
@@ -315,6 +482,36 @@ void SpikeSorterCanvas::buttonClicked(Button* button)
     {
         electrode->sorter->RePCA();
     }
+    else if (button == numComponentsButton)
+    {
+        // cycles through 3 .. PCABasis::maxComponents
+        int numComponents = electrode->sorter->getNumComponents() + 1;
+
+        if (numComponents > PCABasis::maxComponents)
+            numComponents = PCABasis::defaultComponents;
+
+        electrode->sorter->setNumComponents(numComponents);
+        numComponentsButton->setLabel(String(numComponents) + " PCs");
+        updateLocalChannelsLabel();
+    }
+    else if (button == localChannelsButton)
+    {
+        // cycles through all channels, then 1, 2, 4 ... channels around the peak, up to the clamped maximum
+        const int numLocalChannels = electrode->sorter->getLocalChannels();
+
+        electrode->sorter->setLocalChannels(numLocalChannels == 0 ? 1 : numLocalChannels * 2);
+
+        if (numLocalChannels > 0 && electrode->sorter->getLocalChannels() == numLocalChannels)
+            electrode->sorter->setLocalChannels(0);
+
+        updateLocalChannelsLabel();
+    }
+    else if (button == trackDriftButton)
+    {
+        electrode->sorter->setStreamingPCA(trackDriftButton->getToggleState(),
+                                           electrode->sorter->getForgettingFactor());
+        updateTrackDriftLabel();
+    }
     else if (button == nextElectrode)
     {
         SpikeSorterEditor* ed = (SpikeSorterEditor*)processor->getEditor();
@@ -328,6 +525,15 @@ void SpikeSorterCanvas::buttonClicked(Button* button)
         ed->previousElectrode();
 
     }
+    else if (button == autoClusterButton)
+    {
+        if (electrode != nullptr)
+            electrode->sorter->requestClustering();
+    }
+    else if (button == clusterAllButton)
+    {
+        processor->clusterAllElectrodes();
+    }
     else if (button == newIDbuttons)
     {
         electrode->sorter->generateNewIds();
@@ -346,8 +552,7 @@ void SpikeSorterCanvas::buttonClicked(Button* button)
 
 
 SpikeDisplay::SpikeDisplay() : 
-    activePlot(nullptr),
-    totalHeight(430)
+    activePlot(nullptr)
 {
 
 }
@@ -376,8 +581,12 @@ void SpikeDisplay::setSpikePlot(SpikePlot* plot)
     {
         addAndMakeVisible(activePlot);
     }
-    
-    resized();
+
+    // the height depends on the number of channels of the electrode
+    if (getHeight() != getTotalHeight())
+        setSize(getWidth(), getTotalHeight());
+    else
+        resized();
 }
 
 void SpikeDisplay::refresh()
@@ -396,8 +605,17 @@ void SpikeDisplay::resized()
 {
 
     if (activePlot != nullptr)
-        activePlot->setBounds(0, 0, getWidth(), totalHeight);
+        activePlot->setBounds(0, 0, getWidth(), getTotalHeight());
+
+}
+
+int SpikeDisplay::getTotalHeight()
+{
+    // electrodes with many channels get a taller plot, scrolled by the viewport
+    if (activePlot != nullptr)
+        return activePlot->getDesiredHeight();
 
+    return SpikePlot::defaultHeight;
 }
 
 
@@ -456,7 +674,7 @@ void GenericDrawAxes::getXLims(double* min, double* max)
 
 void GenericDrawAxes::setType(GenericDrawAxes::AxesType t)
 {
-    if (t < GenericDrawAxes::WAVE1 || t > GenericDrawAxes::PCA)
+    if (t < GenericDrawAxes::PCA)
     {
         std::cout << "Invalid Axes type specified";
         return;
@@ -592,7 +810,7 @@ void GenericDrawAxesOpenGL::getXLims(double* min, double* max)
 
 void GenericDrawAxesOpenGL::setType(GenericDrawAxesOpenGL::AxesType t)
 {
-    if (t < GenericDrawAxesOpenGL::WAVE1 || t > GenericDrawAxesOpenGL::PCA)
+    if (t < GenericDrawAxesOpenGL::PCA)
     {
         std::cout << "Invalid Axes type specified";
         return;
@@ -27,6 +27,7 @@
 #include <VisualizerWindowHeaders.h>
 
 #include "Containers.h"
+#include "UnitMetrics.h"
 
 #include <vector>
 
@@ -89,10 +90,17 @@ public:
     ScopedPointer<UtilityButton> 
         addPolygonUnitButton,
         addUnitButton,
+        addTemplateUnitButton,
+        addEllipsoidUnitButton,
         delUnitButton,
         addBoxButton,
         delBoxButton,
         rePCAButton,
+        numComponentsButton,
+        localChannelsButton,
+        trackDriftButton,
+        autoClusterButton,
+        clusterAllButton,
         nextElectrode,
         prevElectrode,
         newIDbuttons,
@@ -103,6 +111,15 @@ private:
     /** Deletes currently selected unit or box */
     void removeUnitOrBox();
 
+    /** Shows the channels used by the PCA of the active electrode */
+    void updateLocalChannelsLabel();
+
+    /** Shows on the Track Drift button whether streaming PCA is held by units in the current basis */
+    void updateTrackDriftLabel();
+
+    /** Fetches the quality figures of the active electrode's units (and requests new isolation metrics) */
+    void updateUnitQuality();
+
     ScopedPointer<SpikeDisplay> spikeDisplay;
     ScopedPointer<Viewport> viewport;
 
@@ -111,6 +128,16 @@ private:
 
     Electrode* electrode;
     int scrollBarThickness;
+
+    /** Label state of the Track Drift button */
+    bool trackDriftHeld;
+
+    /** Quality figures drawn below the buttons (refreshed with the display) */
+    std::vector<UnitQuality> unitQuality;
+
+    /** Top of the quality figures and height of one line of text */
+    static const int qualityTop = 545;
+    static const int qualityLineHeight = 14;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorterCanvas);
 
@@ -146,15 +173,10 @@ public:
     void setPolygonMode(bool on);
 
     /** Returns the total height of the display */
-    int getTotalHeight()
-    {
-        return totalHeight;
-    }
+    int getTotalHeight();
 
 private:
 
-    int totalHeight;
-    
     SpikePlot* activePlot;
 
 };
@@ -169,12 +191,13 @@ class GenericDrawAxesOpenGL : public OpenGLAppComponent,
 {
 public:
 
-    enum AxesType {
+    /** Waveform axes use their channel index as type, so electrodes can have any number of channels */
+    enum AxesType : int {
+        PCA = -1,
         WAVE1 = 0,
         WAVE2,
         WAVE3,
-        WAVE4,
-        PCA = 4
+        WAVE4
     };
 
     /** Constructor */
@@ -219,12 +242,13 @@ class GenericDrawAxes : public Component
 {
 public:
 
-    enum AxesType {
+    /** Waveform axes use their channel index as type, so electrodes can have any number of channels */
+    enum AxesType : int {
+        PCA = -1,
         WAVE1 = 0,
         WAVE2,
         WAVE3,
-        WAVE4,
-        PCA = 4
+        WAVE4
     };
 
     /** Constructor */
@@ -42,6 +42,15 @@ SpikeSorterEditor::SpikeSorterEditor(GenericProcessor* parentNode)
     electrodeSelectionLabel = new Label("Label", "Active Electrode:");
     electrodeSelectionLabel->setBounds(17, 40, 180, 20);
     addAndMakeVisible(electrodeSelectionLabel);
+
+    parallelSortingButton = new UtilityButton("Parallel sorting", Font("Small Text", 13, Font::plain));
+    parallelSortingButton->setRadius(3.0f);
+    parallelSortingButton->setClickingTogglesState(true);
+    parallelSortingButton->setToggleState(((SpikeSorter*) parentNode)->isParallelSortingEnabled(), dontSendNotification);
+    parallelSortingButton->setTooltip("Sort electrodes on worker threads (for probes with many electrodes)");
+    parallelSortingButton->addListener(this);
+    parallelSortingButton->setBounds(20, 100, 140, 20);
+    addAndMakeVisible(parallelSortingButton);
 }
 
 Visualizer* SpikeSorterEditor::createNewCanvas()
@@ -60,6 +69,9 @@ void SpikeSorterEditor::selectedStreamHasChanged()
 
     electrodeList->clear();
 
+    // may have been changed by loading saved settings
+    parallelSortingButton->setToggleState(((SpikeSorter*) getProcessor())->isParallelSortingEnabled(), dontSendNotification);
+
     if (selectedStream == 0)
     {
         return;
@@ -107,6 +119,15 @@ void SpikeSorterEditor::comboBoxChanged(ComboBox* comboBox)
    
 }
 
+void SpikeSorterEditor::buttonClicked(Button* button)
+{
+    if (button == parallelSortingButton)
+    {
+        SpikeSorter* processor = (SpikeSorter*) getProcessor();
+        processor->setParallelSorting(parallelSortingButton->getToggleState());
+    }
+}
+
 void SpikeSorterEditor::nextElectrode()
 {
     int numAvailable = electrodeList->getNumItems();
@@ -40,7 +40,8 @@ class SpikeSorterCanvas;
 */
 
 class SpikeSorterEditor : public VisualizerEditor,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public Button::Listener
 {
 public:
     /** Constructor*/
@@ -55,6 +56,9 @@ public:
     /** ComboBox::Listener callback*/
     void comboBoxChanged(ComboBox* comboBox) override;
 
+    /** Button::Listener callback (parallel sorting toggle) */
+    void buttonClicked(Button* button) override;
+
     /** Selects the next available electrode */
     void nextElectrode();
 
@@ -68,6 +72,7 @@ private:
 
     ScopedPointer<Label> electrodeSelectionLabel;
 	ScopedPointer<ComboBox> electrodeList;
+    ScopedPointer<UtilityButton> parallelSortingButton;
 
     Array<Electrode*> currentElectrodes;
 
@@ -39,10 +39,9 @@ WaveformAxes::WaveformAxes(SpikePlot* plot_, Electrode* electrode_, int channelI
     annotationComponent = std::make_unique<AnnotationComponent>(electrode, &units);
     addAndMakeVisible(annotationComponent.get());
 
-    for (int n = 0; n < bufferSize; n++)
-    {
-        spikeBuffer.add(nullptr);
-    }
+    waveform.malloc(electrode->spikeRing->getNumSamples());
+
+    firstVisibleSpike = electrode->spikeRing->getNumSpikes();
 }
 
 void WaveformAxes::resized()
@@ -59,28 +58,23 @@ void WaveformAxes::setRange(float r)
     repaint();
 }
 
-void WaveformAxes::plotSpike(SorterSpikePtr s, Graphics& g)
+void WaveformAxes::plotSpike(const float* data, const uint8* color, Graphics& g)
 {
-    if (s.get() == nullptr) return;
     float h = getHeight();
 
-    g.setColour(Colour(s->color[0], s->color[1], s->color[2]));
-
-    //compute the spatial width for each waveform sample
-    float dx = getWidth() / float(s->getChannel()->getTotalSamples());
+    g.setColour(Colour(color[0], color[1], color[2]));
 
-    int spikeSamples = s->getChannel()->getTotalSamples();
+    int spikeSamples = electrode->spikeRing->getNumSamples();
 
-    // type corresponds to channel so we need to calculate the starting
-    // sample based upon which channel is getting plotted
-    int offset = channel * spikeSamples;
+    //compute the spatial width for each waveform sample
+    float dx = getWidth() / float(spikeSamples);
 
     float x = 0.0f;
 
     for (int i = 0; i < spikeSamples - 1; i++)
     {
-        float s1 = h - (h / 2 + s->getData()[offset + i] / (range)*h);
-        float s2 = h - (h / 2 + s->getData()[offset + i + 1] / (range)*h);
+        float s1 = h - (h / 2 + data[i] / (range)*h);
+        float s2 = h - (h / 2 + data[i + 1] / (range)*h);
 
         if (signalFlipped)
         {
@@ -149,39 +143,9 @@ void WaveformAxes::drawWaveformGrid(Graphics& g)
 }
 
 
-bool WaveformAxes::updateSpikeData(SorterSpikePtr s)
-{
-    if (!gotFirstSpike)
-    {
-        gotFirstSpike = true;
-    }
-
-    if (spikesReceivedSinceLastRedraw < bufferSize)
-    {
-
-        spikeIndex++;
-        spikeIndex %= bufferSize;
-
-        spikeBuffer.set(spikeIndex, s);
-
-        spikesReceivedSinceLastRedraw++;
-
-    }
-
-    return true;
-
-}
-
-
 void WaveformAxes::clear()
 {
-    spikeBuffer.clear();
-    spikeIndex = 0;
-
-    for (int n = 0; n < bufferSize; n++)
-    {
-        spikeBuffer.add(nullptr);
-    }
+    firstVisibleSpike = electrode->spikeRing->getNumSpikes();
 
     repaint();
 }
@@ -601,8 +565,6 @@ void WaveformAxes::AnnotationComponent::drawBoxes(Graphics& g)
 
 void WaveformAxes::refresh()
 {
-    spikesReceivedSinceLastRedraw = 0;
-    
     repaint();
 }
 
@@ -619,29 +581,30 @@ void WaveformAxes::paint(Graphics& g)
     
     drawWaveformGrid(g);
 
+    const int64 numSpikes = electrode->spikeRing->getNumSpikes();
+
     // if no spikes have been received then don't plot anything
-    if (!gotFirstSpike)
+    if (numSpikes <= firstVisibleSpike)
     {
         return;
     }
 
-    for (int spikeNum = 0; spikeNum < bufferSize; spikeNum++)
-    {
+    const int64 firstSpike = jmax(firstVisibleSpike, numSpikes - bufferSize);
 
-        if (spikeNum != spikeIndex && spikeBuffer[spikeNum] != nullptr)
-        {
+    uint8 color[3];
+
+    for (int64 spikeNum = firstSpike; spikeNum < numSpikes; spikeNum++)
+    {
+        if (spikeNum < numSpikes - 1)
             g.setColour(Colours::grey);
-            plotSpike(spikeBuffer[spikeNum], g);
-        }
+        else
+            g.setColour(Colours::white);
 
+        if (electrode->spikeRing->readChannel(spikeNum, channel, waveform, color))
+            plotSpike(waveform, color, g);
     }
 
-    g.setColour(Colours::white);
-    
-    if (spikeBuffer[spikeIndex] != nullptr)
-        plotSpike(spikeBuffer[spikeIndex], g);
-
     annotationComponent->repaint();
     
 
-}
+}
\ No newline at end of file
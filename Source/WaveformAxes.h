@@ -45,24 +45,21 @@ public:
     /** Destructor*/
     ~WaveformAxes() {}
 
-    /** Handles an incoming spike*/
-	bool updateSpikeData(SorterSpikePtr s) override;
-
     /** Renders the incoming waveforms */
     void paint(Graphics& g) override;
     
     /** Sets whether spikes should be redrawn*/
     void refresh();
 
-    /** Plots an individual spike*/
-    void plotSpike(SorterSpikePtr s, Graphics& g);
+    /** Plots this channel of an individual spike (numSamples values) */
+    void plotSpike(const float* waveform, const uint8* color, Graphics& g);
 
     /** Called when axes are resized */
     void resized() override;
 
     void isOverUnitBox(float x, float y, int& UnitID, int& BoxID, String& where) ;
 
-    /** Clears internal spike buffer */
+    /** Hides all spikes received so far */
     void clear();
 
     int findUnitIndexById(int id);
@@ -138,14 +135,15 @@ private:
     float displayThresholdLevel = 0.0f;
     float detectorThresholdLevel;
 
-    int spikesReceivedSinceLastRedraw = 0;
-
     float mouseDownX, mouseDownY;
     float mouseOffsetX, mouseOffsetY;
 
-    SorterSpikeArray spikeBuffer;
+    /** Index (in the electrode's SpikeRing) of the first spike to display */
+    int64 firstVisibleSpike = 0;
+
+    /** Scratch space for copying this channel of each spike out of the SpikeRing */
+    HeapBlock<float> waveform;
 
-    int spikeIndex = 0;
     int bufferSize = 5;
 
     float range = 250.0f;